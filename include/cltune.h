@@ -35,6 +35,7 @@
 #include <functional> // std::function
 #include <utility> // std::pair
 #include <unordered_map> // std::unordered_map
+#include <cstdint> // uint32_t
 
 // Exports library functions under Windows when building a DLL. See also:
 // https://msdn.microsoft.com/en-us/library/a90k134d.aspx
@@ -51,8 +52,10 @@
 namespace cltune {
 // =================================================================================================
 
-// Forward declaration of the implemenation class
+// Forward declaration of the implemenation classes
 class TunerImpl;
+class PerformanceModelImpl;
+class ResultsReaderImpl;
 
 // CLTune's custom data-types
 using IntRange = std::vector<size_t>;
@@ -61,10 +64,45 @@ using ConstraintFunction = std::function<bool(std::vector<size_t>)>;
 using LocalMemoryFunction = std::function<size_t(std::vector<size_t>)>;
 
 // Enumeration for search strategies
-enum class SearchMethod{FullSearch, RandomSearch, Annealing, PSO};
+enum class SearchMethod{FullSearch, RandomSearch, RandomSampling, Annealing, PSO, ActiveLearning,
+                        HillClimbing, CoordinateDescent, DifferentialEvolution, TabuSearch,
+                        Replay};
 
 // Machine learning models
-enum class Model { kLinearRegression, kNeuralNetwork };
+enum class Model { kLinearRegression, kNeuralNetwork, kGradientBoostedTrees };
+
+// Strategies to select the configurations to verify based on the mean and the standard deviation of
+// the predicted execution times: the mean only, the lower or upper confidence bound (mean minus or
+// plus a multiple of the standard deviation), or Thompson sampling (a random draw per configuration)
+enum class Acquisition { kMean, kLowerConfidenceBound, kUpperConfidenceBound, kThompsonSampling };
+
+// Encodings of tuning parameters as features for the machine learning models. The automatic
+// encoding takes the base-2 logarithm if all values are powers of two and the value itself otherwise.
+enum class Encoding { kAuto, kLinear, kLog2, kOrdinal, kOneHot };
+
+// The outcome of measuring a configuration: a success or the reason of failure. A predicted failure
+// means that the configuration was skipped because it is likely to fail.
+enum class Outcome { kSuccess, kCompileFailure, kLaunchFailure, kVerificationFailure,
+                     kPredictedFailure };
+
+// A single tuning result as passed to the result callback: the kernel name, the execution time in
+// milliseconds (the maximum float value if the kernel did not run), the total number of threads,
+// whether the output was verified to be correct, the outcome, the drift of the device (see
+// SetDriftControl), and the values of the tuning parameters
+struct Result {
+  std::string kernel_name;
+  float time;
+  size_t threads;
+  bool status;
+  Outcome outcome;
+  float drift;
+  std::unordered_map<std::string, size_t> configuration;
+};
+using ResultCallback = std::function<void(const Result&)>;
+
+// File formats to stream results to: semicolon-separated values, one JSON object per line, or the
+// binary columnar format (see PrintBinary and ResultsReader)
+enum class ResultFormat { kCSV, kJSONLines, kBinary };
 
 // The tuner class and its public API
 class Tuner {
@@ -118,21 +156,92 @@ class Tuner {
   void PUBLIC_API SetLocalMemoryUsage(const size_t id, LocalMemoryFunction amount,
                                       const std::vector<std::string> &parameters);
 
+  // Sets how a parameter is encoded as feature(s) for the machine learning models: as its value, as
+  // the base-2 logarithm of its value, as the position of its value in its list of values (ordinal),
+  // or as one feature per value (one-hot, for categorical parameters).
+  void PUBLIC_API SetFeatureEncoding(const size_t id, const std::string &parameter_name,
+                                     const Encoding encoding);
+
+  // Adds derived features for the machine learning models: the number of threads per work-group and
+  // in total (computed from the thread-size modifiers) and/or the local memory usage (as given by
+  // SetLocalMemoryUsage).
+  void PUBLIC_API AddDerivedFeatures(const size_t id, const bool thread_counts,
+                                     const bool local_memory);
+
   // Functions to add kernel-arguments for input buffers, output buffers, and scalars. Make sure to
   // call these in the order in which the arguments appear in the kernel.
   template <typename T> void AddArgumentInput(const std::vector<T> &source);
   template <typename T> void AddArgumentOutput(const std::vector<T> &source);
   template <typename T> void AddArgumentScalar(const T argument);
 
+  // Multi-fidelity tuning (successive halving). Adds a lower-fidelity level and returns its ID. The
+  // candidates of the search method are first measured at the first level. After each level, only
+  // the best 'promote_fraction' of them is promoted to the next level, the full problem being the
+  // final level. Each level runs the kernels 'num_runs' times and can optionally use a smaller
+  // problem: a different global size per kernel and a separate set of kernel arguments (to be added
+  // in the same order as the regular kernel arguments).
+  size_t PUBLIC_API AddFidelityLevel(const double promote_fraction, const size_t num_runs);
+  void PUBLIC_API SetFidelityGlobalSize(const size_t level, const size_t id, const IntRange &global);
+  template <typename T> void AddFidelityArgumentInput(const size_t level, const std::vector<T> &source);
+  template <typename T> void AddFidelityArgumentOutput(const size_t level, const std::vector<T> &source);
+  template <typename T> void AddFidelityArgumentScalar(const size_t level, const T argument);
+
   // Configures a specific search method. The default search method is "FullSearch". These are
   // implemented as separate functions since they each take a different number of arguments.
   void PUBLIC_API UseFullSearch();
   void PUBLIC_API UseRandomSearch(const double fraction);
+  void PUBLIC_API UseRandomSampling(const double fraction);
   void PUBLIC_API UseAnnealing(const double fraction, const double max_temperature);
   void PUBLIC_API UsePSO(const double fraction, const size_t swarm_size, const double influence_global,
                          const double influence_local, const double influence_random);
+  void PUBLIC_API UseActiveLearning(const double fraction, const Model model_type,
+                                    const size_t batch_size, const double exploration_fraction);
+  void PUBLIC_API UseHillClimbing(const double fraction);
+  void PUBLIC_API UseCoordinateDescent(const double fraction);
+  void PUBLIC_API UseDifferentialEvolution(const double fraction, const size_t population_size,
+                                           const double differential_weight,
+                                           const double crossover_rate);
+  void PUBLIC_API UseTabuSearch(const double fraction, const size_t tabu_tenure,
+                                const size_t neighbourhood_size);
+
+  // Replays the configurations of a search log (as written by OutputSearchLog) in the same order,
+  // for example to re-measure a search path after a driver upgrade. Each kernel replays its own
+  // section of the log.
+  void PUBLIC_API UseReplay(const std::string &search_log_filename);
+
+  // Sets the seed of the random number generators of all search methods (and of the models). By
+  // default, the seed is based on the time. Runs with the same seed propose the same configurations
+  // given the same measurements.
+  void PUBLIC_API SetSeed(const unsigned int seed);
+
+  // Sets the threshold on the predicted probability that a configuration fails to compile or launch
+  // above which the search methods skip it. The prediction is learned from the failures so far.
+  // Setting it to 1.0 disables skipping. Full search and replay never skip configurations.
+  void PUBLIC_API SetFailureThreshold(const double probability);
+
+  // Seeds the search method with the best configurations of earlier tuning sessions, as stored by
+  // PrintJSON. Per kernel, up to 'num_configurations' of those which are valid in the current search
+  // space are explored first (or used as initial state, for annealing and PSO).
+  void PUBLIC_API WarmStart(const std::vector<std::string> &json_files,
+                            const size_t num_configurations);
 
-  // Outputs the search process to a file
+  // Imports the results of an earlier tuning session from a file as written by PrintJSON,
+  // PrintToFile, or a CSV or JSON-lines result sink. Configurations of which a result is known,
+  // including failed ones, are then answered from these results instead of being measured again.
+  // Results only apply to kernels with the same name and source-code on a device with the same name
+  // (if the file records these). Multiple files can be imported; later results take precedence.
+  // With multi-fidelity tuning, known configurations skip the fidelity levels.
+  void PUBLIC_API ImportResults(const std::string &filename);
+
+  // As above, but for results measured before some parameters became part of the search space, e.g.
+  // when a parameter is added which the kernel used to get from a fallback #define. The 'defaults'
+  // give the values these parameters had in the imported results. Results which lack a parameter
+  // without a default are only used if the parameter has a single value or isn't used by the
+  // kernel.
+  void PUBLIC_API ImportResults(const std::string &filename,
+                                const std::unordered_map<std::string, size_t> &defaults);
+
+  // Outputs the search process to a file, with one section per kernel
   void PUBLIC_API OutputSearchLog(const std::string &filename);
 
   // Starts the tuning process: compile all kernels and run them for each permutation of the tuning-
@@ -145,6 +254,37 @@ class Tuner {
   void PUBLIC_API ModelPrediction(const Model model_type, const float validation_fraction,
                                   const size_t test_top_x_configurations);
 
+  // Saves the model trained by ModelPrediction for kernel 'id' to file. It can be loaded again as a
+  // PerformanceModel (see below).
+  void PUBLIC_API SaveModel(const size_t id, const std::string &filename) const;
+
+  // Enables hyperparameter selection for the machine learning models (ModelPrediction and active
+  // learning): a small grid of settings is evaluated using k-fold cross-validation with 'num_folds'
+  // folds and the best is kept. Passing zero disables it (the default).
+  void PUBLIC_API SetCrossValidation(const size_t num_folds);
+
+  // Makes ModelPrediction train an ensemble of 'num_models' models on bootstrap samples of the data
+  // (in parallel) instead of a single model. The configurations to verify are then selected using
+  // the mean and the spread of their predictions, according to the acquisition strategy. The factor
+  // 'kappa' is the multiple of the standard deviation for the confidence bounds.
+  void PUBLIC_API SetModelEnsemble(const size_t num_models, const Acquisition acquisition,
+                                   const double kappa);
+
+  // Calls 'callback' with every result (including failed ones) as soon as its configuration has
+  // been measured, e.g. to store it elsewhere or to monitor progress. Replaces an earlier callback.
+  void PUBLIC_API SetResultCallback(ResultCallback callback);
+
+  // As above, but streams every result to a file in the given format. The files are opened (and
+  // overwritten) when tuning starts and receive the results of all following calls to Tune and
+  // ModelPrediction. Multiple files can be added.
+  void PUBLIC_API AddResultSink(const ResultFormat format, const std::string &filename);
+
+  // Sets whether the results are kept in memory (the default). Otherwise, memory stays bounded for
+  // long or unbounded runs: only the best result and the candidates for the finalist stage are kept.
+  // The results are then only available through the callback and the sinks; the printing functions
+  // other than PrintFormatted have none to print and ModelPrediction cannot be used.
+  void PUBLIC_API SetRetainResults(const bool retain);
+
   // Retrieves the parameters of the best tuning result
   std::unordered_map<std::string, size_t> GetBestResult() const;
 
@@ -156,12 +296,34 @@ class Tuner {
                             const std::vector<std::pair<std::string,std::string>> &descriptions) const;
   void PUBLIC_API PrintToFile(const std::string &filename) const;
 
+  // Writes all results (including failed ones) to file in a binary columnar format, which can be
+  // read using the ResultsReader class (see below)
+  void PUBLIC_API PrintBinary(const std::string &filename) const;
+
   // Disables all further printing to stdout
   void PUBLIC_API SuppressOutput();
 
   // Changes the number of times each kernel should be run. Used for averaging execution times.
   void PUBLIC_API SetNumRuns(const size_t num_runs);
 
+  // Sets a budget for the tuning process, which holds for all search methods. Tuning stops as soon
+  // as the wall-clock time (in seconds) or the number of kernel evaluations is exceeded. The search
+  // for a kernel also stops after a number of evaluations without improving the best execution time
+  // by more than a given percentage. Passing zero disables a criterion (the default).
+  void PUBLIC_API SetMaxTuningTime(const double seconds);
+  void PUBLIC_API SetMaxEvaluations(const size_t num_evaluations);
+  void PUBLIC_API SetEarlyStopping(const size_t num_evaluations, const double min_improvement);
+
+  // Enables the finalist stage: after the search, the best 'num_finalists' configurations of each
+  // kernel are measured again 'num_rounds' times in random order. The best result is then the
+  // finalist which is most often significantly faster than the others (Mann-Whitney U test).
+  void PUBLIC_API SetFinalists(const size_t num_finalists, const size_t num_rounds);
+
+  // Enables drift compensation: the first successful configuration of a kernel is measured again
+  // after every 'interval' evaluations. Its execution time relative to the first measurement is
+  // stored with each following result and optionally used to normalize their execution times.
+  void PUBLIC_API SetDriftControl(const size_t interval, const bool normalize);
+
  private:
 
   // This implements the pointer to implementation idiom (pimpl) and hides all private functions and
@@ -169,6 +331,89 @@ class Tuner {
   std::unique_ptr<TunerImpl> pimpl;
 };
 
+// =================================================================================================
+
+// A performance model of a kernel as saved by the tuner (see SaveModel). It predicts the execution
+// times of configurations without running them, and does not require an OpenCL/CUDA device.
+class PerformanceModel {
+ public:
+
+  // Loads the model from file
+  explicit PUBLIC_API PerformanceModel(const std::string &filename);
+  PUBLIC_API ~PerformanceModel();
+
+  // Retrieves the name of the kernel and the names of its parameters
+  std::string PUBLIC_API GetKernelName() const;
+  std::vector<std::string> PUBLIC_API GetParameterNames() const;
+
+  // Predicts the execution time in milliseconds of a configuration, given as a map of parameter
+  // names to values (as returned by the tuner's GetBestResult)
+  float PUBLIC_API Predict(const std::unordered_map<std::string, size_t> &configuration) const;
+
+  // As above, but for multiple configurations at once
+  std::vector<float> PUBLIC_API PredictBatch(
+      const std::vector<std::unordered_map<std::string, size_t>> &configurations) const;
+
+ private:
+
+  // This implements the pointer to implementation idiom (pimpl)
+  std::unique_ptr<PerformanceModelImpl> pimpl;
+};
+
+// =================================================================================================
+
+// A reader of results in the binary columnar format (see PrintBinary). The file is memory-mapped
+// and its results are accessed per block of results of a single kernel. The columns of a block
+// point directly into the file, such that tools can scan or filter the results without copying or
+// parsing them. A block which is cut off (e.g. of a file which is still being written) is ignored.
+class ResultsReader {
+ public:
+
+  // A block of results: the ID of the kernel, the number of results, and the columns. The value
+  // indices are given per parameter of the kernel and refer to the parameter's values (see
+  // GetParameterValues), or are UINT32_MAX if a parameter is missing. The status is 1 for a correct
+  // result and 0 otherwise. The outcome is 0 for success, 1 for a compilation failure, 2 for a
+  // launch failure, 3 for a verification failure, and 4 for a predicted failure.
+  struct Block {
+    size_t kernel_id;
+    size_t num_results;
+    const float* times;
+    const float* drifts;
+    std::vector<const uint32_t*> value_indices;
+    const uint8_t* statuses;
+    const uint8_t* outcomes;
+  };
+
+  // Opens and memory-maps the file and reads its header
+  explicit PUBLIC_API ResultsReader(const std::string &filename);
+  PUBLIC_API ~ResultsReader();
+
+  // Retrieves the information of the device as key-value pairs (as in the JSON output)
+  std::vector<std::pair<std::string,std::string>> PUBLIC_API GetDeviceInfo() const;
+
+  // Retrieves the number of kernels, their names, the names of their parameters, and the values of
+  // a parameter
+  size_t PUBLIC_API NumKernels() const;
+  std::string PUBLIC_API GetKernelName(const size_t kernel_id) const;
+  std::vector<std::string> PUBLIC_API GetParameterNames(const size_t kernel_id) const;
+  std::vector<size_t> PUBLIC_API GetParameterValues(const size_t kernel_id,
+                                                    const size_t parameter_id) const;
+
+  // Retrieves the number of blocks, a block, and the total number of results
+  size_t PUBLIC_API NumBlocks() const;
+  Block PUBLIC_API GetBlock(const size_t block_id) const;
+  size_t PUBLIC_API NumResults() const;
+
+  // Retrieves the configuration of a result of a block as parameter names and values
+  std::unordered_map<std::string, size_t> PUBLIC_API GetConfiguration(const Block &block,
+                                                                      const size_t result) const;
+
+ private:
+
+  // This implements the pointer to implementation idiom (pimpl)
+  std::unique_ptr<ResultsReaderImpl> pimpl;
+};
+
 // =================================================================================================
 } // namespace cltune
 
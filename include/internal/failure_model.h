@@ -0,0 +1,78 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the FailureModel class, a lightweight classifier which predicts whether a
+// configuration will fail to compile or to launch. It is a naive Bayes classifier with the value of
+// each parameter as a feature: it counts the failures and successes per parameter value and combines
+// these assuming independence between the parameters. Unseen values are handled by add-one
+// smoothing. Predictions are only made once enough outcomes (including a failure) are observed.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_FAILURE_MODEL_H_
+#define CLTUNE_FAILURE_MODEL_H_
+
+#include <vector>
+#include <unordered_map>
+
+#include "internal/kernel_info.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class FailureModel {
+ public:
+
+  // Minimum number of observed outcomes before predicting anything
+  static const size_t kMinObservations;
+
+  // Initializes an empty model
+  FailureModel();
+
+  // Adds the outcome of a measured configuration
+  void Add(const KernelInfo::Configuration &configuration, const bool failed);
+
+  // Returns the predicted probability that a configuration fails. Returns zero if there is not
+  // enough data yet.
+  double Probability(const KernelInfo::Configuration &configuration) const;
+
+ private:
+
+  // Helper structure holding the number of failures and successes for a parameter value
+  struct Counts {
+    size_t failures;
+    size_t successes;
+  };
+
+  // The observed outcomes in total and per parameter (by position) and value
+  size_t num_failures_;
+  size_t num_successes_;
+  std::vector<std::unordered_map<size_t,Counts>> counts_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_FAILURE_MODEL_H_
+#endif
@@ -0,0 +1,96 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the FeatureEncoder class, which turns a configuration into the features used
+// by the machine learning models. Each parameter is encoded according to its encoding: its value,
+// the base-2 logarithm of its value (e.g. for tile sizes), the position of its value in its list of
+// values (ordinal), or one feature per value (one-hot, for categorical parameters). Optionally, the
+// encoder adds derived features: the number of threads per work-group and in total (computed from
+// the thread-size modifiers) and the local memory usage. These are multiplicative quantities, so
+// their base-2 logarithm is used.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_FEATURE_ENCODER_H_
+#define CLTUNE_FEATURE_ENCODER_H_
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "internal/kernel_info.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class FeatureEncoder {
+ public:
+
+  // Initializes the encoder for a kernel. The kernel is used to compute the derived features and
+  // has to outlive the encoder.
+  explicit FeatureEncoder(const KernelInfo &kernel);
+
+  // Initializes the encoder from a stream as written by Save. This does not require a kernel (or a
+  // device), but only supports encoders without derived features.
+  explicit FeatureEncoder(std::istream &file);
+
+  // Saves the parameters and their encodings to a stream. Throws for encoders with derived
+  // features, since these require the kernel to compute.
+  void Save(std::ostream &file) const;
+
+  // Retrieves the number of features per configuration
+  size_t NumFeatures() const { return num_features_; }
+
+  // Retrieves the parameters (with resolved encodings)
+  const std::vector<KernelInfo::Parameter>& parameters() const { return parameters_; }
+
+  // Encodes a configuration as a vector of features. The settings are expected in the same order as
+  // the parameters of the kernel. This doesn't modify the kernel and can be called from multiple
+  // threads at once.
+  std::vector<float> Encode(const KernelInfo::Configuration &configuration) const;
+
+  // As above, but writes the features into existing storage (e.g. a row of a feature matrix)
+  void Encode(const KernelInfo::Configuration &configuration, float* features) const;
+
+ private:
+
+  // Counts the features of the parameters and the derived features
+  void CountFeatures();
+
+  // Resolves the automatic encoding: logarithmic if all values are powers of two, linear otherwise
+  static Encoding ResolveEncoding(const KernelInfo::Parameter &parameter);
+
+  // The kernel and its parameters with their (resolved) encodings
+  const KernelInfo *kernel_;
+  std::vector<KernelInfo::Parameter> parameters_;
+  bool thread_counts_;
+  bool local_memory_;
+  size_t num_features_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_FEATURE_ENCODER_H_
+#endif
@@ -57,10 +57,11 @@ class KernelInfo {
   // Enumeration of modifiers to global/local thread-sizes
   enum class ThreadSizeModifierType { kGlobalMul, kGlobalDiv, kLocalMul, kLocalDiv };
 
-  // Helper structure holding a parameter name and a list of all values
+  // Helper structure holding a parameter name, a list of all values, and its feature encoding
   struct Parameter {
     std::string name;
     std::vector<size_t> values;
+    Encoding encoding;
   };
 
   // Helper structure holding a setting: a name and a value. Multiple settings combined make a
@@ -112,6 +113,8 @@ class KernelInfo {
   IntRange global() const { return global_; }
   IntRange local() const { return local_; }
   std::vector<Configuration> configurations() { return configurations_; }
+  bool derived_thread_counts() const { return derived_thread_counts_; }
+  bool derived_local_memory() const { return derived_local_memory_; }
 
   // Accessors (setters) - Note that these also pre-set the final global/local size
   void set_global_base(IntRange global) { global_base_ = global; global_ = global; }
@@ -140,23 +143,59 @@ class KernelInfo {
   // As above, but for local memory usage
   void PUBLIC_API SetLocalMemoryUsage(LocalMemoryFunction amount, const std::vector<std::string> &parameters);
 
+  // Sets the feature encoding of a parameter for the machine learning models
+  void PUBLIC_API SetEncoding(const std::string &parameter_name, const Encoding encoding);
+
+  // Enables derived features (thread counts and/or local memory usage) for the machine learning
+  // models. Features which are already enabled stay enabled.
+  void PUBLIC_API AddDerivedFeatures(const bool thread_counts, const bool local_memory);
+
+  // Computes the local memory usage of a configuration using the user-supplied function
+  size_t PUBLIC_API LocalMemoryUsage(const Configuration &config) const;
+
   // Computes the global/local ranges (in NDRange-form) based on all global/local thread-sizes (in
   // StringRange-form) and a single permutation (i.e. a configuration) containing a list of all
   // parameter names and their current values.
   void PUBLIC_API ComputeRanges(const Configuration &config);
 
+  // As above, but returns the ranges instead of storing them. This doesn't modify the kernel, such
+  // that it can be used from multiple threads (e.g. to encode configurations for a model).
+  void PUBLIC_API ComputeRanges(const Configuration &config, IntRange &global,
+                                IntRange &local) const;
+
   // Computes all permutations based on the parameters and their values (the configuration list).
   // The result is stored as a member variable.
   void PUBLIC_API SetConfigurations();
+
+  // Retrieves the size of the unconstrained search space: the product of the number of values of
+  // all parameters. This does not require the configurations to be computed.
+  size_t PUBLIC_API NumRawConfigurations() const;
+
+  // Decodes an index into the unconstrained search space into a configuration. The ordering is the
+  // same as used by SetConfigurations, i.e. the last parameter changes fastest.
+  Configuration PUBLIC_API ConfigurationFromIndex(const size_t index) const;
+
+  // The inverse of the above: encodes a configuration as an index into the unconstrained search
+  // space. Returns NumRawConfigurations() if a value is not part of the parameter's values.
+  size_t PUBLIC_API IndexFromConfiguration(const Configuration &config) const;
+
+  // Computes a hash of the source-code (64-bit FNV-1a, as a hexadecimal string). This identifies
+  // the kernel's code across tuning sessions, e.g. to match results of an earlier session.
+  std::string PUBLIC_API SourceHash() const;
+
+  // Returns whether or not the value of a parameter can affect the kernel: whether its name is used
+  // in the source-code or by a thread-size modifier. The values of unused parameters only matter
+  // for the constraints.
+  bool PUBLIC_API UsesParameter(const std::string &name) const;
+
+  // Returns whether or not a given configuration is valid. This check is based on the user-supplied
+  // constraints and on the device limits. Note that this also updates the global/local ranges.
+  bool PUBLIC_API ValidConfiguration(const Configuration &config);
   
  private:
   // Called recursively internally by SetConfigurations 
   void PopulateConfigurations(const size_t index, const Configuration &config);
 
-  // Returns whether or not a given configuration is valid. This check is based on the user-supplied
-  // constraints.
-  bool ValidConfiguration(const Configuration &config);
-
   // Member variables
   std::string name_;
   std::string source_;
@@ -175,6 +214,10 @@ class KernelInfo {
 
   // Multipliers and dividers for global/local thread-sizes
   std::vector<ThreadSizeModifier> thread_size_modifiers_;
+
+  // Derived features for the machine learning models
+  bool derived_thread_counts_;
+  bool derived_local_memory_;
 };
 
 // =================================================================================================
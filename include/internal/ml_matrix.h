@@ -0,0 +1,112 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the Matrix class used by the machine learning models: a dense matrix stored
+// contiguously in row-major order. It also contains the matrix-vector (GEMV) and matrix-matrix
+// (GEMM) routines used for training and prediction. Their inner loops run over contiguous memory
+// with unit stride, such that the compiler can vectorize them.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_ML_MATRIX_H_
+#define CLTUNE_ML_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+template <typename T>
+class Matrix {
+ public:
+
+  // Initializes an empty matrix, a matrix of a given size, or a matrix from a vector of rows
+  Matrix();
+  Matrix(const size_t rows, const size_t cols, const T value = static_cast<T>(0));
+  explicit Matrix(const std::vector<std::vector<T>> &rows);
+
+  // Accessors
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  T& operator()(const size_t row, const size_t col) { return data_[row*cols_ + col]; }
+  const T& operator()(const size_t row, const size_t col) const { return data_[row*cols_ + col]; }
+  T* row(const size_t row) { return &data_[row*cols_]; }
+  const T* row(const size_t row) const { return &data_[row*cols_]; }
+  std::vector<T>& data() { return data_; }
+  const std::vector<T>& data() const { return data_; }
+
+  // Changes the size of the matrix. The contents are undefined afterwards.
+  void Resize(const size_t rows, const size_t cols);
+
+  // Appends a row (of 'cols' values) to the matrix, keeping the existing contents
+  void AddRow(const T* values);
+
+ private:
+  size_t rows_;
+  size_t cols_;
+  std::vector<T> data_;
+};
+
+// =================================================================================================
+
+// Dot product of two vectors of length n
+template <typename T>
+T Dot(const T* a, const T* b, const size_t n);
+
+// Transposes a matrix: B = A^T. The matrix B is resized as needed.
+template <typename T>
+void Transpose(const Matrix<T> &a, Matrix<T> &b);
+
+// Matrix-vector multiplications: y = A*x and y = A^T*x. The vector y is resized as needed.
+template <typename T>
+void Gemv(const Matrix<T> &a, const std::vector<T> &x, std::vector<T> &y);
+template <typename T>
+void GemvTransposed(const Matrix<T> &a, const std::vector<T> &x, std::vector<T> &y);
+
+// Matrix-matrix multiplications: C = A*B, C = A*B^T, and C = A^T*B. The matrix C is resized as
+// needed.
+template <typename T>
+void Gemm(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+template <typename T>
+void GemmNT(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+template <typename T>
+void GemmTN(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+
+// Solves A*x = b for a symmetric positive-definite matrix A using a Cholesky decomposition. The
+// matrix A is overwritten by its decomposition and b by the solution. Returns false (leaving b
+// undefined) if A is not positive definite.
+template <typename T>
+bool CholeskySolve(Matrix<T> &a, std::vector<T> &b);
+
+// Inverts a symmetric positive-definite matrix A in place using a Cholesky decomposition. Returns
+// false (leaving A undefined) if A is not positive definite.
+template <typename T>
+bool CholeskyInvert(Matrix<T> &a);
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_ML_MATRIX_H_
+#endif
@@ -33,10 +33,15 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <iostream>
+#include <memory>
 
 // For output formatting messages
 #include "internal/tuner_impl.h"
 
+// The matrix type of the training data and the weights
+#include "internal/ml_matrix.h"
+
 namespace cltune {
 // =================================================================================================
 
@@ -47,33 +52,80 @@ class MLModel {
 
   // Constants
   static constexpr auto kGradientDescentCostReportAmount = 10;
+  static const size_t kPredictChunkRows; // Samples pre-processed and predicted at once
+  static const size_t kMinPredictionsPerThread;
 
   // Constructor
   MLModel(const bool debug_display);
 
+  // Limits the number of threads used for training and prediction, which is one per hardware thread
+  // by default. Models which are trained in parallel with others use a single thread each.
+  void SetMaxThreads(const size_t max_threads);
+
+  // The number of hardware threads (at least one)
+  static size_t HardwareThreads();
+
   // Trains and validates the model
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) = 0;
   virtual void Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) = 0;
 
-  // Pure virtual prediction function: predicts 'y' based on 'x' and the learning parameters 'theta'
-  virtual T Predict(const std::vector<T> &x) const = 0;
+  // Incrementally updates a trained model with new samples instead of re-training it from scratch.
+  // The normalizations of the features stay as computed when training. Returns false if the model
+  // can't be updated (the default), in which case it has to be re-trained instead.
+  virtual bool Update(const std::vector<std::vector<T>> &x, const std::vector<T> &y);
+
+  // Prediction function: predicts 'y' based on 'x' and the learning parameters 'theta'
+  virtual T Predict(const std::vector<T> &x) const;
+
+  // Batched prediction of all samples (the rows of 'x'). The samples are divided over threads, which
+  // process them in chunks of rows.
+  std::vector<T> PredictBatch(const Matrix<T> &x) const;
+
+  // Writes the features of a sample (given by its index) into a row of a chunk
+  using SampleEncoder = std::function<void(const size_t sample, T* features)>;
+
+  // As above, but the 'm' samples of 'n' features each are encoded chunk by chunk by the threads
+  // themselves, such that encoding is parallel as well and the features of all samples are never
+  // stored at once. The encoder has to be thread-safe.
+  std::vector<T> PredictBatch(const size_t m, const size_t n, const SampleEncoder &encode) const;
+
+  // Divides 'm' samples over at most 'max_threads' threads, which call 'process(begin, end)' for
+  // consecutive chunks of at most kPredictChunkRows samples. Passes on the first error of any of
+  // the threads.
+  static void ForEachChunk(const size_t m, const size_t max_threads,
+                           const std::function<void(size_t, size_t)> &process);
+
+  // Pure virtual function to pre-process and predict a chunk of samples at once (the chunk may be
+  // modified). This has to be thread-safe.
+  virtual std::vector<T> PredictRows(Matrix<T> &x) const = 0;
+
+  // Saves the trained model (its type, the normalization data, and the learned parameters) to a
+  // stream as text. Loading creates a model of the saved type, ready for prediction.
+  void Save(std::ostream &file) const;
+  static std::unique_ptr<MLModel<T>> Load(std::istream &file);
 
  protected:
-  // Process the training data in various ways
-  void ComputeNormalizations(const std::vector<std::vector<T>> &x);
-  void NormalizeFeatures(std::vector<std::vector<T>> &x) const;
-  void AddPolynomialFeatures(std::vector<std::vector<T>> &x, const std::vector<size_t> &orders) const;
+  // Process the training data in various ways. Adding polynomial features returns a new matrix,
+  // since the number of columns changes.
+  void ComputeNormalizations(const Matrix<T> &x);
+  void NormalizeFeatures(Matrix<T> &x) const;
+  Matrix<T> AddPolynomialFeatures(const Matrix<T> &x, const std::vector<size_t> &orders) const;
   void AddPolynomialRecursive(std::vector<T> &xi, const size_t order, const T value,
-                              const size_t n) const;
+                              const size_t first, const size_t n) const;
 
   // Methods to minimize an unconstrained function
-  void GradientDescent(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
+  void GradientDescent(const Matrix<T> &x, const std::vector<T> &y,
                        const T alpha, const T lambda, const size_t iterations);
 
+  // As above, but passes over the shuffled samples in minibatches of 'batch_size' rows, updating the
+  // weights after each minibatch. The number of iterations is given in epochs (passes over the data).
+  void MinibatchGradientDescent(const Matrix<T> &x, const std::vector<T> &y,
+                                const T alpha, const T lambda, const size_t epochs,
+                                const size_t batch_size, const unsigned int seed);
+
   // Verification methods
-  float SuccessRate(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
-                    const float margin) const;
-  float Verify(const std::vector<std::vector<T>> &x, const std::vector<T> &y) const;
+  float SuccessRate(const Matrix<T> &x, const std::vector<T> &y, const float margin) const;
+  float Verify(const Matrix<T> &x, const std::vector<T> &y) const;
 
   // Pre and post-processing of data
   virtual T PostProcessExecutionTime(T value) const = 0;
@@ -81,12 +133,24 @@ class MLModel {
   // Pure virtual function for weights initialization
   virtual void InitializeTheta(const size_t n) = 0;
 
-  // Pure virtual hypothesis, cost and gradient functions: to be implemented by derived classes
-  virtual T Hypothesis(const std::vector<T> &x) const = 0;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const = 0;
-  virtual void Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) = 0;
+  // Pure virtual functions to identify the type of model and to save and load its learned weights
+  virtual std::string Name() const = 0;
+  virtual void SaveParameters(std::ostream &file) const = 0;
+  virtual void LoadParameters(std::istream &file) = 0;
+
+  // Helpers to save and load a vector or a matrix as its size(s) followed by its values
+  static void SaveVector(std::ostream &file, const std::vector<T> &values);
+  static std::vector<T> LoadVector(std::istream &file);
+  static void SaveMatrix(std::ostream &file, const Matrix<T> &matrix);
+  static Matrix<T> LoadMatrix(std::istream &file);
+
+  // Pure virtual hypothesis, cost and gradient functions: to be implemented by derived classes. These
+  // process all samples (the rows of 'x') at once. The gradient function performs a single forward
+  // pass and updates the weights.
+  virtual std::vector<T> Hypothesis(const Matrix<T> &x) const = 0;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const = 0;
+  virtual void Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                        const std::vector<T> &y) = 0;
 
   // Information for normalization
   std::vector<T> ranges_;
@@ -94,6 +158,7 @@ class MLModel {
 
   // Settings
   const bool debug_display_;
+  size_t max_threads_;
 };
 
 // =================================================================================================
@@ -0,0 +1,157 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains a gradient-boosted decision trees model, derived from the base machine learning
+// class. Each tree is fitted to the residuals of the trees before it. Splits are found using
+// histograms: the features are binned once (the tuning parameters typically have only a few distinct
+// values), after which each candidate split of a tree node is evaluated per bin instead of per
+// sample. The split search of a node is divided over threads by feature.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_ML_MODELS_GRADIENT_BOOSTED_TREES_H_
+#define CLTUNE_ML_MODELS_GRADIENT_BOOSTED_TREES_H_
+
+#include <vector>
+#include <cstdint>
+
+// Machine learning base class
+#include "internal/ml_model.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+template <typename T>
+class GradientBoostedTrees: public MLModel<T> {
+ public:
+
+  // Maximum number of histogram bins per feature and the minimum amount of work (samples times
+  // features) per thread for the split search
+  static const size_t kMaxBins;
+  static const size_t kMinWorkPerThread;
+
+  // Methods from the base class
+  using MLModel<T>::GradientDescent;
+  using MLModel<T>::Verify;
+  using MLModel<T>::SaveVector;
+  using MLModel<T>::LoadVector;
+
+  // Variables from the base class
+  using MLModel<T>::debug_display_;
+  using MLModel<T>::max_threads_;
+
+  // Constructor. Each tree is scaled by the learning rate (shrinkage). Nodes are split until the
+  // maximum depth is reached or until a split would leave fewer samples in a leaf than the minimum.
+  GradientBoostedTrees(const size_t num_trees, const T learning_rate, const size_t max_depth,
+                       const size_t min_samples_leaf, const T lambda, const bool debug_display);
+
+  // Trains and validates the model
+  virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
+  virtual void Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
+
+  // Prediction of a single sample (batches are predicted level-by-level, see Hypothesis)
+  virtual T Predict(const std::vector<T> &x) const override;
+
+ private:
+  // A node of a tree: either a leaf with a value, or a split on a feature (samples with a value up
+  // to and including the threshold go to the left child). Both children of a leaf are the leaf.
+  struct Node {
+    bool leaf;
+    T value;
+    size_t feature;
+    T threshold;
+    size_t left;
+    size_t right;
+  };
+  using Tree = std::vector<Node>;
+
+  // The best split of a node found so far: the bin of a feature after which to split
+  struct Split {
+    double gain;
+    size_t feature;
+    size_t bin;
+  };
+
+  // Pre and post-processing of data
+  void PreProcessExecutionTimes(std::vector<T> &y) const;
+  virtual T PostProcessExecutionTime(T value) const override;
+
+  // Predicts a chunk of samples
+  virtual std::vector<T> PredictRows(Matrix<T> &x) const override;
+
+  // Computes the bin edges of all features and the bin of each training sample
+  void ComputeBins(const Matrix<T> &x);
+
+  // Removes all trees
+  virtual void InitializeTheta(const size_t n) override;
+
+  // Saving and loading of the learned parameters
+  virtual std::string Name() const override { return "gradient_boosted_trees"; }
+  virtual void SaveParameters(std::ostream &file) const override;
+  virtual void LoadParameters(std::istream &file) override;
+
+  // Hypothesis and cost functions. The gradient function fits a new tree to the residuals of the
+  // training data (the negative gradient of the squared error) and adds it to the model.
+  virtual std::vector<T> Hypothesis(const Matrix<T> &x) const override;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const override;
+  virtual void Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                        const std::vector<T> &y) override;
+
+  // Recursively builds a (sub-)tree of the samples 'begin' up to 'end' of the sample indices
+  size_t BuildNode(Tree &tree, const size_t begin, const size_t end, const size_t depth,
+                   const T lambda, const T alpha);
+
+  // Finds the best split of the samples 'begin' up to 'end' over the features 'feature_begin' up to
+  // 'feature_end' using per-feature histograms
+  void FindSplit(const size_t begin, const size_t end, const size_t feature_begin,
+                 const size_t feature_end, const double lambda, Split &split) const;
+
+  // Passes a single sample through a tree
+  T Evaluate(const Tree &tree, const T* x) const;
+
+  // The trees and the initial prediction (the mean of the training data)
+  std::vector<Tree> trees_;
+  T base_;
+
+  // Training data: the upper edges of the bins per feature, the bin per sample (stored per feature),
+  // the sample indices (partitioned per tree node), the current predictions, and the residuals
+  std::vector<std::vector<T>> edges_;
+  std::vector<uint8_t> bins_;
+  std::vector<size_t> indices_;
+  std::vector<T> predictions_;
+  std::vector<T> residuals_;
+
+  // Settings
+  size_t num_trees_;
+  T learning_rate_;
+  size_t max_depth_;
+  size_t min_samples_leaf_;
+  T lambda_; // Regularization parameter of the leaf values
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_ML_MODELS_GRADIENT_BOOSTED_TREES_H_
+#endif
@@ -47,12 +47,33 @@ class LinearRegression: public MLModel<T> {
   using MLModel<T>::AddPolynomialFeatures;
   using MLModel<T>::GradientDescent;
   using MLModel<T>::Verify;
+  using MLModel<T>::SaveVector;
+  using MLModel<T>::LoadVector;
 
   // Variables from the base class
   using MLModel<T>::means_;
   using MLModel<T>::ranges_;
+  using MLModel<T>::debug_display_;
 
-  // Constructor
+  // Solvers: the closed-form solution of the (ridge-regularized) normal equations or gradient descent
+  enum class Solver { kNormalEquations, kGradientDescent };
+
+  // Above this number of features (including polynomial ones), the normal equations are too costly
+  // to solve and gradient descent is used instead
+  static const size_t kMaxNormalEquationsFeatures;
+
+  // Above this number of features, the inverse of the normal equations matrix is not kept for
+  // incremental updates (it takes quadratic memory)
+  static const size_t kMaxRecursiveFeatures;
+
+  // Default settings of gradient descent (for the fall-back)
+  static const size_t kDefaultLearningIterations;
+  static const T kDefaultLearningRate;
+
+  // Constructor using the normal equations, with only a regularization parameter
+  LinearRegression(const T lambda, const bool debug_display);
+
+  // Constructor using gradient descent with a given number of iterations and learning rate
   LinearRegression(const size_t learning_iterations, const T learning_rate, const T lambda,
                    const bool debug_display);
 
@@ -60,29 +81,47 @@ class LinearRegression: public MLModel<T> {
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
   virtual void Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
 
-  // Prediction
-  virtual T Predict(const std::vector<T> &x) const override;
+  // Updates the weights with new samples using recursive least squares. This gives the same weights
+  // as solving the normal equations for all samples, at a cost of O(n^2) per sample for n features.
+  // This requires the model to be trained using the normal equations.
+  virtual bool Update(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
 
  private:
   // Pre and post-processing of data
-  void PreProcessFeatures(std::vector<std::vector<T>> &x) const;
+  void PreProcessFeatures(Matrix<T> &x) const;
   void PreProcessExecutionTimes(std::vector<T> &y) const;
   virtual T PostProcessExecutionTime(T value) const override;
 
+  // Pre-processes and predicts a chunk of samples
+  virtual std::vector<T> PredictRows(Matrix<T> &x) const override;
+
   // Initializes the weights
   virtual void InitializeTheta(const size_t n) override;
 
+  // Saving and loading of the learned parameters
+  virtual std::string Name() const override { return "linear_regression"; }
+  virtual void SaveParameters(std::ostream &file) const override;
+  virtual void LoadParameters(std::istream &file) override;
+
+  // Computes the weights directly by solving the normal equations (in double precision). Returns
+  // false if the system could not be solved.
+  bool SolveNormalEquations(const Matrix<T> &x, const std::vector<T> &y);
+
   // Hypothesis, cost and gradient functions
-  virtual T Hypothesis(const std::vector<T> &x) const override;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const override;
-  virtual void Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
+  virtual std::vector<T> Hypothesis(const Matrix<T> &x) const override;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const override;
+  virtual void Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                        const std::vector<T> &y) override;
 
   // The learned weights
   std::vector<T> theta_;
 
+  // The inverse of the regularized normal equations matrix (X^T*X + lambda*I')^-1 for recursive
+  // least squares, empty if not available
+  Matrix<double> inverse_;
+
   // Settings
+  Solver solver_;
   size_t learning_iterations_;
   T learning_rate_;
   T lambda_; // Regularization parameter
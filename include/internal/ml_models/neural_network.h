@@ -5,7 +5,10 @@
 //
 // Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
 //
-// This file contains a neural network model, derived from the base machine learning class.
+// This file contains a neural network model, derived from the base machine learning class. It is a
+// multi-layer perceptron with any number of (sigmoid) hidden layers and a single linear output. It
+// is trained with minibatch gradient descent using the Adam update rule. The backpropagation of a
+// minibatch is split over multiple threads, each with its own re-used activation buffers.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -29,10 +32,15 @@
 #define CLTUNE_ML_MODELS_NEURAL_NETWORK_H_
 
 #include <vector>
+#include <random>
+#include <memory>
 
 // Machine learning base class
 #include "internal/ml_model.h"
 
+// Threads for the gradient computation
+#include "internal/worker_pool.h"
+
 namespace cltune {
 // =================================================================================================
 
@@ -41,60 +49,116 @@ template <typename T>
 class NeuralNetwork: public MLModel<T> {
  public:
 
+  // Parameters of the Adam update rule and the minimum number of samples of a minibatch per thread
+  static const T kAdamBeta1;
+  static const T kAdamBeta2;
+  static const T kAdamEpsilon;
+  static const size_t kMinSamplesPerThread;
+
+  // Number of minibatch updates per new sample for incremental updates
+  static const size_t kUpdateStepsPerSample;
+
   // Methods from the base class
   using MLModel<T>::ComputeNormalizations;
   using MLModel<T>::NormalizeFeatures;
   using MLModel<T>::AddPolynomialFeatures;
-  using MLModel<T>::GradientDescent;
+  using MLModel<T>::MinibatchGradientDescent;
   using MLModel<T>::Verify;
+  using MLModel<T>::SaveVector;
+  using MLModel<T>::LoadVector;
+  using MLModel<T>::SaveMatrix;
+  using MLModel<T>::LoadMatrix;
 
   // Variables from the base class
   using MLModel<T>::means_;
   using MLModel<T>::ranges_;
+  using MLModel<T>::debug_display_;
+  using MLModel<T>::max_threads_;
 
-  // Constructor
+  // Constructor. The layer sizes start with the number of features and end with a single output;
+  // any number of hidden layers can be in between. The learning iterations are given in epochs. The
+  // seed is used for the random initialization of the weights and the order of the samples.
   NeuralNetwork(const size_t learning_iterations, const T learning_rate, const T lambda,
-                const std::vector<size_t> &layer_sizes, const bool debug_display);
+                const std::vector<size_t> &layer_sizes, const size_t batch_size,
+                const bool debug_display, const unsigned int random_seed);
 
   // Trains and validates the model
   virtual void Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
   virtual void Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
 
-  // Prediction
-  virtual T Predict(const std::vector<T> &x) const override;
+  // Updates the trained weights with new samples, continuing with the state of the Adam update
+  // rule. Each new sample is learned in minibatches together with randomly replayed earlier
+  // samples, such that the model doesn't forget those. This requires the model to be trained (not
+  // loaded).
+  virtual bool Update(const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
 
  private:
+  // Buffers of a single thread for a feed-forward and backpropagation pass, kept between minibatches
+  // to avoid re-allocations: the activations per layer (with bias unit except for the output layer),
+  // a scratch matrix, the deltas per layer, and the accumulated gradients per weight matrix.
+  struct Workspace {
+    std::vector<Matrix<T>> activations;
+    Matrix<T> scratch;
+    std::vector<Matrix<T>> deltas;
+    std::vector<Matrix<T>> gradients;
+  };
+
   // Pre and post-processing of data
-  void PreProcessFeatures(std::vector<std::vector<T>> &x) const;
+  void PreProcessFeatures(Matrix<T> &x) const;
   void PreProcessExecutionTimes(std::vector<T> &y) const;
   virtual T PostProcessExecutionTime(T value) const override;
 
-  // Initializes the weights
+  // Pre-processes and predicts a chunk of samples
+  virtual std::vector<T> PredictRows(Matrix<T> &x) const override;
+
+  // Initializes the weights and the state of the Adam update rule
   virtual void InitializeTheta(const size_t n) override;
 
-  // Hypothesis, cost and gradient functions
-  virtual T Hypothesis(const std::vector<T> &x) const override;
-  virtual T Cost(const size_t m, const size_t n, const T lambda,
-                 const std::vector<std::vector<T>> &x, const std::vector<T> &y) const override;
-  virtual void Gradient(const size_t m, const size_t, const T lambda, const T alpha,
-                        const std::vector<std::vector<T>> &x, const std::vector<T> &y) override;
+  // Starts the worker threads for the gradient computation if the minibatches are large enough to
+  // be divided over threads. They are stopped again after training or updating.
+  void StartWorkers();
+
+  // Saving and loading of the learned parameters
+  virtual std::string Name() const override { return "neural_network"; }
+  virtual void SaveParameters(std::ostream &file) const override;
+  virtual void LoadParameters(std::istream &file) override;
 
-  // Feed-forward helpers
-  std::vector<T> FeedForward0(const std::vector<T> &x) const;
-  std::vector<T> FeedForward1(const std::vector<T> &a0, const bool sigmoid) const;
-  std::vector<T> FeedForward2(const std::vector<T> &a1) const;
+  // Hypothesis, cost and gradient functions. The gradient function processes a single minibatch.
+  virtual std::vector<T> Hypothesis(const Matrix<T> &x) const override;
+  virtual T Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const override;
+  virtual void Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                        const std::vector<T> &y) override;
 
-  // Helpers for the sigmoid function
+  // Feed-forward pass of the samples (rows) 'begin' up to 'end' of 'x' through all layers at once
+  void FeedForward(const Matrix<T> &x, const size_t begin, const size_t end,
+                   Workspace &workspace) const;
+
+  // Feed-forward and backpropagation pass of the samples 'begin' up to 'end', storing the summed
+  // (non-regularized) gradients of those samples in the workspace
+  void Backpropagate(const Matrix<T> &x, const std::vector<T> &y, const size_t begin,
+                     const size_t end, Workspace &workspace) const;
+
+  // Helper for the sigmoid function
   T Sigmoid(const T value) const {
     return static_cast<T>(1) / (static_cast<T>(1) + static_cast<T>(exp(-value)));
   }
-  T SigmoidGradient(const T value) const {
-    return Sigmoid(value)*(static_cast<T>(1) - Sigmoid(value));
-  }
 
-  // The learned weights
-  std::vector<T> theta1_;
-  std::vector<T> theta2_;
+  // The learned weights per layer (one row per unit of the next layer, the first column is the
+  // bias) and the first and second moment estimates of the Adam update rule
+  std::vector<Matrix<T>> thetas_;
+  std::vector<Matrix<T>> moments1_;
+  std::vector<Matrix<T>> moments2_;
+  size_t adam_step_;
+
+  // Per-thread buffers and the persistent worker threads (only while training or updating)
+  std::vector<Workspace> workspaces_;
+  std::unique_ptr<WorkerPool> workers_;
+
+  // The pre-processed samples learned so far (for replay during updates) and the random number
+  // generator to select them
+  Matrix<T> x_history_;
+  std::vector<T> y_history_;
+  std::default_random_engine update_generator_;
 
   // Neural network configuration
   size_t num_layers_;
@@ -104,6 +168,8 @@ class NeuralNetwork: public MLModel<T> {
   size_t learning_iterations_;
   T learning_rate_;
   T lambda_; // Regularization parameter
+  size_t batch_size_;
+  unsigned int random_seed_;
 };
 
 // =================================================================================================
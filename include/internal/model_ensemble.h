@@ -0,0 +1,90 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the ModelEnsemble class, a set of machine learning models of the same type. A
+// single model is trained on all data. Multiple models are each trained on a bootstrap sample of
+// the data (drawn with replacement), such that the spread of their predictions is an estimate of
+// the uncertainty of the prediction. The models are trained in parallel.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_MODEL_ENSEMBLE_H_
+#define CLTUNE_MODEL_ENSEMBLE_H_
+
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#include "internal/ml_model.h"
+#include "internal/model_selection.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class ModelEnsemble {
+ public:
+
+  // Creates 'num_models' (untrained) models with the given settings. The debug display only applies
+  // to a single model.
+  ModelEnsemble(const ModelSettings &settings, const size_t num_models, const size_t num_features,
+                const bool debug_display, const unsigned int seed);
+
+  // Loads an ensemble as saved by the Save method below
+  explicit ModelEnsemble(std::istream &file);
+
+  // Trains and validates the models. Validation of multiple models is based on the mean of their
+  // predictions.
+  void Train(const std::vector<std::vector<float>> &x, const std::vector<float> &y);
+  void Validate(const std::vector<std::vector<float>> &x, const std::vector<float> &y) const;
+
+  // Predicts the mean execution time of all samples (the rows of 'x')
+  std::vector<float> PredictBatch(const Matrix<float> &x) const;
+  float Predict(const std::vector<float> &x) const;
+
+  // As above, but also computes the variance of the predictions of the models (zero for a single
+  // model)
+  void PredictBatch(const Matrix<float> &x, std::vector<float> &means,
+                    std::vector<float> &variances) const;
+
+  // As above, but the 'm' samples of 'n' features each are encoded chunk by chunk in the threads
+  // (see MLModel::PredictBatch). The encoder has to be thread-safe.
+  void PredictBatch(const size_t m, const size_t n, const MLModel<float>::SampleEncoder &encode,
+                    std::vector<float> &means, std::vector<float> &variances) const;
+
+  // Saves the number of models followed by the models themselves
+  void Save(std::ostream &file) const;
+
+  // Accessors
+  size_t size() const { return models_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<MLModel<float>>> models_;
+  unsigned int seed_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_MODEL_ENSEMBLE_H_
+#endif
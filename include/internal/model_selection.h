@@ -0,0 +1,89 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the creation of the machine learning models from their settings (the type of
+// model and its hyperparameters) and the selection of these settings. Settings are evaluated using
+// k-fold cross-validation on randomly shuffled data. The folds of all candidate settings are
+// trained in parallel.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_MODEL_SELECTION_H_
+#define CLTUNE_MODEL_SELECTION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "cltune.h"
+#include "internal/ml_model.h"
+
+namespace cltune {
+// =================================================================================================
+
+// The type of a machine learning model and its hyperparameters. Not all of them apply to all types
+// of models: the learning rate applies to the neural network (Adam) and the trees (shrinkage), the
+// hidden layers to the neural network, and the maximum depth to the trees.
+struct ModelSettings {
+  Model type;
+  float learning_rate;
+  float lambda; // Regularization parameter
+  std::vector<size_t> hidden_layers;
+  size_t max_depth;
+
+  // Describes the hyperparameters in a single line
+  std::string GetDescription() const;
+};
+
+// The default settings per type of model, as used without hyperparameter selection
+ModelSettings DefaultModelSettings(const Model type);
+
+// The candidate settings per type of model for hyperparameter selection: a small grid around the
+// default settings
+std::vector<ModelSettings> CandidateModelSettings(const Model type);
+
+// Creates an (untrained) model with the given settings for samples with 'num_features' features,
+// which uses at most 'max_threads' threads for training and prediction
+std::unique_ptr<MLModel<float>> CreateModel(const ModelSettings &settings,
+                                            const size_t num_features, const bool debug_display,
+                                            const unsigned int seed, const size_t max_threads);
+
+// Computes the k-fold cross-validation error of each of the candidate settings: the mean squared
+// error of the logarithms of the predicted execution times of the left-out folds. The samples are
+// shuffled first using the seed. All folds of all candidates are trained in parallel.
+std::vector<double> CrossValidate(const std::vector<ModelSettings> &candidates,
+                                  const std::vector<std::vector<float>> &x,
+                                  const std::vector<float> &y, const size_t num_folds,
+                                  const unsigned int seed);
+
+// Selects the candidate settings for a type of model with the lowest cross-validation error. Falls
+// back to the default settings if there are fewer samples than folds. Optionally prints the errors.
+ModelSettings SelectModelSettings(const Model type, const std::vector<std::vector<float>> &x,
+                                  const std::vector<float> &y, const size_t num_folds,
+                                  const unsigned int seed, const bool print);
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_MODEL_SELECTION_H_
+#endif
@@ -0,0 +1,121 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the ResultSink interface, which receives the tuning results one-by-one as soon
+// as their configurations have been measured, and its text-based implementations: semicolon-
+// separated values and JSON lines. These write every result as a single line and flush the file
+// afterwards, such that the results of an interrupted run are kept. The binary sink is the
+// BinaryResultsWriter (see results_writer.h).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_RESULT_SINKS_H_
+#define CLTUNE_RESULT_SINKS_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <cstdio>
+
+#include "internal/tuner_impl.h"
+
+namespace cltune {
+// =================================================================================================
+
+// Retrieves the name of an outcome as written by the text-based sinks (e.g. "compile_failure") and
+// the inverse of that, which throws for an unknown name
+std::string OutcomeName(const Outcome outcome);
+Outcome OutcomeFromName(const std::string &name);
+
+// See comment at top of file for a description of the class
+class ResultSink {
+ public:
+  virtual ~ResultSink() { }
+
+  // Receives a single result
+  virtual void Write(const TunerImpl::TunerResult &result) = 0;
+
+  // Writes any buffered results to file
+  virtual void Flush() = 0;
+};
+
+// Creates a sink of the given format. The binary format stores the device information and the
+// kernels with their parameters in its header.
+std::unique_ptr<ResultSink> CreateResultSink(
+    const ResultFormat format, const std::string &filename,
+    const std::vector<std::pair<std::string,std::string>> &device_info,
+    const std::vector<KernelInfo> &kernels);
+
+// =================================================================================================
+
+// Writes results as semicolon-separated values in the same layout as PrintToFile, extended with the
+// status, the outcome, the drift, the device, and the hash of the kernel's source-code (such that
+// the results can be imported again, see Tuner::ImportResults). A header line with the parameter
+// names is written whenever the kernel changes. The time is left empty if the kernel did not run.
+class CSVResultSink: public ResultSink {
+ public:
+  CSVResultSink(const std::string &filename, const std::string &device,
+                const std::vector<KernelInfo> &kernels);
+  ~CSVResultSink();
+
+  virtual void Write(const TunerImpl::TunerResult &result) override;
+  virtual void Flush() override;
+
+ private:
+  CSVResultSink(const CSVResultSink&) = delete;
+  CSVResultSink& operator=(const CSVResultSink&) = delete;
+
+  FILE* file_;
+  std::string device_;
+  std::unordered_map<std::string, std::string> kernel_hashes_; // Per kernel name
+  std::string kernel_name_; // The kernel of the last header line
+};
+
+// Writes every result as a JSON object on a line of its own, with the same keys as the results of
+// PrintJSON, extended with the device, the threads, the status, and the outcome. The time is null
+// if the kernel did not run.
+class JSONLinesResultSink: public ResultSink {
+ public:
+  JSONLinesResultSink(const std::string &filename, const std::string &device,
+                      const std::vector<KernelInfo> &kernels);
+  ~JSONLinesResultSink();
+
+  virtual void Write(const TunerImpl::TunerResult &result) override;
+  virtual void Flush() override;
+
+ private:
+  JSONLinesResultSink(const JSONLinesResultSink&) = delete;
+  JSONLinesResultSink& operator=(const JSONLinesResultSink&) = delete;
+
+  FILE* file_;
+  std::string device_;
+  std::unordered_map<std::string, std::string> kernel_hashes_; // Per kernel name
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_RESULT_SINKS_H_
+#endif
@@ -0,0 +1,114 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the BinaryResultsWriter class, which streams tuning results to a file in a
+// binary columnar format. The file starts with a header: a magic string, the format version, the
+// device information as key-value pairs, and per kernel its name and its parameters with their
+// values. Then follow blocks of results of a single kernel. Each block holds up to kBlockResults
+// results as fixed-width columns: the execution times, the drifts, per parameter the indices of the
+// values in the parameter's list of values, the statuses, and the outcomes. Results are buffered
+// until a block is full, the kernel changes, or the writer is flushed. Strings are stored as their
+// length followed by their characters. Numbers are stored in the byte order of the host (in
+// practice little-endian) and blocks are 8-byte aligned, such that the columns of a memory-mapped
+// file can be accessed in place (see ResultsReader). The writer is also used as a result sink.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_RESULTS_WRITER_H_
+#define CLTUNE_RESULTS_WRITER_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+
+#include "internal/tuner_impl.h"
+#include "internal/result_sinks.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class BinaryResultsWriter: public ResultSink {
+ public:
+
+  // Format constants: the magic string at the start of the file, the format version, the maximum
+  // number of results per block, the alignment of the blocks, and the value index of a parameter
+  // which is not part of a result's configuration
+  static const std::string kMagic;
+  static const uint32_t kVersion;
+  static const size_t kBlockResults;
+  static const size_t kAlignment;
+  static const uint32_t kMissingValue;
+
+  // Opens the file and writes the header
+  BinaryResultsWriter(const std::string &filename,
+                      const std::vector<std::pair<std::string,std::string>> &device_info,
+                      const std::vector<KernelInfo> &kernels);
+
+  // Writes the last block and closes the file
+  ~BinaryResultsWriter();
+
+  // Adds a result to the current block, which is written if full or if the kernel changes
+  virtual void Write(const TunerImpl::TunerResult &result) override;
+
+  // Writes the current block (if not empty) and flushes the file
+  virtual void Flush() override;
+
+ private:
+  // The writer owns the file
+  BinaryResultsWriter(const BinaryResultsWriter&) = delete;
+  BinaryResultsWriter& operator=(const BinaryResultsWriter&) = delete;
+
+  // Writes the current block
+  void WriteBlock();
+
+  // Low-level writing of raw bytes, numbers, strings, and zero-padding up to the alignment
+  void WriteBytes(const void* data, const size_t size);
+  template <typename T> void WriteValue(const T value) { WriteBytes(&value, sizeof(T)); }
+  void WriteString(const std::string &value);
+  void WritePadding();
+
+  // The file and the number of bytes written to it
+  FILE* file_;
+  size_t offset_;
+
+  // The kernels (their names and parameters) as given in the header
+  std::vector<std::string> kernel_names_;
+  std::vector<std::vector<KernelInfo::Parameter>> kernel_parameters_;
+
+  // The current block: the kernel it belongs to and its columns
+  size_t kernel_id_;
+  std::vector<float> times_;
+  std::vector<float> drifts_;
+  std::vector<std::vector<uint32_t>> value_indices_;
+  std::vector<uint8_t> statuses_;
+  std::vector<uint8_t> outcomes_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_RESULTS_WRITER_H_
+#endif
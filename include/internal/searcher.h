@@ -32,9 +32,12 @@
 #define CLTUNE_SEARCHER_H_
 
 #include <vector>
-#include <chrono>
+#include <random>
+#include <limits>
+#include <unordered_map>
 
 #include "internal/kernel_info.h"
+#include "internal/failure_model.h"
 
 namespace cltune {
 // =================================================================================================
@@ -46,6 +49,13 @@ class Searcher {
   // Short-hand for a list of configurations
   using Configurations = std::vector<KernelInfo::Configuration>;
 
+  // Number of random attempts to find an unexplored configuration before scanning for one
+  static const size_t kMaxRandomAttempts;
+
+  // The execution time given to the search algorithm for a failed configuration. This is worse than
+  // any measured time, but different from the initial value of unexplored configurations.
+  static const double kFailureTime;
+
   // Base constructor
   Searcher(const Configurations &configurations);
   virtual ~Searcher() { }
@@ -53,9 +63,23 @@ class Searcher {
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time);
 
-  // Prints the log of the search process
+  // Pushes the outcome of measuring the current configuration: the execution time in case of success
+  // and the failure time otherwise. Actual (not predicted) outcomes also train the failure model.
+  void PushOutcome(const Outcome outcome, const double execution_time);
+
+  // Returns the predicted probability that the current configuration fails to compile or launch
+  double FailureProbability() const;
+
+  // Prints the log of the search process: the measured configurations, leaving out those which were
+  // skipped as predicted failures
   void PrintLog(FILE* fp) const;
 
+  // Seeds the search with known-good configurations (e.g. from earlier tuning sessions), ordered
+  // from best to worst. By default, these are moved to the front so that they are explored first.
+  // Searchers which use the neighbour index (see below) have to override this, since moving
+  // configurations invalidates the index.
+  virtual void SetWarmStart(const Configurations &configurations);
+
   // Pure virtual functions: these are overriden by the derived classes
   virtual KernelInfo::Configuration GetConfiguration() = 0;
   virtual void CalculateNextIndex() = 0;
@@ -63,18 +87,53 @@ class Searcher {
 
  protected:
 
-  // Pseudo-random seed based on the time
-  unsigned int RandomSeed() const {
-    // std::random_device rd;
-    // return rd();
-    return static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
+  // Returns the index of the target configuration in the whole configuration list. If it is not
+  // found (an invalid configuration), the size of the configuration list is returned.
+  size_t IndexFromConfiguration(const KernelInfo::Configuration &target) const;
+
+  // Returns whether a configuration is measured already (its execution time is no longer the initial
+  // value) and returns a random configuration which is not, or the size of the list if none is left
+  bool Explored(const size_t index) const {
+    return execution_times_[index] != std::numeric_limits<double>::max();
   }
+  size_t RandomUnexplored(std::default_random_engine &generator) const;
+
+  // Neighbour index: maps the positions of the values of all parameters (sorted distinct values per
+  // parameter, as found in the configuration list) to a configuration index. This makes it possible
+  // to find the neighbours of a configuration along a single parameter without a full scan. The
+  // index is optional: it is only built by searchers which need it, after which the lookup of
+  // configurations is accelerated as well.
+  void BuildNeighbourIndex();
+  size_t NumParameters() const { return parameter_values_.size(); }
+  size_t NumValues(const size_t parameter) const { return parameter_values_[parameter].size(); }
+  size_t ValueIndex(const size_t index, const size_t parameter) const {
+    return (keys_[index] / strides_[parameter]) % parameter_values_[parameter].size();
+  }
+
+  // Returns the index of the configuration equal to the one at 'index' except that 'parameter' has
+  // the value at position 'value_index'. Returns the size of the configuration list if there is no
+  // such configuration (e.g. because of the constraints). Requires the neighbour index.
+  size_t NeighbourOf(const size_t index, const size_t parameter, const size_t value_index) const;
+
+  // Returns all configurations which differ from the one at 'index' only in 'parameter'
+  std::vector<size_t> NeighboursAlong(const size_t index, const size_t parameter) const;
 
   // Protected member variables accessible by derived classes
   Configurations configurations_;
   std::vector<double> execution_times_;
   std::vector<size_t> explored_indices_;
   size_t index_;
+  FailureModel failure_model_;
+  std::vector<bool> predicted_failures_;
+
+ private:
+
+  // Member variables of the neighbour index: the sorted distinct values per parameter, the strides
+  // of the mixed-radix keys, the key of each configuration, and the reverse mapping
+  std::vector<std::vector<size_t>> parameter_values_;
+  std::vector<size_t> strides_;
+  std::vector<size_t> keys_;
+  std::unordered_map<size_t,size_t> key_to_index_;
 };
 
 // =================================================================================================
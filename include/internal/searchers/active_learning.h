@@ -0,0 +1,123 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements an active-learning search strategy. It alternates between training a machine
+// learning model (linear regression, a neural network, or gradient-boosted decision trees) on the
+// configurations measured so far and measuring a batch of configurations: the best ones according to
+// the model's predictions of all unexplored configurations, complemented with a number of randomly
+// chosen ones (exploration). The first batch is chosen randomly, as there is no data to train on yet.
+// Models which support it are updated incrementally with each measured configuration. These are
+// only re-trained from scratch once the amount of data has doubled since they were last trained.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_ACTIVE_LEARNING_H_
+#define CLTUNE_SEARCHERS_ACTIVE_LEARNING_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+#include "internal/feature_encoder.h"
+#include "internal/ml_matrix.h"
+#include "internal/ml_model.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class ActiveLearning: public Searcher {
+ public:
+
+  // Minimum number of successfully measured configurations to train a model on
+  static const size_t kMinTrainingSamples;
+
+  // Factor by which the amount of data has to grow before an updated model is re-trained
+  static const size_t kRetrainGrowthFactor;
+
+  // Takes additionally the encoder of configurations into features, a fraction of configurations to
+  // try, the type of model, the number of configurations measured between two training rounds, and
+  // the fraction of those to be chosen randomly instead of based on the model, and the number of
+  // folds for cross-validation of the model hyperparameters (zero means using the defaults)
+  ActiveLearning(const Configurations &configurations, const FeatureEncoder &encoder,
+                 const double fraction,
+                 const Model model_type, const size_t batch_size,
+                 const double exploration_fraction, const size_t num_folds,
+                 const unsigned int seed);
+  ~ActiveLearning() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Pushes feedback (in the form of execution time) from the tuner to the search algorithm. The
+  // model is updated with it if possible.
+  virtual void PushExecutionTime(const double execution_time) override;
+
+  // Makes the warm-start configurations the first batch
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
+ private:
+
+  // Selects the next batch of configurations to measure: trains the model and takes the best
+  // predicted unexplored configurations plus some random unexplored ones
+  void NextBatch();
+
+  // Selects random unexplored configurations (which are not yet part of the batch) to fill the batch
+  void AddRandomToBatch(const size_t num_configurations, std::vector<bool> &selected);
+
+  // The features of all configurations (one row per configuration)
+  Matrix<float> features_;
+
+  // Configuration parameters
+  double fraction_;
+  Model model_type_;
+  size_t batch_size_;
+  double exploration_fraction_;
+  size_t num_folds_;
+
+  // The model, the number of samples it was last trained on, and the number of samples it has
+  // learned since (through training and incremental updates)
+  std::unique_ptr<MLModel<float>> model_;
+  size_t num_trained_;
+  size_t num_learned_;
+
+  // The current batch and the position within it
+  std::vector<size_t> batch_;
+  size_t batch_position_;
+  std::vector<bool> explored_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_ACTIVE_LEARNING_H_
+#endif
@@ -49,7 +49,7 @@ class Annealing: public Searcher {
 
   // Takes additionally a fraction of configurations to consider
   Annealing(const Configurations &configurations,
-            const double fraction, const double max_temperature);
+            const double fraction, const double max_temperature, const unsigned int seed);
   ~Annealing() {}
 
   // Retrieves the next configuration to test
@@ -64,6 +64,9 @@ class Annealing: public Searcher {
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time) override;
 
+  // Starts the annealing process from the best warm-start configuration
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
  private:
 
   // Retrieves a vector with all neighbours of a reference configuration
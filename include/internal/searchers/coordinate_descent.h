@@ -0,0 +1,84 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements a coordinate-descent search. It sweeps over one parameter at a time: all
+// values of that parameter are measured while holding the other parameters at the values of the
+// best configuration found so far (the incumbent). This converges quickly on search spaces in which
+// the parameters are mostly separable. Once a full cycle over all parameters brings no improvement,
+// the search restarts from a random unexplored configuration.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_COORDINATE_DESCENT_H_
+#define CLTUNE_SEARCHERS_COORDINATE_DESCENT_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class CoordinateDescent: public Searcher {
+ public:
+
+  // Takes additionally a fraction of configurations to consider
+  CoordinateDescent(const Configurations &configurations, const double fraction,
+                    const unsigned int seed);
+  ~CoordinateDescent() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Starts from the best warm-start configuration
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
+ private:
+
+  // Configuration parameters
+  double fraction_;
+
+  // The incumbent, the parameter currently swept, and the configurations left in this sweep
+  size_t incumbent_;
+  size_t parameter_;
+  std::vector<size_t> sweep_;
+  bool improved_;
+  size_t sweeps_without_improvement_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_COORDINATE_DESCENT_H_
+#endif
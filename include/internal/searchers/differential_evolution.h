@@ -0,0 +1,129 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements a differential evolution search (the DE/rand/1/bin scheme). Configurations
+// are encoded as vectors of the positions of their values within the list of values of each
+// parameter, such that the ordering of the values (e.g. powers of two) is taken into account. The
+// population evolves in generations: for each member, a trial vector is created by adding the
+// scaled difference of two random members to a third one, followed by crossover with the member.
+// Trial vectors are snapped to the nearest valid and unexplored configuration. All trials of a
+// generation are measured as one batch, after which each trial replaces its member if it is faster.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_DIFFERENTIAL_EVOLUTION_H_
+#define CLTUNE_SEARCHERS_DIFFERENTIAL_EVOLUTION_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+#include "internal/kernel_info.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class DifferentialEvolution: public Searcher {
+ public:
+
+  // Shorthand
+  using Parameters = std::vector<KernelInfo::Parameter>;
+
+  // Minimum population size for creating trial vectors out of three other members
+  static const size_t kMinPopulationSize;
+
+  // Takes additionally a fraction of configurations to consider, the population size (which is
+  // also the batch size of a generation), the differential weight, and the crossover probability
+  DifferentialEvolution(const Configurations &configurations, const Parameters &parameters,
+                        const double fraction, const size_t population_size,
+                        const double differential_weight, const double crossover_rate,
+                        const unsigned int seed);
+  ~DifferentialEvolution() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Makes the warm-start configurations part of the initial population
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
+ private:
+
+  // Replaces members by their trials if these are faster and creates the trials of the next
+  // generation (the next batch)
+  void Select();
+  void NextGeneration();
+  bool HasTrials() const {
+    return population_.size() >= kMinPopulationSize && num_parameters_ != 0;
+  }
+
+  // Finds the valid configuration nearest to a vector of value positions, preferring configurations
+  // which are not explored and not part of the current batch. This is a branch-and-bound search
+  // over the sorted keys (see below): per parameter, the values are visited from nearest to
+  // farthest, as long as the partial distance is below the distance of the best configuration.
+  size_t Snap(const std::vector<double> &positions) const;
+  void SnapParameter(const std::vector<double> &positions, const size_t parameter,
+                     const size_t begin, const size_t end, const size_t key_prefix,
+                     const double distance, const bool only_new,
+                     size_t &best_index, double &best_distance) const;
+
+  // Configuration parameters
+  double fraction_;
+  size_t population_size_;
+  double differential_weight_;
+  double crossover_rate_;
+
+  // Positions of the values of all configurations (row-major: configuration by parameter)
+  size_t num_parameters_;
+  std::vector<size_t> positions_;
+
+  // The positions of each configuration encoded as a mixed-radix key (the first parameter being
+  // the most significant), sorted, with the corresponding configuration indices. Configurations
+  // which share the values of the first parameters thus form a contiguous range of keys.
+  std::vector<size_t> num_values_;
+  std::vector<size_t> key_strides_;
+  std::vector<size_t> sorted_keys_;
+  std::vector<size_t> sorted_indices_;
+
+  // The population, the trials of the current generation, and the position within the batch
+  std::vector<size_t> population_;
+  std::vector<size_t> batch_;
+  size_t batch_position_;
+  bool initial_generation_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+  std::uniform_real_distribution<double> probability_distribution_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_DIFFERENTIAL_EVOLUTION_H_
+#endif
@@ -0,0 +1,84 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements a greedy hill-climbing search with random restarts. Starting from a random
+// configuration, the unexplored neighbours (configurations which differ in the value of a single
+// parameter) are measured in random order. The search moves to the first neighbour which improves
+// upon the current configuration. If none of the neighbours is better, a local optimum is reached
+// and the search restarts at a random unexplored configuration.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_HILL_CLIMBING_H_
+#define CLTUNE_SEARCHERS_HILL_CLIMBING_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class HillClimbing: public Searcher {
+ public:
+
+  // Takes additionally a fraction of configurations to consider
+  HillClimbing(const Configurations &configurations, const double fraction,
+               const unsigned int seed);
+  ~HillClimbing() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Starts climbing from the best warm-start configuration
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
+ private:
+
+  // Collects the unexplored neighbours of the current state in random order
+  void SetNeighbours();
+
+  // Configuration parameters
+  double fraction_;
+
+  // The current state and its remaining neighbours to measure
+  size_t current_state_;
+  std::vector<size_t> neighbours_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_HILL_CLIMBING_H_
+#endif
@@ -52,7 +52,7 @@ class PSO: public Searcher {
   // Takes additionally a fraction of configurations to consider
   PSO(const Configurations &configurations, const Parameters &parameters,
       const double fraction, const size_t swarm_size, const double influence_global,
-      const double influence_local, const double influence_random);
+      const double influence_local, const double influence_random, const unsigned int seed);
   ~PSO() { }
 
   // Retrieves the next configuration to test
@@ -67,10 +67,10 @@ class PSO: public Searcher {
   // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
   virtual void PushExecutionTime(const double execution_time) override;
 
- private:
+  // Places the particles of the swarm at the warm-start configurations
+  virtual void SetWarmStart(const Configurations &configurations) override;
 
-  // Returns the index of the target configuration in the whole configuration list
-  size_t IndexFromConfiguration(const KernelInfo::Configuration target) const;
+ private:
 
   // Configuration parameters
   double fraction_;
@@ -7,6 +7,10 @@
 //
 // This file implements a random-search algorithm, testing the configurations randomly. However,
 // it does not consider the same configuration twice. It is derived from the basic search class.
+// Next to the default mode (shuffling the list of all configurations), there is also a sampling
+// mode which draws configurations lazily from the unconstrained search space of a kernel. Its
+// start-up time and memory usage are proportional to the number of samples instead of to the size
+// of the search space.
 //
 // -------------------------------------------------------------------------------------------------
 //
@@ -30,8 +34,11 @@
 #define CLTUNE_SEARCHERS_RANDOM_SEARCH_H_
 
 #include <vector>
+#include <random>
+#include <set>
 
 #include "internal/searcher.h"
+#include "internal/kernel_info.h"
 
 namespace cltune {
 // =================================================================================================
@@ -40,8 +47,16 @@ namespace cltune {
 class RandomSearch: public Searcher {
  public:
 
+  // Number of mixing rounds of the format-preserving permutation used in sampling mode
+  static const size_t kPermutationRounds;
+
   // Takes additionally a fraction of configurations to try (1.0 == full search)
-  RandomSearch(const Configurations &configurations, const double fraction);
+  RandomSearch(const Configurations &configurations, const double fraction,
+               const unsigned int seed);
+
+  // Sampling mode: takes a kernel (with parameters and constraints) instead of a list of all
+  // configurations. The fraction is relative to the unconstrained search space.
+  RandomSearch(KernelInfo &kernel, const double fraction, const unsigned int seed);
   ~RandomSearch() {}
 
   // Retrieves the next configuration to test
@@ -53,8 +68,33 @@ class RandomSearch: public Searcher {
   // Retrieves the total number of configurations to try
   virtual size_t NumConfigurations() override;
 
+  // Explores the warm-start configurations first. In sampling mode, these are also excluded from
+  // the samples drawn afterwards.
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
  private:
-    double fraction_;
+
+  // Draws the next valid configuration in sampling mode and appends it to the configurations list.
+  // Returns false if the whole search space has been drawn.
+  bool DrawSample();
+
+  // Keyed bijection on [0, num_raw_configurations_): used to visit the search space in a random
+  // order without storing it. Based on cycle-walking over a power-of-two sized domain.
+  size_t Permute(const size_t counter) const;
+
+  // Configuration parameters
+  double fraction_;
+
+  // Sampling-mode member variables
+  KernelInfo* kernel_;
+  size_t num_raw_configurations_;
+  size_t num_samples_;
+  size_t counter_;
+  unsigned long long mask_;
+  unsigned int shift_;
+  std::vector<unsigned long long> keys_;
+  std::vector<unsigned long long> multipliers_;
+  std::set<size_t> warm_start_indices_;
 };
 
 // =================================================================================================
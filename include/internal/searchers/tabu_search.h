@@ -0,0 +1,114 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements a tabu search. The neighbourhood of the current configuration consists of
+// all configurations which differ in the value of a single parameter. These moves are generated from
+// the values of each parameter and are filtered by the constraints through the neighbour index.
+// Each iteration measures the unexplored non-tabu neighbours (up to a maximum number) and moves to
+// the best one, even if it is slower than the current configuration. The value a parameter moved
+// away from becomes tabu for that parameter for a number of iterations (the tenure), unless it
+// leads to a configuration faster than the best found so far (aspiration).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_SEARCHERS_TABU_SEARCH_H_
+#define CLTUNE_SEARCHERS_TABU_SEARCH_H_
+
+#include <vector>
+#include <random>
+
+#include "internal/searcher.h"
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class TabuSearch: public Searcher {
+ public:
+
+  // Maximum number of successive moves without anything new to measure, after which the search
+  // restarts from a random unexplored configuration
+  static const size_t kMaxMovesWithoutMeasurement;
+
+  // Takes additionally a fraction of configurations to consider, the number of iterations for which
+  // a move is tabu, and the maximum number of neighbours to measure per iteration
+  TabuSearch(const Configurations &configurations, const double fraction,
+             const size_t tabu_tenure, const size_t neighbourhood_size, const unsigned int seed);
+  ~TabuSearch() {}
+
+  // Retrieves the next configuration to test
+  virtual KernelInfo::Configuration GetConfiguration() override;
+
+  // Calculates the next index
+  virtual void CalculateNextIndex() override;
+
+  // Retrieves the total number of configurations to try
+  virtual size_t NumConfigurations() override;
+
+  // Pushes feedback (in the form of execution time) from the tuner to the search algorithm
+  virtual void PushExecutionTime(const double execution_time) override;
+
+  // Starts from the best warm-start configuration
+  virtual void SetWarmStart(const Configurations &configurations) override;
+
+ private:
+
+  // Creates the next batch of configurations to measure: the neighbourhood of the current state or,
+  // if that is measured already, the neighbourhood after moving
+  void NextBatch();
+
+  // Moves to the best admissible neighbour and updates the tabu list. Returns false if there is no
+  // admissible neighbour.
+  bool Move();
+
+  // Returns whether moving from the current state to a neighbour is tabu: this is the case if a
+  // changed parameter gets a value which is tabu for that parameter
+  bool IsTabu(const size_t neighbour) const;
+
+  // Configuration parameters
+  double fraction_;
+  size_t tabu_tenure_;
+  size_t neighbourhood_size_;
+
+  // The current state, the best time so far, the best time before measuring the current
+  // neighbourhood (for the aspiration criterion), and the neighbours to measure
+  size_t current_state_;
+  double best_time_;
+  double aspiration_time_;
+  bool neighbourhood_measured_;
+  std::vector<size_t> batch_;
+  size_t batch_position_;
+
+  // The tabu list: per parameter and per value, the iteration up to which the value is tabu
+  size_t iteration_;
+  std::vector<std::vector<size_t>> tabu_until_;
+
+  // Random number generation
+  std::default_random_engine generator_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_SEARCHERS_TABU_SEARCH_H_
+#endif
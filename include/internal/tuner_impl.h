@@ -40,6 +40,7 @@
 #endif
 
 #include "internal/kernel_info.h"
+#include "internal/searcher.h"
 #include "internal/msvc.h"
 
 // Host data-type for half-precision floating-point (16-bit)
@@ -50,10 +51,16 @@
 #include <memory> // std::shared_ptr
 #include <complex> // std::complex
 #include <stdexcept> // std::runtime_error
+#include <chrono> // std::chrono::steady_clock
+#include <unordered_map> // std::unordered_map
 
 namespace cltune {
 // =================================================================================================
 
+// Forward declaration of the machine learning models and of the result sinks
+class ModelEnsemble;
+class ResultSink;
+
 // Shorthands for complex data-types
 using float2 = std::complex<float>; // cl_float2;
 using double2 = std::complex<double>; // cl_double2;
@@ -75,6 +82,10 @@ class TunerImpl {
 
   // Parameters
   static const double kMaxL2Norm; // This is the threshold for 'correctness'
+  static const double kFinalistSignificance; // Significance level for ranking the finalists
+  static const double kMaxDrift; // Relative drift of the control configuration before warning
+  static const std::string kModelFileHeader;
+  static const std::string kSearchLogKernelPrefix; // Starts the section of a kernel in a search log
 
   // Messages printed to stdout (in colours)
   static const std::string kMessageFull;
@@ -103,6 +114,53 @@ class TunerImpl {
     size_t threads;
     bool status;
     KernelInfo::Configuration configuration;
+    Outcome outcome;
+    float drift; // Time of the control configuration relative to its first measurement (or 1.0)
+  };
+
+  // Helper structure holding a result of an earlier tuning session, together with the name of the
+  // device and the hash of the kernel's source-code (both are empty if unknown)
+  struct ImportedResult {
+    std::string device;
+    std::string kernel_hash;
+    TunerResult result;
+  };
+
+  // Helper structure holding the results imported from a file, together with the values which
+  // parameters had before they became part of the search space (see BuildResultCache)
+  struct ImportedResults {
+    std::vector<ImportedResult> results;
+    std::unordered_map<std::string, size_t> defaults;
+  };
+
+  // Helper structure holding the imported results of a kernel by index into the unconstrained
+  // search space (see KernelInfo::IndexFromConfiguration). The parameters which the kernel doesn't
+  // use are kept at their first value, such that all of their values share the same results. Also
+  // counts the results with filled-in parameters and those without device or source hash.
+  struct ResultCache {
+    KernelInfo::Configuration unused_parameters;
+    std::unordered_map<size_t, TunerResult> results;
+    size_t num_mapped;
+    size_t num_unverified;
+  };
+
+  // Helper structure holding a lower-fidelity version of the tuning problem for multi-fidelity
+  // tuning: the fraction of candidates to promote to the next level, the number of runs per kernel,
+  // (optionally) the global sizes of kernels (given per kernel ID), and (optionally) a separate set
+  // of kernel arguments. The argument lists mirror those of the full problem below.
+  struct FidelityLevel {
+    double promote_fraction;
+    size_t num_runs;
+    std::vector<std::pair<size_t,IntRange>> global_sizes;
+    size_t argument_counter;
+    std::vector<MemArgument> arguments_input;
+    std::vector<MemArgument> arguments_output;
+    std::vector<std::pair<size_t,int>> arguments_int;
+    std::vector<std::pair<size_t,size_t>> arguments_size_t;
+    std::vector<std::pair<size_t,float>> arguments_float;
+    std::vector<std::pair<size_t,double>> arguments_double;
+    std::vector<std::pair<size_t,float2>> arguments_float2;
+    std::vector<std::pair<size_t,double2>> arguments_double2;
   };
 
   // Initialize either with platform 0 and device 0 or with a custom platform/device
@@ -112,10 +170,54 @@ class TunerImpl {
   // Starts the tuning process. This function is called directly from the Tuner API.
   void Tune();
 
+  // Checks whether the tuning budget is exhausted. If so, it also records the reason for stopping.
+  bool BudgetExhausted(const size_t evaluations_without_improvement);
+
+  // Prints how much of the tuning budget was used
+  void PrintBudgetUsage() const;
+
+  // Compiles, runs, and verifies a single configuration of a kernel (with its parameters as defines)
+  TunerResult RunConfiguration(KernelInfo &kernel, const KernelInfo::Configuration &configuration,
+                               const size_t configuration_id, const size_t num_configurations);
+
+  // Prints and returns the result of a configuration which is known from the imported results (see
+  // FindCachedResult), as measured in an earlier session
+  TunerResult KnownResult(const TunerResult &known_result,
+                          const KernelInfo::Configuration &configuration,
+                          const size_t configuration_id, const size_t num_configurations) const;
+
+  // Multi-fidelity tuning: runs a configuration at a lower fidelity level, temporarily swaps in the
+  // settings of such a level, and promotes the best candidates level-by-level
+  TunerResult RunConfigurationAtFidelity(KernelInfo &kernel, const size_t kernel_id,
+                                         const size_t level,
+                                         const KernelInfo::Configuration &configuration,
+                                         const size_t configuration_id,
+                                         const size_t num_configurations);
+  void SwapFidelityLevel(FidelityLevel &level, KernelInfo &kernel, const size_t kernel_id);
+  void SuccessiveHalving(KernelInfo &kernel, const size_t kernel_id,
+                         std::vector<TunerResult> &candidates);
+
+  // Finalist stage: re-measures the best configurations of a kernel (the fastest of the given
+  // results) in randomly ordered rounds and ranks them using Mann-Whitney U tests
+  void RunFinalists(KernelInfo &kernel, std::vector<TunerResult> finalists);
+  static double MannWhitneyPValue(const std::vector<float> &a, const std::vector<float> &b);
+  static float Median(std::vector<float> samples);
+
+  // Drift compensation: re-measures the control configuration and returns its execution time
+  float RunControl(KernelInfo &kernel, const KernelInfo::Configuration &control);
+
   // Compiles and runs a kernel and returns the elapsed time
   TunerResult RunKernel(const std::string &source, const KernelInfo &kernel,
                         const size_t configuration_id, const size_t num_configurations);
 
+  // The steps of RunKernel: compiles a kernel (throws on errors), launches a compiled kernel with
+  // the thread-sizes of the current configuration (throws on errors), and reports a failed run
+  Program BuildProgram(const std::string &source);
+  TunerResult LaunchKernel(Kernel &tune_kernel, const KernelInfo &kernel,
+                           const size_t configuration_id, const size_t num_configurations);
+  TunerResult FailedResult(const KernelInfo &kernel, const Outcome outcome,
+                           const std::exception &e);
+
   // Copies an output buffer
   template <typename T> MemArgument CopyOutputBuffer(MemArgument &argument);
 
@@ -132,12 +234,68 @@ class TunerImpl {
   void ModelPrediction(const Model model_type, const float validation_fraction,
                        const size_t test_top_x_configurations);
 
+  // Selects the 'num_best' configurations to verify from the predicted means and variances of their
+  // execution times, according to the acquisition strategy
+  std::vector<size_t> SelectByAcquisition(const std::vector<float> &means,
+                                          const std::vector<float> &variances,
+                                          const size_t num_best) const;
+
+  // Saves the model trained by ModelPrediction for a kernel to file
+  void SaveModel(const size_t id, const std::string &filename);
+
+  // Retrieves a fidelity level by ID, throws if it doesn't exist
+  FidelityLevel& GetFidelityLevel(const size_t level) {
+    if (level >= fidelity_levels_.size()) { throw std::runtime_error("Invalid fidelity level"); }
+    return fidelity_levels_[level];
+  }
+
+  // Loads the results of an earlier tuning session from a JSON file (as written by PrintJSON or by
+  // a JSON-lines sink) and selects the best of those results which are valid for a kernel to
+  // warm-start its search with
+  static std::vector<ImportedResult> LoadJSONResults(const std::string &filename);
+  std::vector<KernelInfo::Configuration> WarmStartConfigurations(KernelInfo &kernel);
+
+  // As above, but from a CSV file (as written by PrintToFile or by a CSV sink), or from either
+  // format based on the contents of the file
+  static std::vector<ImportedResult> LoadCSVResults(const std::string &filename);
+  static std::vector<ImportedResult> LoadResults(const std::string &filename);
+
+  // Collects the imported results which apply to the current device and kernels into the result
+  // caches, and looks up a configuration in there (returns nullptr if it is unknown)
+  void BuildResultCache();
+  const TunerResult* FindCachedResult(const KernelInfo &kernel,
+                                      const KernelInfo::Configuration &configuration) const;
+
+  // As above, but for a single kernel and a given device name
+  static ResultCache CacheImportedResults(const KernelInfo &kernel, const std::string &device_name,
+                                          const std::vector<ImportedResults> &imported_results);
+  static const TunerResult* FindCachedResult(const KernelInfo &kernel, const ResultCache &cache,
+                                             const KernelInfo::Configuration &configuration);
+  static size_t ResultCacheIndex(const KernelInfo &kernel, const ResultCache &cache,
+                                 const KernelInfo::Configuration &configuration);
+
+  // Loads the sequence of configurations of a search log for replaying it
+  std::vector<KernelInfo::Configuration> LoadSearchLog(const KernelInfo &kernel);
+
+  // Passes a result to the callback and the sinks and stores it, or otherwise keeps track of the
+  // best result and the candidates for the finalist stage
+  void StoreResult(const TunerResult &result);
+
+  // Opens the files of the result sinks which were added since the last call
+  void OpenResultSinks();
+
+  // Converts a result to its public version as passed to the result callback
+  static Result PublicResult(const TunerResult &result);
+
   // Prints results of a particular kernel run
   void PrintResult(FILE* fp, const TunerResult &result, const std::string &message) const;
 
   // Retrieves the best tuning result
   TunerResult GetBestResult() const;
 
+  // Retrieves the information of the device as key-value pairs
+  std::vector<std::pair<std::string,std::string>> GetDeviceInfo() const;
+
   // Loads a file from disk into a string
   std::string LoadFile(const std::string &filename);
 
@@ -175,9 +333,52 @@ class TunerImpl {
   bool output_search_process_;
   std::string search_log_filename_;
 
+  // The tuning budget (zero means no limit) and how much of it is used
+  double max_tuning_time_; // In seconds
+  size_t max_evaluations_;
+  size_t early_stopping_evaluations_;
+  double early_stopping_improvement_; // In percent
+  std::chrono::steady_clock::time_point tuning_start_time_;
+  double tuning_time_; // In seconds
+  size_t num_evaluations_;
+  std::string stop_reason_;
+
   // The search method and its arguments
   SearchMethod search_method_;
   std::vector<double> search_args_;
+  bool has_seed_;
+  unsigned int seed_;
+  std::string replay_filename_;
+  double failure_threshold_; // Skips configurations with a higher predicted failure probability
+
+  // Results of earlier tuning sessions and the number of configurations to warm-start with
+  std::vector<TunerResult> warm_start_results_;
+  size_t warm_start_count_;
+
+  // Imported results of earlier tuning sessions (per file) and the cache built from them per kernel
+  std::vector<ImportedResults> imported_results_;
+  std::unordered_map<std::string, ResultCache> result_cache_;
+
+  // Settings of the finalist stage (zero finalists means disabled) and the winner per kernel
+  size_t num_finalists_;
+  size_t num_finalist_rounds_;
+  std::vector<TunerResult> finalist_results_;
+
+  // Settings of drift compensation: the number of evaluations between measurements of the control
+  // configuration (zero means disabled) and whether to normalize the execution times
+  size_t drift_interval_;
+  bool drift_normalize_;
+
+  // The number of folds for cross-validation of the model hyperparameters (zero means disabled)
+  size_t num_folds_;
+
+  // The number of models trained by ModelPrediction and how to select configurations based on them
+  size_t num_ensemble_models_;
+  Acquisition acquisition_;
+  double acquisition_kappa_; // Multiple of the standard deviation for the confidence bounds
+
+  // The machine learning models trained by ModelPrediction (per kernel)
+  std::vector<std::shared_ptr<ModelEnsemble>> models_;
 
   // Storage of kernel sources, arguments, and parameters
   size_t argument_counter_;
@@ -192,12 +393,25 @@ class TunerImpl {
   std::vector<std::pair<size_t,float2>> arguments_float2_;
   std::vector<std::pair<size_t,double2>> arguments_double2_;
 
+  // Lower-fidelity levels for multi-fidelity tuning (from low to high, excluding the full problem)
+  std::vector<FidelityLevel> fidelity_levels_;
+
   // Storage for the reference kernel and output
   std::unique_ptr<KernelInfo> reference_kernel_;
   std::vector<void*> reference_outputs_;
 
   // List of tuning results
   std::vector<TunerResult> tuning_results_;
+
+  // Receivers of the results as they come in: the callback and the sinks (with their formats and
+  // files). If the results are not retained, only the best result and the fastest results of the
+  // current kernel (as candidates for the finalist stage) are kept.
+  ResultCallback result_callback_;
+  std::vector<std::pair<ResultFormat,std::string>> result_sink_files_;
+  std::vector<std::unique_ptr<ResultSink>> result_sinks_;
+  bool retain_results_;
+  TunerResult best_result_;
+  std::vector<TunerResult> finalist_candidates_;
 };
 
 // =================================================================================================
@@ -0,0 +1,83 @@
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file contains the WorkerPool class: persistent worker threads which run a task in parallel
+// on request. This avoids starting and joining threads for each of many short parallel steps, such
+// as the minibatches of gradient descent.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+#ifndef CLTUNE_WORKER_POOL_H_
+#define CLTUNE_WORKER_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace cltune {
+// =================================================================================================
+
+// See comment at top of file for a description of the class
+class WorkerPool {
+ public:
+
+  // Starts the worker threads. The number of threads includes the calling thread, such that a pool
+  // of a single thread starts no workers at all.
+  explicit WorkerPool(const size_t num_threads);
+  ~WorkerPool();
+
+  // The pool can't be copied or moved, since the workers refer to it
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Returns the number of threads (including the calling thread)
+  size_t size() const { return workers_.size() + 1; }
+
+  // Runs 'task(tid)' for each 'tid' below 'num_tasks' (at most the number of threads) and waits for
+  // all of them. The calling thread runs the first task. Passes on the first error of any task.
+  void Run(const size_t num_tasks, const std::function<void(size_t)> &task);
+
+ private:
+  // The loop of a worker thread: waits for a new task, runs it if it has a part in it, and reports
+  // that it is done
+  void Work(const size_t tid);
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable task_ready_;
+  std::condition_variable task_done_;
+  const std::function<void(size_t)>* task_;
+  size_t num_tasks_;
+  size_t generation_; // Counts the tasks, such that a worker runs each task once
+  size_t num_running_;
+  bool stop_;
+  std::vector<std::exception_ptr> errors_;
+};
+
+// =================================================================================================
+} // namespace cltune
+
+// CLTUNE_WORKER_POOL_H_
+#endif
@@ -30,6 +30,7 @@
 
 // And the implemenation (Pimpl idiom)
 #include "internal/tuner_impl.h"
+#include "internal/results_writer.h"
 
 #include <iostream> // FILE
 #include <limits> // std::numeric_limits
@@ -155,6 +156,22 @@ void Tuner::SetLocalMemoryUsage(const size_t id, LocalMemoryFunction amount,
   pimpl->kernels_[id].SetLocalMemoryUsage(amount, parameters);
 }
 
+// Sets the feature encoding of a parameter
+void Tuner::SetFeatureEncoding(const size_t id, const std::string &parameter_name,
+                               const Encoding encoding) {
+  if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+  if (!pimpl->kernels_[id].ParameterExists(parameter_name)) {
+    throw std::runtime_error("Invalid parameter");
+  }
+  pimpl->kernels_[id].SetEncoding(parameter_name, encoding);
+}
+
+// Enables derived features
+void Tuner::AddDerivedFeatures(const size_t id, const bool thread_counts, const bool local_memory) {
+  if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+  pimpl->kernels_[id].AddDerivedFeatures(thread_counts, local_memory);
+}
+
 
 // =================================================================================================
 
@@ -230,6 +247,104 @@ template <> void PUBLIC_API Tuner::AddArgumentScalar<double2>(const double2 argu
 
 // =================================================================================================
 
+// Adds a new level for multi-fidelity tuning. By default, it uses the regular kernel arguments and
+// global sizes, but with a different number of runs.
+size_t Tuner::AddFidelityLevel(const double promote_fraction, const size_t num_runs) {
+  if (promote_fraction <= 0.0 || promote_fraction > 1.0) {
+    throw std::runtime_error("Invalid fraction of candidates to promote");
+  }
+  auto level = TunerImpl::FidelityLevel{};
+  level.promote_fraction = promote_fraction;
+  level.num_runs = num_runs;
+  level.argument_counter = 0;
+  pimpl->fidelity_levels_.push_back(level);
+  return pimpl->fidelity_levels_.size() - 1;
+}
+
+// Overrides the global size of a kernel for a specific fidelity level
+void Tuner::SetFidelityGlobalSize(const size_t level, const size_t id, const IntRange &global) {
+  if (id >= pimpl->kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+  pimpl->GetFidelityLevel(level).global_sizes.push_back({id, global});
+}
+
+// As AddArgumentInput, but stores the argument with a specific fidelity level
+template <typename T>
+void Tuner::AddFidelityArgumentInput(const size_t level, const std::vector<T> &source) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  auto device_buffer = Buffer<T>(pimpl->context(), BufferAccess::kNotOwned, source.size());
+  device_buffer.Write(pimpl->queue(), source.size(), source);
+  auto argument = TunerImpl::MemArgument{fidelity.argument_counter++, source.size(),
+                                         pimpl->GetType<T>(), device_buffer()};
+  fidelity.arguments_input.push_back(argument);
+}
+
+// Compiles the function for various data-types
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<short>(const size_t, const std::vector<short>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<int>(const size_t, const std::vector<int>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<size_t>(const size_t, const std::vector<size_t>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<half>(const size_t, const std::vector<half>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<float>(const size_t, const std::vector<float>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<double>(const size_t, const std::vector<double>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<float2>(const size_t, const std::vector<float2>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentInput<double2>(const size_t, const std::vector<double2>&);
+
+// As AddArgumentOutput, but stores the argument with a specific fidelity level
+template <typename T>
+void Tuner::AddFidelityArgumentOutput(const size_t level, const std::vector<T> &source) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  auto device_buffer = Buffer<T>(pimpl->context(), BufferAccess::kNotOwned, source.size());
+  device_buffer.Write(pimpl->queue(), source.size(), source);
+  auto argument = TunerImpl::MemArgument{fidelity.argument_counter++, source.size(),
+                                         pimpl->GetType<T>(), device_buffer()};
+  fidelity.arguments_output.push_back(argument);
+}
+
+// Compiles the function for various data-types
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<short>(const size_t, const std::vector<short>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<int>(const size_t, const std::vector<int>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<size_t>(const size_t, const std::vector<size_t>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<half>(const size_t, const std::vector<half>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<float>(const size_t, const std::vector<float>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<double>(const size_t, const std::vector<double>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<float2>(const size_t, const std::vector<float2>&);
+template void PUBLIC_API Tuner::AddFidelityArgumentOutput<double2>(const size_t, const std::vector<double2>&);
+
+// As AddArgumentScalar, but stores the argument with a specific fidelity level
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<short>(const size_t level, const short argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_int.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<int>(const size_t level, const int argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_int.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<size_t>(const size_t level, const size_t argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_size_t.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<half>(const size_t level, const half argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_float.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<float>(const size_t level, const float argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_float.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<double>(const size_t level, const double argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_double.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<float2>(const size_t level, const float2 argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_float2.push_back({fidelity.argument_counter++, argument});
+}
+template <> void PUBLIC_API Tuner::AddFidelityArgumentScalar<double2>(const size_t level, const double2 argument) {
+  auto &fidelity = pimpl->GetFidelityLevel(level);
+  fidelity.arguments_double2.push_back({fidelity.argument_counter++, argument});
+}
+
+// =================================================================================================
+
 // Use full search as a search strategy. This is the default method.
 void Tuner::UseFullSearch() {
   pimpl->search_method_ = SearchMethod::FullSearch;
@@ -241,6 +356,12 @@ void Tuner::UseRandomSearch(const double fraction) {
   pimpl->search_args_.push_back(fraction);
 }
 
+// Use random search as a search strategy, but without computing all configurations up-front.
+void Tuner::UseRandomSampling(const double fraction) {
+  pimpl->search_method_ = SearchMethod::RandomSampling;
+  pimpl->search_args_.push_back(fraction);
+}
+
 // Use simulated annealing as a search strategy.
 void Tuner::UseAnnealing(const double fraction, const double max_temperature) {
   pimpl->search_method_ = SearchMethod::Annealing;
@@ -259,6 +380,89 @@ void Tuner::UsePSO(const double fraction, const size_t swarm_size, const double
   pimpl->search_args_.push_back(influence_random);
 }
 
+// Use a machine learning model in the loop as a search strategy.
+void Tuner::UseActiveLearning(const double fraction, const Model model_type,
+                              const size_t batch_size, const double exploration_fraction) {
+  pimpl->search_method_ = SearchMethod::ActiveLearning;
+  pimpl->search_args_.push_back(fraction);
+  pimpl->search_args_.push_back(static_cast<double>(static_cast<int>(model_type)));
+  pimpl->search_args_.push_back(static_cast<double>(batch_size));
+  pimpl->search_args_.push_back(exploration_fraction);
+}
+
+// Use hill climbing with random restarts as a search strategy.
+void Tuner::UseHillClimbing(const double fraction) {
+  pimpl->search_method_ = SearchMethod::HillClimbing;
+  pimpl->search_args_.push_back(fraction);
+}
+
+// Use coordinate descent (one parameter at a time) as a search strategy.
+void Tuner::UseCoordinateDescent(const double fraction) {
+  pimpl->search_method_ = SearchMethod::CoordinateDescent;
+  pimpl->search_args_.push_back(fraction);
+}
+
+// Use differential evolution as a search strategy.
+void Tuner::UseDifferentialEvolution(const double fraction, const size_t population_size,
+                                     const double differential_weight,
+                                     const double crossover_rate) {
+  pimpl->search_method_ = SearchMethod::DifferentialEvolution;
+  pimpl->search_args_.push_back(fraction);
+  pimpl->search_args_.push_back(static_cast<double>(population_size));
+  pimpl->search_args_.push_back(differential_weight);
+  pimpl->search_args_.push_back(crossover_rate);
+}
+
+// Use tabu search as a search strategy.
+void Tuner::UseTabuSearch(const double fraction, const size_t tabu_tenure,
+                          const size_t neighbourhood_size) {
+  pimpl->search_method_ = SearchMethod::TabuSearch;
+  pimpl->search_args_.push_back(fraction);
+  pimpl->search_args_.push_back(static_cast<double>(tabu_tenure));
+  pimpl->search_args_.push_back(static_cast<double>(neighbourhood_size));
+}
+
+// Replays the configurations of an earlier search.
+void Tuner::UseReplay(const std::string &search_log_filename) {
+  pimpl->search_method_ = SearchMethod::Replay;
+  pimpl->replay_filename_ = search_log_filename;
+}
+
+// Sets a fixed seed for the search methods
+void Tuner::SetSeed(const unsigned int seed) {
+  pimpl->has_seed_ = true;
+  pimpl->seed_ = seed;
+}
+
+// Sets the threshold for skipping configurations which are likely to fail
+void Tuner::SetFailureThreshold(const double probability) {
+  if (probability < 0.0 || probability > 1.0) {
+    throw std::runtime_error("Failure threshold should be between 0.0 and 1.0");
+  }
+  pimpl->failure_threshold_ = probability;
+}
+
+
+// Loads the results of earlier tuning sessions. They are only matched against the kernels and their
+// parameters once tuning starts, so this can be called at any time before Tune().
+void Tuner::WarmStart(const std::vector<std::string> &json_files, const size_t num_configurations) {
+  for (auto &json_file: json_files) {
+    for (auto &imported_result: pimpl->LoadJSONResults(json_file)) {
+      pimpl->warm_start_results_.push_back(imported_result.result);
+    }
+  }
+  pimpl->warm_start_count_ = num_configurations;
+}
+
+// Loads the results of an earlier tuning session. As above, they are only matched against the
+// kernels once tuning starts (see BuildResultCache).
+void Tuner::ImportResults(const std::string &filename) {
+  ImportResults(filename, std::unordered_map<std::string, size_t>());
+}
+void Tuner::ImportResults(const std::string &filename,
+                          const std::unordered_map<std::string, size_t> &defaults) {
+  pimpl->imported_results_.push_back({pimpl->LoadResults(filename), defaults});
+}
 
 // Output the search process to a file. This is disabled per default.
 void Tuner::OutputSearchLog(const std::string &filename) {
@@ -281,6 +485,43 @@ void Tuner::ModelPrediction(const Model model_type, const float validation_fract
   pimpl->ModelPrediction(model_type, validation_fraction, test_top_x_configurations);
 }
 
+// Saves a trained machine learning model. See the TunerImpl's implemenation for details
+void Tuner::SaveModel(const size_t id, const std::string &filename) const {
+  pimpl->SaveModel(id, filename);
+}
+
+// Sets the number of folds for cross-validation of the model hyperparameters
+void Tuner::SetCrossValidation(const size_t num_folds) {
+  if (num_folds == 1) { throw std::runtime_error("Cross-validation needs at least two folds"); }
+  pimpl->num_folds_ = num_folds;
+}
+
+// Sets the size of the ensemble of models and the selection strategy
+void Tuner::SetModelEnsemble(const size_t num_models, const Acquisition acquisition,
+                             const double kappa) {
+  if (num_models == 0) { throw std::runtime_error("An ensemble needs at least one model"); }
+  pimpl->num_ensemble_models_ = num_models;
+  pimpl->acquisition_ = acquisition;
+  pimpl->acquisition_kappa_ = kappa;
+}
+
+// =================================================================================================
+
+// Sets the callback which receives every result
+void Tuner::SetResultCallback(ResultCallback callback) {
+  pimpl->result_callback_ = callback;
+}
+
+// Adds a file to stream the results to. It is opened once tuning starts (see OpenResultSinks).
+void Tuner::AddResultSink(const ResultFormat format, const std::string &filename) {
+  pimpl->result_sink_files_.push_back({format, filename});
+}
+
+// Sets whether the results are kept in memory
+void Tuner::SetRetainResults(const bool retain) {
+  pimpl->retain_results_ = retain;
+}
+
 // =================================================================================================
 
 
@@ -364,6 +605,9 @@ void Tuner::PrintJSON(const std::string &filename,
   fprintf(file, "  \"device_core_clock\": \"%zu\",\n", pimpl->device().CoreClock());
   fprintf(file, "  \"device_compute_units\": \"%zu\",\n", pimpl->device().ComputeUnits());
   fprintf(file, "  \"device_extra_info\": \"%s\",\n", pimpl->device().GetExtraInfo().c_str());
+  fprintf(file, "  \"tuning_time\": \"%.3lf\",\n", pimpl->tuning_time_);
+  fprintf(file, "  \"tuning_evaluations\": \"%zu\",\n", pimpl->num_evaluations_);
+  fprintf(file, "  \"tuning_stop_reason\": \"%s\",\n", pimpl->stop_reason_.c_str());
   fprintf(file, "  \"results\": [\n");
 
   // Filters failed configurations
@@ -374,13 +618,21 @@ void Tuner::PrintJSON(const std::string &filename,
     }
   }
 
+  // The hashes of the kernel sources, such that the results can be imported again
+  auto kernel_hashes = std::unordered_map<std::string, std::string>{};
+  for (auto &kernel: pimpl->kernels_) { kernel_hashes[kernel.name()] = kernel.SourceHash(); }
+
   // Loops over all the results
   auto num_results = results.size();
   for (auto r=size_t{0}; r<num_results; ++r) {
     auto result = results[r];
     fprintf(file, "    {\n");
     fprintf(file, "      \"kernel\": \"%s\",\n", result.kernel_name.c_str());
+    fprintf(file, "      \"kernel_hash\": \"%s\",\n", kernel_hashes[result.kernel_name].c_str());
     fprintf(file, "      \"time\": %.3lf,\n", result.time);
+    if (pimpl->drift_interval_ != 0) {
+      fprintf(file, "      \"drift\": %.3lf,\n", result.drift);
+    }
 
     // Loops over all the parameters for this result
     fprintf(file, "      \"parameters\": {");
@@ -439,6 +691,16 @@ void Tuner::PrintToFile(const std::string &filename) const {
   fclose(file);
 }
 
+// Streams all results through the binary writer
+void Tuner::PrintBinary(const std::string &filename) const {
+  pimpl->PrintHeader("Printing results to file in binary format: "+filename);
+  BinaryResultsWriter writer(filename, pimpl->GetDeviceInfo(), pimpl->kernels_);
+  for (auto &tuning_result: pimpl->tuning_results_) {
+    writer.Write(tuning_result);
+  }
+  writer.Flush();
+}
+
 // Set the flag to suppress output to true. Note that this cannot be undone.
 void Tuner::SuppressOutput() {
   pimpl->suppress_output_ = true;
@@ -449,5 +711,32 @@ void Tuner::SetNumRuns(const size_t num_runs) {
   pimpl->num_runs_ = num_runs;
 }
 
+// Sets the tuning budget in terms of wall-clock time, evaluations, or lack of improvement
+void Tuner::SetMaxTuningTime(const double seconds) {
+  pimpl->max_tuning_time_ = seconds;
+}
+void Tuner::SetMaxEvaluations(const size_t num_evaluations) {
+  pimpl->max_evaluations_ = num_evaluations;
+}
+void Tuner::SetEarlyStopping(const size_t num_evaluations, const double min_improvement) {
+  pimpl->early_stopping_evaluations_ = num_evaluations;
+  pimpl->early_stopping_improvement_ = min_improvement;
+}
+
+// Sets the number of finalists and the number of rounds of the finalist stage
+void Tuner::SetFinalists(const size_t num_finalists, const size_t num_rounds) {
+  if (num_finalists != 0 && num_rounds < 2) {
+    throw std::runtime_error("The finalist stage needs at least two rounds");
+  }
+  pimpl->num_finalists_ = num_finalists;
+  pimpl->num_finalist_rounds_ = num_rounds;
+}
+
+// Sets the interval of measuring the control configuration and whether to normalize the results
+void Tuner::SetDriftControl(const size_t interval, const bool normalize) {
+  pimpl->drift_interval_ = interval;
+  pimpl->drift_normalize_ = normalize;
+}
+
 // =================================================================================================
 } // namespace cltune
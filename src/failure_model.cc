@@ -0,0 +1,85 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the FailureModel class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/failure_model.h"
+
+#include <cmath>
+
+namespace cltune {
+// =================================================================================================
+
+// Minimum number of observed outcomes before predicting anything
+const size_t FailureModel::kMinObservations = size_t{8};
+
+// Initializes an empty model
+FailureModel::FailureModel():
+    num_failures_(0),
+    num_successes_(0),
+    counts_() {
+}
+
+// =================================================================================================
+
+// Updates the counts of the values of all parameters
+void FailureModel::Add(const KernelInfo::Configuration &configuration, const bool failed) {
+  if (counts_.size() < configuration.size()) { counts_.resize(configuration.size()); }
+  for (auto p=size_t{0}; p<configuration.size(); ++p) {
+    auto &counts = counts_[p][configuration[p].value];
+    if (failed) { ++counts.failures; }
+    else { ++counts.successes; }
+  }
+  if (failed) { ++num_failures_; }
+  else { ++num_successes_; }
+}
+
+// Computes the log-likelihoods of failure and success and converts them into a probability. The
+// add-one smoothing uses the number of distinct values seen so far (plus one for unseen values).
+double FailureModel::Probability(const KernelInfo::Configuration &configuration) const {
+  const auto num_observations = num_failures_ + num_successes_;
+  if (num_observations < kMinObservations || num_failures_ == 0) { return 0.0; }
+  const auto failures = static_cast<double>(num_failures_);
+  const auto successes = static_cast<double>(num_successes_);
+  auto log_failure = std::log((failures + 1.0) / (num_observations + 2.0));
+  auto log_success = std::log((successes + 1.0) / (num_observations + 2.0));
+  for (auto p=size_t{0}; p<configuration.size() && p<counts_.size(); ++p) {
+    const auto num_values = static_cast<double>(counts_[p].size() + 1);
+    auto value_failures = 0.0;
+    auto value_successes = 0.0;
+    const auto counts = counts_[p].find(configuration[p].value);
+    if (counts != counts_[p].end()) {
+      value_failures = static_cast<double>(counts->second.failures);
+      value_successes = static_cast<double>(counts->second.successes);
+    }
+    log_failure += std::log((value_failures + 1.0) / (failures + num_values));
+    log_success += std::log((value_successes + 1.0) / (successes + num_values));
+  }
+  return 1.0 / (1.0 + std::exp(log_success - log_failure));
+}
+
+// =================================================================================================
+} // namespace cltune
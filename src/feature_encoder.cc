@@ -0,0 +1,164 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the FeatureEncoder class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/feature_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace cltune {
+// =================================================================================================
+
+// Resolves the encodings of all parameters and counts the features
+FeatureEncoder::FeatureEncoder(const KernelInfo &kernel):
+    kernel_(&kernel),
+    parameters_(kernel.parameters()),
+    thread_counts_(kernel.derived_thread_counts()),
+    local_memory_(kernel.derived_local_memory()),
+    num_features_(0) {
+  for (auto &parameter: parameters_) { parameter.encoding = ResolveEncoding(parameter); }
+  CountFeatures();
+}
+
+// Reads the parameters with their encodings: a name, an encoding, and a list of values each
+FeatureEncoder::FeatureEncoder(std::istream &file):
+    kernel_(nullptr),
+    parameters_(),
+    thread_counts_(false),
+    local_memory_(false),
+    num_features_(0) {
+  auto num_parameters = size_t{0};
+  file >> num_parameters;
+  for (auto p=size_t{0}; p<num_parameters && file; ++p) {
+    auto parameter = KernelInfo::Parameter{"", {}, Encoding::kAuto};
+    auto encoding = 0;
+    auto num_values = size_t{0};
+    file >> parameter.name >> encoding >> num_values;
+    parameter.encoding = static_cast<Encoding>(encoding);
+    parameter.values.resize(num_values);
+    for (auto &value: parameter.values) { file >> value; }
+    parameters_.push_back(parameter);
+  }
+  if (!file) { throw std::runtime_error("Invalid feature encoding in model file"); }
+  CountFeatures();
+}
+
+// Writes the parameters in the format as described above
+void FeatureEncoder::Save(std::ostream &file) const {
+  if (thread_counts_ || local_memory_) {
+    throw std::runtime_error("Models with derived features cannot be saved");
+  }
+  file << parameters_.size() << "\n";
+  for (auto &parameter: parameters_) {
+    file << parameter.name << " " << static_cast<int>(parameter.encoding) << " ";
+    file << parameter.values.size();
+    for (auto &value: parameter.values) { file << " " << value; }
+    file << "\n";
+  }
+}
+
+// One-hot encoded parameters have a feature per value, all others have a single feature
+void FeatureEncoder::CountFeatures() {
+  num_features_ = 0;
+  for (auto &parameter: parameters_) {
+    num_features_ += (parameter.encoding == Encoding::kOneHot) ? parameter.values.size() : 1;
+  }
+  if (thread_counts_) { num_features_ += 2; }
+  if (local_memory_) { num_features_ += 1; }
+}
+
+// =================================================================================================
+
+// Encodes a configuration into a new vector
+std::vector<float> FeatureEncoder::Encode(const KernelInfo::Configuration &configuration) const {
+  auto features = std::vector<float>(num_features_);
+  Encode(configuration, features.data());
+  return features;
+}
+
+// Encodes the parameters one by one and appends the derived features
+void FeatureEncoder::Encode(const KernelInfo::Configuration &configuration, float* features) const {
+  auto f = size_t{0};
+  for (auto p=size_t{0}; p<parameters_.size(); ++p) {
+    const auto &parameter = parameters_[p];
+    const auto value = configuration[p].value;
+    const auto position = static_cast<size_t>(std::find(parameter.values.begin(),
+                                                        parameter.values.end(), value) -
+                                              parameter.values.begin());
+    switch (parameter.encoding) {
+      case Encoding::kLog2:
+        features[f++] = std::log2(static_cast<float>(std::max(value, size_t{1})));
+        break;
+      case Encoding::kOrdinal:
+        features[f++] = static_cast<float>(position);
+        break;
+      case Encoding::kOneHot:
+        for (auto v=size_t{0}; v<parameter.values.size(); ++v) {
+          features[f++] = (v == position) ? 1.0f : 0.0f;
+        }
+        break;
+      default:
+        features[f++] = static_cast<float>(value);
+        break;
+    }
+  }
+
+  // The derived features
+  if (thread_counts_) {
+    auto global = IntRange();
+    auto local = IntRange();
+    kernel_->ComputeRanges(configuration, global, local);
+    auto local_threads = size_t{1};
+    auto global_threads = size_t{1};
+    for (auto &item: local) { local_threads *= item; }
+    for (auto &item: global) { global_threads *= item; }
+    features[f++] = std::log2(static_cast<float>(std::max(local_threads, size_t{1})));
+    features[f++] = std::log2(static_cast<float>(std::max(global_threads, size_t{1})));
+  }
+  if (local_memory_) {
+    const auto local_memory = kernel_->LocalMemoryUsage(configuration);
+    features[f++] = std::log2(static_cast<float>(local_memory + 1));
+  }
+}
+
+// =================================================================================================
+
+// Tile sizes, vector widths, and thread counts are typically powers of two. Parameters with only two
+// values (e.g. flags) are left linear, since a logarithm doesn't make a difference there.
+Encoding FeatureEncoder::ResolveEncoding(const KernelInfo::Parameter &parameter) {
+  if (parameter.encoding != Encoding::kAuto) { return parameter.encoding; }
+  if (parameter.values.size() <= 2) { return Encoding::kLinear; }
+  for (auto &value: parameter.values) {
+    if (value == 0 || (value & (value - 1)) != 0) { return Encoding::kLinear; }
+  }
+  return Encoding::kLog2;
+}
+
+// =================================================================================================
+} // namespace cltune
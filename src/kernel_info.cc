@@ -29,6 +29,12 @@
 #include "internal/kernel_info.h"
 
 #include <cassert>
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
 
 namespace cltune {
 // =================================================================================================
@@ -50,7 +56,9 @@ KernelInfo::KernelInfo(const std::string name, const std::string source, const D
   device_(device),
   global_base_(), local_base_(),
   global_(), local_(),
-  thread_size_modifiers_() {
+  thread_size_modifiers_(),
+  derived_thread_counts_(false),
+  derived_local_memory_(false) {
 }
 
 // =================================================================================================
@@ -63,7 +71,7 @@ void KernelInfo::PrependSource(const std::string &extra_source) {
 
 // Pushes a new parameter to the list of parameters
 void KernelInfo::AddParameter(const std::string &name, const std::vector<size_t> &values) {
-  Parameter parameter = {name, values};
+  Parameter parameter = {name, values, Encoding::kAuto};
   parameters_.push_back(parameter);
 }
 
@@ -97,10 +105,48 @@ void KernelInfo::SetLocalMemoryUsage(LocalMemoryFunction amount,
 
 // =================================================================================================
 
+// Sets the encoding of the parameter with the given name
+void KernelInfo::SetEncoding(const std::string &parameter_name, const Encoding encoding) {
+  for (auto &parameter: parameters_) {
+    if (parameter.name == parameter_name) { parameter.encoding = encoding; }
+  }
+}
+
+// Enables derived features
+void KernelInfo::AddDerivedFeatures(const bool thread_counts, const bool local_memory) {
+  derived_thread_counts_ = derived_thread_counts_ || thread_counts;
+  derived_local_memory_ = derived_local_memory_ || local_memory;
+}
+
+// Finds the values of the parameters of the local memory function and calls it
+size_t KernelInfo::LocalMemoryUsage(const Configuration &config) const {
+  std::vector<size_t> values_local_memory(0);
+  for (auto &parameter: local_memory_.parameters) {
+    for (auto &setting: config) {
+      if (setting.name == parameter) {
+        values_local_memory.push_back(setting.value);
+        break;
+      }
+    }
+  }
+  if (local_memory_.parameters.size() != values_local_memory.size()) {
+    throw Exception("Invalid settings for the local memory usage constraint");
+  }
+  return local_memory_.amount(values_local_memory);
+}
+
+// =================================================================================================
+
+// Computes the ranges and stores them in the member variables global_ and local_
+void KernelInfo::ComputeRanges(const Configuration &config) {
+  ComputeRanges(config, global_, local_);
+}
+
 // Iterates over all modifiers (e.g. add a local multiplier) and applies these values to the
 // global/local thread-sizes. Modified results are kept in temporary values, but are finally
-// copied back to the member variables global_ and local_.
-void KernelInfo::ComputeRanges(const Configuration &config) {
+// copied to the output arguments.
+void KernelInfo::ComputeRanges(const Configuration &config, IntRange &global,
+                               IntRange &local) const {
 
   // Initializes the result vectors
   size_t num_dimensions = global_base_.size();
@@ -142,8 +188,8 @@ void KernelInfo::ComputeRanges(const Configuration &config) {
   }
 
   // Stores the final integer results
-  global_ = global_values;
-  local_ = local_values;
+  global = global_values;
+  local = local_values;
 }
 
 // =================================================================================================
@@ -180,11 +226,93 @@ void KernelInfo::PopulateConfigurations(const size_t index, const Configuration
   }
 }
 
+// Multiplies the number of values of all parameters. Throws if the space cannot be indexed.
+size_t KernelInfo::NumRawConfigurations() const {
+  auto num_configurations = size_t{1};
+  for (auto &parameter: parameters_) {
+    auto num_values = parameter.values.size();
+    if (num_values == 0) { return 0; }
+    if (num_configurations > std::numeric_limits<size_t>::max() / num_values) {
+      throw Exception("Search space too large to be indexed");
+    }
+    num_configurations *= num_values;
+  }
+  return num_configurations;
+}
+
+// Converts the index into a configuration by treating it as a mixed-radix number, in which each
+// digit is the position of a value in the list of values of the corresponding parameter.
+KernelInfo::Configuration KernelInfo::ConfigurationFromIndex(const size_t index) const {
+  auto config = Configuration(parameters_.size());
+  auto remainder = index;
+  for (auto p=parameters_.size(); p>0; --p) {
+    const auto &parameter = parameters_[p-1];
+    const auto num_values = parameter.values.size();
+    config[p-1] = Setting{parameter.name, parameter.values[remainder % num_values]};
+    remainder /= num_values;
+  }
+  return config;
+}
+
+// Encodes the configuration as a mixed-radix number (see above). Settings are matched against the
+// parameters by name, such that the order of the settings does not matter.
+size_t KernelInfo::IndexFromConfiguration(const Configuration &config) const {
+  const auto num_raw_configurations = NumRawConfigurations();
+  auto index = size_t{0};
+  for (auto &parameter: parameters_) {
+    auto position = parameter.values.size();
+    for (auto &setting: config) {
+      if (setting.name != parameter.name) { continue; }
+      const auto value = std::find(parameter.values.begin(), parameter.values.end(), setting.value);
+      position = static_cast<size_t>(value - parameter.values.begin());
+      break;
+    }
+    if (position == parameter.values.size()) { return num_raw_configurations; }
+    index = index*parameter.values.size() + position;
+  }
+  return index;
+}
+
+// Hashes the characters one-by-one using the 64-bit FNV-1a constants. Unlike std::hash, this is the
+// same across platforms and standard libraries.
+std::string KernelInfo::SourceHash() const {
+  auto hash = uint64_t{14695981039346656037ULL};
+  for (auto &character: source_) {
+    hash ^= static_cast<uint64_t>(static_cast<unsigned char>(character));
+    hash *= uint64_t{1099511628211ULL};
+  }
+  std::stringstream hash_string;
+  hash_string << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return hash_string.str();
+}
+
+// Searches the modifiers for the name and the source-code for the name as a whole identifier (e.g.
+// "WPT" doesn't use "WP"). Comments are not skipped, so a parameter which is only mentioned in a
+// comment counts as used.
+bool KernelInfo::UsesParameter(const std::string &name) const {
+  for (auto &modifier: thread_size_modifiers_) {
+    if (std::find(modifier.value.begin(), modifier.value.end(), name) != modifier.value.end()) {
+      return true;
+    }
+  }
+  auto is_identifier = [](const char character) {
+    return std::isalnum(static_cast<unsigned char>(character)) || character == '_';
+  };
+  for (auto pos = source_.find(name); pos != std::string::npos; pos = source_.find(name, pos + 1)) {
+    const auto end = pos + name.size();
+    if ((pos == 0 || !is_identifier(source_[pos - 1])) &&
+        (end == source_.size() || !is_identifier(source_[end]))) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Loops over all user-defined constraints to check whether or not the configuration is valid.
 // Assumes initially all configurations are valid, then returns false if one of the constraints has
 // not been met. Constraints consist of a user-defined function and a list of parameter names, which
 // are replaced by parameter values in this function.
-inline bool KernelInfo::ValidConfiguration(const Configuration &config) {
+bool KernelInfo::ValidConfiguration(const Configuration &config) {
 
   // Iterates over all constraints
   for (auto &constraint: constraints_) {
@@ -213,19 +341,7 @@ inline bool KernelInfo::ValidConfiguration(const Configuration &config) {
   if (!device_.IsThreadConfigValid(local_)) { return false; };
 
   // Verifies the local memory usage
-  std::vector<size_t> values_local_memory(0);
-  for (auto &parameter: local_memory_.parameters) {
-    for (auto &setting: config) {
-      if (setting.name == parameter) {
-        values_local_memory.push_back(setting.value);
-        break;
-      }
-    }
-  }
-  if (local_memory_.parameters.size() != values_local_memory.size()) {
-    throw Exception("Invalid settings for the local memory usage constraint");
-  }
-  auto local_mem_usage = local_memory_.amount(values_local_memory);
+  auto local_mem_usage = LocalMemoryUsage(config);
   if (!device_.IsLocalMemoryValid(local_mem_usage)) { return false; };
 
   // Everything was OK: this configuration is valid
@@ -0,0 +1,307 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the Matrix class and the GEMV/GEMM routines (see the header for information
+// about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/ml_matrix.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+namespace cltune {
+// =================================================================================================
+
+// Below this length, an inner loop is considered too short to be vectorized efficiently
+const size_t kMinDotLength = size_t{16};
+
+// =================================================================================================
+
+// Constructors
+template <typename T>
+Matrix<T>::Matrix():
+    rows_(0),
+    cols_(0),
+    data_() {
+}
+template <typename T>
+Matrix<T>::Matrix(const size_t rows, const size_t cols, const T value):
+    rows_(rows),
+    cols_(cols),
+    data_(rows*cols, value) {
+}
+template <typename T>
+Matrix<T>::Matrix(const std::vector<std::vector<T>> &rows):
+    rows_(rows.size()),
+    cols_((rows.size() == 0) ? 0 : rows[0].size()),
+    data_() {
+  data_.reserve(rows_*cols_);
+  for (auto &row: rows) {
+    if (row.size() != cols_) { throw std::runtime_error("Rows of a matrix differ in length"); }
+    data_.insert(data_.end(), row.begin(), row.end());
+  }
+}
+
+// Resizes the underlying storage
+template <typename T>
+void Matrix<T>::Resize(const size_t rows, const size_t cols) {
+  rows_ = rows;
+  cols_ = cols;
+  data_.resize(rows*cols);
+}
+
+// Grows the underlying storage, which is row-major, such that the existing rows stay in place
+template <typename T>
+void Matrix<T>::AddRow(const T* values) {
+  data_.insert(data_.end(), values, values + cols_);
+  ++rows_;
+}
+
+// =================================================================================================
+
+// Dot product. This uses multiple independent partial sums: the compiler is not allowed to reorder
+// a single floating-point sum, but it can map the partial sums onto the lanes of a vector register.
+template <typename T>
+T Dot(const T* a, const T* b, const size_t n) {
+  const auto kLanes = size_t{8};
+  T sums[kLanes] = {};
+  const auto n_vector = n - (n % kLanes);
+  for (auto i=size_t{0}; i<n_vector; i+=kLanes) {
+    for (auto lane=size_t{0}; lane<kLanes; ++lane) {
+      sums[lane] += a[i + lane] * b[i + lane];
+    }
+  }
+  auto result = static_cast<T>(0);
+  for (auto lane=size_t{0}; lane<kLanes; ++lane) { result += sums[lane]; }
+  for (auto i=n_vector; i<n; ++i) { result += a[i] * b[i]; }
+  return result;
+}
+
+// Transposes the matrix in blocks, such that both the reads and the writes stay within the cache
+template <typename T>
+void Transpose(const Matrix<T> &a, Matrix<T> &b) {
+  const auto kBlock = size_t{32};
+  b.Resize(a.cols(), a.rows());
+  for (auto r0=size_t{0}; r0<a.rows(); r0+=kBlock) {
+    for (auto c0=size_t{0}; c0<a.cols(); c0+=kBlock) {
+      for (auto r=r0; r<std::min(r0 + kBlock, a.rows()); ++r) {
+        for (auto c=c0; c<std::min(c0 + kBlock, a.cols()); ++c) {
+          b(c, r) = a(r, c);
+        }
+      }
+    }
+  }
+}
+
+// Computes y = A*x as a dot product per row of A
+template <typename T>
+void Gemv(const Matrix<T> &a, const std::vector<T> &x, std::vector<T> &y) {
+  if (x.size() != a.cols()) { throw std::runtime_error("Gemv: invalid vector size"); }
+  y.resize(a.rows());
+  for (auto r=size_t{0}; r<a.rows(); ++r) {
+    y[r] = Dot(a.row(r), x.data(), a.cols());
+  }
+}
+
+// Computes y = A^T*x by accumulating scaled rows of A (an axpy per row), keeping the accesses to A
+// contiguous
+template <typename T>
+void GemvTransposed(const Matrix<T> &a, const std::vector<T> &x, std::vector<T> &y) {
+  if (x.size() != a.rows()) { throw std::runtime_error("GemvTransposed: invalid vector size"); }
+  const auto n = a.cols();
+  y.assign(n, static_cast<T>(0));
+  auto y_data = y.data();
+  for (auto r=size_t{0}; r<a.rows(); ++r) {
+    const auto a_row = a.row(r);
+    const auto scale = x[r];
+    for (auto c=size_t{0}; c<n; ++c) {
+      y_data[c] += scale * a_row[c];
+    }
+  }
+}
+
+// Computes C = A*B, looping over k in the middle such that the inner loop runs over rows of B and C
+template <typename T>
+void Gemm(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c) {
+  if (a.cols() != b.rows()) { throw std::runtime_error("Gemm: invalid matrix sizes"); }
+  const auto n = b.cols();
+  c.Resize(a.rows(), n);
+  for (auto i=size_t{0}; i<a.rows(); ++i) {
+    auto c_row = c.row(i);
+    for (auto j=size_t{0}; j<n; ++j) { c_row[j] = static_cast<T>(0); }
+    for (auto k=size_t{0}; k<a.cols(); ++k) {
+      const auto a_value = a(i, k);
+      const auto b_row = b.row(k);
+      for (auto j=size_t{0}; j<n; ++j) {
+        c_row[j] += a_value * b_row[j];
+      }
+    }
+  }
+}
+
+// Computes C = A*B^T: each element is a dot product of a row of A and a row of B. If the rows are
+// short but B has many rows, B is transposed first such that the inner loop runs over those instead.
+template <typename T>
+void GemmNT(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c) {
+  if (a.cols() != b.cols()) { throw std::runtime_error("GemmNT: invalid matrix sizes"); }
+  if (a.cols() < kMinDotLength && b.rows() >= kMinDotLength) {
+    auto b_transposed = Matrix<T>();
+    Transpose(b, b_transposed);
+    Gemm(a, b_transposed, c);
+    return;
+  }
+  c.Resize(a.rows(), b.rows());
+  for (auto i=size_t{0}; i<a.rows(); ++i) {
+    for (auto j=size_t{0}; j<b.rows(); ++j) {
+      c(i, j) = Dot(a.row(i), b.row(j), a.cols());
+    }
+  }
+}
+
+// Computes C = A^T*B as a sum of outer products of the rows of A and B. If the matrices are tall and
+// narrow (e.g. the gradients over many samples), both are transposed first, such that each element
+// is a long dot product instead.
+template <typename T>
+void GemmTN(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c) {
+  if (a.rows() != b.rows()) { throw std::runtime_error("GemmTN: invalid matrix sizes"); }
+  if (b.cols() < kMinDotLength && a.rows() >= kMinDotLength) {
+    auto a_transposed = Matrix<T>();
+    auto b_transposed = Matrix<T>();
+    Transpose(a, a_transposed);
+    Transpose(b, b_transposed);
+    GemmNT(a_transposed, b_transposed, c);
+    return;
+  }
+  const auto n = b.cols();
+  c.Resize(a.cols(), n);
+  for (auto &value: c.data()) { value = static_cast<T>(0); }
+  for (auto k=size_t{0}; k<a.rows(); ++k) {
+    const auto a_row = a.row(k);
+    const auto b_row = b.row(k);
+    for (auto i=size_t{0}; i<a.cols(); ++i) {
+      const auto a_value = a_row[i];
+      auto c_row = c.row(i);
+      for (auto j=size_t{0}; j<n; ++j) {
+        c_row[j] += a_value * b_row[j];
+      }
+    }
+  }
+}
+
+// =================================================================================================
+
+// Computes the lower-triangular L with A = L*L^T in place (row by row). Returns false if A is not
+// positive definite.
+template <typename T>
+bool CholeskyDecompose(Matrix<T> &a) {
+  const auto n = a.rows();
+  for (auto i=size_t{0}; i<n; ++i) {
+    for (auto j=size_t{0}; j<=i; ++j) {
+      const auto sum = a(i, j) - Dot(a.row(i), a.row(j), j);
+      if (i == j) {
+        if (!(sum > static_cast<T>(0))) { return false; }
+        a(i, i) = std::sqrt(sum);
+      }
+      else {
+        a(i, j) = sum / a(j, j);
+      }
+    }
+  }
+  return true;
+}
+
+// Solves L*L^T*x = b given the decomposition L: a forward substitution with L and a backward
+// substitution with L^T
+template <typename T>
+void CholeskySubstitute(const Matrix<T> &l, std::vector<T> &b) {
+  const auto n = l.rows();
+  for (auto i=size_t{0}; i<n; ++i) {
+    b[i] = (b[i] - Dot(l.row(i), b.data(), i)) / l(i, i);
+  }
+  for (auto i=n; i>0; --i) {
+    auto sum = b[i-1];
+    for (auto k=i; k<n; ++k) { sum -= l(k, i-1) * b[k]; }
+    b[i-1] = sum / l(i-1, i-1);
+  }
+}
+
+// Decomposes and substitutes
+template <typename T>
+bool CholeskySolve(Matrix<T> &a, std::vector<T> &b) {
+  const auto n = a.rows();
+  if (a.cols() != n || b.size() != n) { throw std::runtime_error("CholeskySolve: invalid sizes"); }
+  if (!CholeskyDecompose(a)) { return false; }
+  CholeskySubstitute(a, b);
+  return true;
+}
+
+// Decomposes and solves for each column of the identity matrix in turn
+template <typename T>
+bool CholeskyInvert(Matrix<T> &a) {
+  const auto n = a.rows();
+  if (a.cols() != n) { throw std::runtime_error("CholeskyInvert: invalid sizes"); }
+  if (!CholeskyDecompose(a)) { return false; }
+  auto inverse = Matrix<T>(n, n);
+  auto column = std::vector<T>(n);
+  for (auto j=size_t{0}; j<n; ++j) {
+    std::fill(column.begin(), column.end(), static_cast<T>(0));
+    column[j] = static_cast<T>(1);
+    CholeskySubstitute(a, column);
+    for (auto i=size_t{0}; i<n; ++i) { inverse(i, j) = column[i]; }
+  }
+  a = inverse;
+  return true;
+}
+
+// =================================================================================================
+
+// Compiles the class and the routines
+template class Matrix<float>;
+template class Matrix<double>;
+template float Dot<float>(const float*, const float*, const size_t);
+template double Dot<double>(const double*, const double*, const size_t);
+template void Transpose<float>(const Matrix<float>&, Matrix<float>&);
+template void Transpose<double>(const Matrix<double>&, Matrix<double>&);
+template void Gemv<float>(const Matrix<float>&, const std::vector<float>&, std::vector<float>&);
+template void Gemv<double>(const Matrix<double>&, const std::vector<double>&, std::vector<double>&);
+template void GemvTransposed<float>(const Matrix<float>&, const std::vector<float>&,
+                                    std::vector<float>&);
+template void GemvTransposed<double>(const Matrix<double>&, const std::vector<double>&,
+                                     std::vector<double>&);
+template void Gemm<float>(const Matrix<float>&, const Matrix<float>&, Matrix<float>&);
+template void Gemm<double>(const Matrix<double>&, const Matrix<double>&, Matrix<double>&);
+template void GemmNT<float>(const Matrix<float>&, const Matrix<float>&, Matrix<float>&);
+template void GemmNT<double>(const Matrix<double>&, const Matrix<double>&, Matrix<double>&);
+template void GemmTN<float>(const Matrix<float>&, const Matrix<float>&, Matrix<float>&);
+template void GemmTN<double>(const Matrix<double>&, const Matrix<double>&, Matrix<double>&);
+template bool CholeskySolve<float>(Matrix<float>&, std::vector<float>&);
+template bool CholeskySolve<double>(Matrix<double>&, std::vector<double>&);
+template bool CholeskyInvert<float>(Matrix<float>&);
+template bool CholeskyInvert<double>(Matrix<double>&);
+
+// =================================================================================================
+} // namespace cltune
@@ -28,85 +28,266 @@
 // The corresponding header file
 #include "internal/ml_model.h"
 
+// The derived models, to be created when loading
+#include "internal/ml_models/linear_regression.h"
+#include "internal/ml_models/neural_network.h"
+#include "internal/ml_models/gradient_boosted_trees.h"
+
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <exception>
+#include <iomanip>
 
 namespace cltune {
 // =================================================================================================
 
+// Chunks of rows are small enough to keep the pre-processed features in the cache. Below the minimum
+// number of predictions per thread, the threading overhead dominates.
+template <typename T> const size_t MLModel<T>::kPredictChunkRows = size_t{1024};
+template <typename T> const size_t MLModel<T>::kMinPredictionsPerThread = size_t{4096};
+
 // Simple constructor
 template <typename T>
 MLModel<T>::MLModel(const bool debug_display):
-    debug_display_(debug_display) {
+    debug_display_(debug_display),
+    max_threads_(HardwareThreads()) {
+}
+
+// Sets the thread limit (at least one thread)
+template <typename T>
+void MLModel<T>::SetMaxThreads(const size_t max_threads) {
+  max_threads_ = std::max(size_t{1}, max_threads);
+}
+
+// The hardware concurrency is zero if it is not known
+template <typename T>
+size_t MLModel<T>::HardwareThreads() {
+  return std::max(size_t{1}, static_cast<size_t>(std::thread::hardware_concurrency()));
 }
 
 // =================================================================================================
 
-// Finds the ranges and the means for each feature
+// Models don't support incremental updates unless they implement them
 template <typename T>
-void MLModel<T>::ComputeNormalizations(const std::vector<std::vector<T>> &x) {
-  auto m = x.size();
-  auto n = x[0].size();
+bool MLModel<T>::Update(const std::vector<std::vector<T>> &, const std::vector<T> &) {
+  return false;
+}
 
-  // Loops over the features
-  ranges_.resize(n, static_cast<T>(1));
-  means_.resize(n, static_cast<T>(0));
-  for (auto nid=size_t{0}; nid<n; ++nid) {
+// Prediction of a single sample: treats it as a chunk of one row
+template <typename T>
+T MLModel<T>::Predict(const std::vector<T> &x) const {
+  auto x_chunk = Matrix<T>(1, x.size());
+  std::copy(x.begin(), x.end(), x_chunk.row(0));
+  return PredictRows(x_chunk)[0];
+}
 
-    // Finds the maximum, the minimum, and the sum
-    auto min = std::numeric_limits<T>::max();
-    auto max = -min;
-    auto sum = static_cast<T>(0);
-    for (auto mid=size_t{0}; mid<m; ++mid) {
-      auto value = x[mid][nid];
-      if (value > max) { max = value; }
-      if (value < min) { min = value; }
-      sum += value;
+// Batched prediction: each thread copies a chunk of rows at a time into its own matrix, such that
+// the pre-processing can be done in-place
+template <typename T>
+std::vector<T> MLModel<T>::PredictBatch(const Matrix<T> &x) const {
+  const auto n = x.cols();
+  return PredictBatch(x.rows(), n, [&x, n] (const size_t sample, T* features) {
+    std::copy(x.row(sample), x.row(sample) + n, features);
+  });
+}
+
+// Each chunk is encoded into a matrix of the thread and predicted in-place
+template <typename T>
+std::vector<T> MLModel<T>::PredictBatch(const size_t m, const size_t n,
+                                        const SampleEncoder &encode) const {
+  auto predictions = std::vector<T>(m);
+  ForEachChunk(m, max_threads_, [this, &encode, &predictions, n] (const size_t begin,
+                                                                   const size_t end) {
+    auto x_chunk = Matrix<T>(end - begin, n);
+    for (auto sample=begin; sample<end; ++sample) { encode(sample, x_chunk.row(sample - begin)); }
+    const auto chunk_predictions = PredictRows(x_chunk);
+    std::copy(chunk_predictions.begin(), chunk_predictions.end(), predictions.begin() + begin);
+  });
+  return predictions;
+}
+
+// Each thread processes a contiguous range of the samples, the calling thread the first
+template <typename T>
+void MLModel<T>::ForEachChunk(const size_t m, const size_t max_threads,
+                              const std::function<void(size_t, size_t)> &process) {
+  const auto num_threads = std::max(size_t{1}, std::min(max_threads, m / kMinPredictionsPerThread));
+  auto errors = std::vector<std::exception_ptr>(num_threads);
+  auto process_range = [&process, &errors, m, num_threads] (const size_t tid) {
+    try {
+      const auto end = (m*(tid + 1))/num_threads;
+      for (auto begin=(m*tid)/num_threads; begin<end; begin+=kPredictChunkRows) {
+        process(begin, std::min(begin + kPredictChunkRows, end));
+      }
+    } catch (...) {
+      errors[tid] = std::current_exception();
+    }
+  };
+  auto threads = std::vector<std::thread>();
+  for (auto tid=size_t{1}; tid<num_threads; ++tid) { threads.emplace_back(process_range, tid); }
+  process_range(0);
+  for (auto &thread: threads) { thread.join(); }
+
+  // Passes on the first error of any of the threads
+  for (auto &error: errors) {
+    if (error) { std::rethrow_exception(error); }
+  }
+}
+
+// =================================================================================================
+
+// Writes the type of the model and the normalization data, followed by the model-specific parameters.
+// Values are written with enough digits to be read back exactly.
+template <typename T>
+void MLModel<T>::Save(std::ostream &file) const {
+  file << std::setprecision(std::numeric_limits<T>::max_digits10);
+  file << Name() << "\n";
+  SaveVector(file, means_);
+  SaveVector(file, ranges_);
+  SaveParameters(file);
+  if (!file) { throw std::runtime_error("Could not write the model"); }
+}
+
+// Creates a model of the saved type (its settings only matter for training) and reads its data
+template <typename T>
+std::unique_ptr<MLModel<T>> MLModel<T>::Load(std::istream &file) {
+  auto name = std::string{};
+  file >> name;
+  auto model = std::unique_ptr<MLModel<T>>();
+  if (name == "linear_regression") {
+    model.reset(new LinearRegression<T>(static_cast<T>(0), false));
+  }
+  else if (name == "neural_network") {
+    model.reset(new NeuralNetwork<T>(0, static_cast<T>(0), static_cast<T>(0), {1, 1}, 1, false, 0));
+  }
+  else if (name == "gradient_boosted_trees") {
+    model.reset(new GradientBoostedTrees<T>(0, static_cast<T>(0), 0, 1, static_cast<T>(0), false));
+  }
+  else {
+    throw std::runtime_error("Unknown machine learning model in model file: "+name);
+  }
+  model->means_ = LoadVector(file);
+  model->ranges_ = LoadVector(file);
+  model->LoadParameters(file);
+  if (!file) { throw std::runtime_error("Invalid model file"); }
+  return model;
+}
+
+// Writes a vector on a single line
+template <typename T>
+void MLModel<T>::SaveVector(std::ostream &file, const std::vector<T> &values) {
+  file << values.size();
+  for (auto &value: values) { file << " " << value; }
+  file << "\n";
+}
+template <typename T>
+std::vector<T> MLModel<T>::LoadVector(std::istream &file) {
+  auto size = size_t{0};
+  file >> size;
+  auto values = std::vector<T>();
+  for (auto i=size_t{0}; i<size && file; ++i) {
+    auto value = static_cast<T>(0);
+    file >> value;
+    values.push_back(value);
+  }
+  return values;
+}
+
+// Writes a matrix on a single line, starting with its number of rows and columns
+template <typename T>
+void MLModel<T>::SaveMatrix(std::ostream &file, const Matrix<T> &matrix) {
+  file << matrix.rows() << " " << matrix.cols();
+  for (auto &value: matrix.data()) { file << " " << value; }
+  file << "\n";
+}
+template <typename T>
+Matrix<T> MLModel<T>::LoadMatrix(std::istream &file) {
+  auto rows = size_t{0};
+  auto cols = size_t{0};
+  file >> rows >> cols;
+  if (!file) { return Matrix<T>(); }
+  auto matrix = Matrix<T>(rows, cols);
+  for (auto &value: matrix.data()) { file >> value; }
+  return matrix;
+}
+
+// =================================================================================================
+
+// Finds the ranges and the means for each feature
+template <typename T>
+void MLModel<T>::ComputeNormalizations(const Matrix<T> &x) {
+  auto m = x.rows();
+  auto n = x.cols();
+
+  // Finds the maximum, the minimum, and the sum of all features by passing over the rows once
+  auto mins = std::vector<T>(n, std::numeric_limits<T>::max());
+  auto maxs = std::vector<T>(n, -std::numeric_limits<T>::max());
+  auto sums = std::vector<T>(n, static_cast<T>(0));
+  for (auto mid=size_t{0}; mid<m; ++mid) {
+    const auto xi = x.row(mid);
+    for (auto nid=size_t{0}; nid<n; ++nid) {
+      maxs[nid] = std::max(maxs[nid], xi[nid]);
+      mins[nid] = std::min(mins[nid], xi[nid]);
+      sums[nid] += xi[nid];
     }
+  }
 
-    // Sets the range and the mean
-    ranges_[nid] = max - min;
-    means_[nid] = sum / static_cast<T>(m);
+  // Sets the ranges and the means
+  ranges_.resize(n);
+  means_.resize(n);
+  for (auto nid=size_t{0}; nid<n; ++nid) {
+    ranges_[nid] = maxs[nid] - mins[nid];
+    means_[nid] = sums[nid] / static_cast<T>(m);
   }
 }
 
 // Normalizes the training features based on previously calculated ranges and means
 template <typename T>
-void MLModel<T>::NormalizeFeatures(std::vector<std::vector<T>> &x) const {
-  for (auto mid=size_t{0}; mid<x.size(); ++mid) {
-    for (auto nid=size_t{0}; nid<x[mid].size(); ++nid) {
-      auto value = x[mid][nid] - means_[nid];
-      x[mid][nid] = (ranges_[nid] == static_cast<T>(0)) ? value : value / ranges_[nid];
+void MLModel<T>::NormalizeFeatures(Matrix<T> &x) const {
+  for (auto mid=size_t{0}; mid<x.rows(); ++mid) {
+    auto xi = x.row(mid);
+    for (auto nid=size_t{0}; nid<x.cols(); ++nid) {
+      auto value = xi[nid] - means_[nid];
+      xi[nid] = (ranges_[nid] == static_cast<T>(0)) ? value : value / ranges_[nid];
     }
   }
 }
 
 // Adds polynominal combinations of features as new features. This is implemented using recursion
-// and allows any order larger than 1.
+// and allows any order larger than 1. Each monomial is added once: the indices of its features are
+// non-decreasing (e.g. x0*x1 but not also x1*x0, which would make the features linearly dependent).
 template <typename T>
-void MLModel<T>::AddPolynomialFeatures(std::vector<std::vector<T>> &x,
-                                       const std::vector<size_t> &orders) const {
-  for (auto mid=size_t{0}; mid<x.size(); ++mid) {
-    auto n = x[mid].size();
+Matrix<T> MLModel<T>::AddPolynomialFeatures(const Matrix<T> &x,
+                                            const std::vector<size_t> &orders) const {
+  auto n = x.cols();
+  auto xi = std::vector<T>();
+  auto result = Matrix<T>();
+  for (auto mid=size_t{0}; mid<x.rows(); ++mid) {
+    xi.assign(x.row(mid), x.row(mid) + n);
     for (auto &order: orders) {
       if (order > 1) {
-        x[mid].reserve(x[mid].size() + static_cast<size_t>(pow(n, order)));
-        AddPolynomialRecursive(x[mid], order, size_t{1}, n);
+        AddPolynomialRecursive(xi, order, static_cast<T>(1), 0, n);
       }
     }
+    if (mid == 0) { result.Resize(x.rows(), xi.size()); }
+    std::copy(xi.begin(), xi.end(), result.row(mid));
   }
+  return result;
 }
 template <typename T>
 void MLModel<T>::AddPolynomialRecursive(std::vector<T> &xi, const size_t order, const T value,
-                                        const size_t n) const {
+                                        const size_t first, const size_t n) const {
   if (order == 0) {
     xi.push_back(value);
   }
   else {
-    for (auto nid=size_t{0}; nid<n; ++nid) {
-      AddPolynomialRecursive(xi, order-1, value*xi[nid], n);
+    for (auto nid=first; nid<n; ++nid) {
+      AddPolynomialRecursive(xi, order-1, value*xi[nid], nid, n);
     }
   }
 }
@@ -114,28 +295,72 @@ void MLModel<T>::AddPolynomialRecursive(std::vector<T> &xi, const size_t order,
 // =================================================================================================
 
 // Implements the gradient descent iterative search algorithm. This method is based upon a cost-
-// function and gradient-function implemented by the derived class.
+// function and gradient-function implemented by the derived class. The cost is only computed when
+// it is reported, such that each iteration takes a single pass over the data.
 template <typename T>
-void MLModel<T>::GradientDescent(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
+void MLModel<T>::GradientDescent(const Matrix<T> &x, const std::vector<T> &y,
                                  const T alpha, const T lambda, const size_t iterations) {
-  auto m = x.size();
-  auto n = x[0].size();
 
   // Sets the initial theta values
-  InitializeTheta(n);
+  InitializeTheta(x.cols());
 
   // Runs gradient descent
+  const auto report_interval = std::max(size_t{1}, iterations/kGradientDescentCostReportAmount);
   for (auto iter=size_t{0}; iter<iterations; ++iter) {
 
     // Computes the cost (to monitor convergence)
-    auto cost = Cost(m, n, lambda, x, y);
-    if ((iter+1) % (iterations/kGradientDescentCostReportAmount) == 0) {
+    if (debug_display_ && (iter+1) % report_interval == 0) {
+      auto cost = Cost(lambda, x, y);
       printf("%s Gradient descent %zu/%zu: cost %.2e\n",
              TunerImpl::kMessageInfo.c_str(), iter+1, iterations, cost);
     }
-    
+
     // Computes the gradients and the updated parameters
-    Gradient(m, n, lambda, alpha, x, y);
+    Gradient(lambda, alpha, x, y);
+  }
+}
+
+// Minibatch gradient descent: the samples are shuffled each epoch and gathered into a minibatch
+// matrix, which is re-used across minibatches
+template <typename T>
+void MLModel<T>::MinibatchGradientDescent(const Matrix<T> &x, const std::vector<T> &y,
+                                          const T alpha, const T lambda, const size_t epochs,
+                                          const size_t batch_size, const unsigned int seed) {
+  const auto m = x.rows();
+  const auto n = x.cols();
+  if (batch_size == 0) { throw std::runtime_error("Invalid minibatch size"); }
+
+  // Sets the initial theta values
+  InitializeTheta(n);
+
+  // Creates the (seeded) shuffled order of the samples and the minibatch storage
+  std::default_random_engine generator(seed);
+  auto order = std::vector<size_t>(m);
+  std::iota(order.begin(), order.end(), size_t{0});
+  auto x_batch = Matrix<T>();
+  auto y_batch = std::vector<T>();
+
+  // Runs minibatch gradient descent
+  const auto report_interval = std::max(size_t{1}, epochs/kGradientDescentCostReportAmount);
+  for (auto epoch=size_t{0}; epoch<epochs; ++epoch) {
+    std::shuffle(order.begin(), order.end(), generator);
+    for (auto begin=size_t{0}; begin<m; begin+=batch_size) {
+      const auto size = std::min(batch_size, m - begin);
+      x_batch.Resize(size, n);
+      y_batch.resize(size);
+      for (auto mid=size_t{0}; mid<size; ++mid) {
+        std::copy(x.row(order[begin + mid]), x.row(order[begin + mid]) + n, x_batch.row(mid));
+        y_batch[mid] = y[order[begin + mid]];
+      }
+      Gradient(lambda, alpha, x_batch, y_batch);
+    }
+
+    // Computes the cost over all samples (to monitor convergence)
+    if (debug_display_ && (epoch+1) % report_interval == 0) {
+      auto cost = Cost(lambda, x, y);
+      printf("%s Minibatch gradient descent epoch %zu/%zu: cost %.2e\n",
+             TunerImpl::kMessageInfo.c_str(), epoch+1, epochs, cost);
+    }
   }
 }
 
@@ -143,12 +368,13 @@ void MLModel<T>::GradientDescent(const std::vector<std::vector<T>> &x, const std
 
 // Verifies training examples: computes the success rate within a specified margin
 template <typename T>
-float MLModel<T>::SuccessRate(const std::vector<std::vector<T>> &x, const std::vector<T> &y,
+float MLModel<T>::SuccessRate(const Matrix<T> &x, const std::vector<T> &y,
                               const float margin) const {
-  auto m = x.size();
+  auto m = x.rows();
   auto correct = 0;
+  const auto hypotheses = Hypothesis(x);
   for (auto mid=size_t{0}; mid<m; ++mid) {
-    auto hypothesis = PostProcessExecutionTime(Hypothesis(x[mid]));
+    auto hypothesis = PostProcessExecutionTime(hypotheses[mid]);
     auto reference = PostProcessExecutionTime(y[mid]);
     auto limit_max = reference*(1 + margin);
     auto limit_min = reference*(1 - margin);
@@ -161,15 +387,15 @@ float MLModel<T>::SuccessRate(const std::vector<std::vector<T>> &x, const std::v
 
 // Verifies training examples: computes the cost function
 template <typename T>
-float MLModel<T>::Verify(const std::vector<std::vector<T>> &x, const std::vector<T> &y) const {
-  auto m = x.size();
-  auto n = x[0].size();
+float MLModel<T>::Verify(const Matrix<T> &x, const std::vector<T> &y) const {
+  auto m = x.rows();
 
   // Displays the data
   if (debug_display_) {
+    const auto hypotheses = Hypothesis(x);
     printf("hypothesis; actual; error\n");
     for (auto mid=size_t{0}; mid<m; ++mid) {
-      auto hypothesis = PostProcessExecutionTime(Hypothesis(x[mid]));
+      auto hypothesis = PostProcessExecutionTime(hypotheses[mid]);
       auto reference = PostProcessExecutionTime(y[mid]);
       auto relative_error = (reference - hypothesis) / (reference);
       printf("%.3lf;%.3lf;%.2lf%%\n", hypothesis, reference, 100.0f*relative_error);
@@ -177,7 +403,7 @@ float MLModel<T>::Verify(const std::vector<std::vector<T>> &x, const std::vector
   }
 
   // Computes the cost
-  return Cost(m, n, 0, x, y);
+  return Cost(0, x, y);
 }
 // =================================================================================================
 
@@ -0,0 +1,395 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the GradientBoostedTrees class (see the header for information about the
+// class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/ml_models/gradient_boosted_trees.h"
+
+#include <vector>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+
+namespace cltune {
+// =================================================================================================
+
+// The bin of a sample is stored in 8 bits. The split search of a node is only divided over threads
+// if there is enough work, otherwise the threading overhead dominates.
+template <typename T> const size_t GradientBoostedTrees<T>::kMaxBins = size_t{64};
+template <typename T> const size_t GradientBoostedTrees<T>::kMinWorkPerThread = size_t{1} << 16;
+
+// =================================================================================================
+
+// Calls the base-class constructor
+template <typename T>
+GradientBoostedTrees<T>::GradientBoostedTrees(const size_t num_trees, const T learning_rate,
+                                              const size_t max_depth, const size_t min_samples_leaf,
+                                              const T lambda, const bool debug_display):
+    MLModel<T>(debug_display),
+    trees_(),
+    base_(static_cast<T>(0)),
+    edges_(),
+    bins_(),
+    indices_(),
+    predictions_(),
+    residuals_(),
+    num_trees_(num_trees),
+    learning_rate_(learning_rate),
+    max_depth_(max_depth),
+    min_samples_leaf_(std::max(min_samples_leaf, size_t{1})),
+    lambda_(lambda) {
+}
+
+// =================================================================================================
+
+// Trains the model. Trees are insensitive to the scale of the features, so no normalization is
+// needed. The boosting iterations are run through the base-class gradient descent: each iteration
+// adds a tree.
+template <typename T>
+void GradientBoostedTrees<T>::Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
+  auto x_temp = Matrix<T>(x);
+  auto y_temp = y;
+  PreProcessExecutionTimes(y_temp);
+
+  // Runs gradient boosting to train the model
+  GradientDescent(x_temp, y_temp, learning_rate_, lambda_, num_trees_);
+
+  // Releases the training data
+  bins_ = std::vector<uint8_t>();
+  indices_ = std::vector<size_t>();
+  predictions_ = std::vector<T>();
+  residuals_ = std::vector<T>();
+
+  // Verifies and displays the trained results (if requested)
+  auto cost = Verify(x_temp, y_temp);
+  if (debug_display_) {
+    printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  }
+}
+
+// Validates the model
+template <typename T>
+void GradientBoostedTrees<T>::Validate(const std::vector<std::vector<T>> &x,
+                                       const std::vector<T> &y) {
+  auto x_temp = Matrix<T>(x);
+  auto y_temp = y;
+  PreProcessExecutionTimes(y_temp);
+
+  // Verifies and displays the trained results
+  auto cost = Verify(x_temp, y_temp);
+  printf("%s Validation cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+}
+
+// Prediction: passes a single sample through all trees, stopping at the leaves
+template <typename T>
+T GradientBoostedTrees<T>::Predict(const std::vector<T> &x) const {
+  if (x.size() != edges_.size()) { throw std::runtime_error("Invalid number of features"); }
+  auto value = base_;
+  for (auto &tree: trees_) { value += Evaluate(tree, x.data()); }
+  return PostProcessExecutionTime(value);
+}
+
+// Batched prediction: passes the samples through all trees
+template <typename T>
+std::vector<T> GradientBoostedTrees<T>::PredictRows(Matrix<T> &x) const {
+  if (x.cols() != edges_.size()) { throw std::runtime_error("Invalid number of features"); }
+  auto predictions = Hypothesis(x);
+  for (auto &prediction: predictions) { prediction = PostProcessExecutionTime(prediction); }
+  return predictions;
+}
+
+// =================================================================================================
+
+// Pre-processes the execution times using a logarithmic function
+template <typename T>
+void GradientBoostedTrees<T>::PreProcessExecutionTimes(std::vector<T> &y) const {
+  for (auto &value: y) { value = static_cast<T>(log(static_cast<double>(value))); }
+}
+
+// Post-processes an execution time using an exponent function (inverse of the logarithm)
+template <typename T>
+T GradientBoostedTrees<T>::PostProcessExecutionTime(T value) const {
+  return static_cast<T>(exp(static_cast<double>(value)));
+}
+
+// =================================================================================================
+
+// Computes the bins per feature. If a feature has few enough distinct values, each value gets its
+// own bin. Otherwise, the distinct values are divided evenly over the bins. The edges between bins
+// lie halfway between two consecutive values.
+template <typename T>
+void GradientBoostedTrees<T>::ComputeBins(const Matrix<T> &x) {
+  const auto m = x.rows();
+  const auto n = x.cols();
+  edges_.assign(n, std::vector<T>());
+  bins_.resize(n*m);
+  auto values = std::vector<T>(m);
+  for (auto nid=size_t{0}; nid<n; ++nid) {
+    for (auto mid=size_t{0}; mid<m; ++mid) { values[mid] = x(mid, nid); }
+    std::sort(values.begin(), values.end());
+    const auto num_values = static_cast<size_t>(std::unique(values.begin(), values.end()) -
+                                                 values.begin());
+    const auto num_bins = std::min(num_values, kMaxBins);
+    auto &edges = edges_[nid];
+    for (auto bin=size_t{1}; bin<num_bins; ++bin) {
+      const auto index = (bin*num_values)/num_bins;
+      edges.push_back((values[index - 1] + values[index]) / static_cast<T>(2));
+    }
+    for (auto mid=size_t{0}; mid<m; ++mid) {
+      const auto edge = std::lower_bound(edges.begin(), edges.end(), x(mid, nid));
+      bins_[nid*m + mid] = static_cast<uint8_t>(edge - edges.begin());
+    }
+  }
+}
+
+// Removes all trees, such that the bins and the predictions are re-computed on the next iteration
+template <typename T>
+void GradientBoostedTrees<T>::InitializeTheta(const size_t) {
+  trees_.clear();
+  bins_.clear();
+  predictions_.clear();
+}
+
+// =================================================================================================
+
+// Hypothesis-function: passes all samples through the trees. This loops over the trees in the outer
+// loop, such that a tree stays in the cache while it is evaluated for all samples. All samples move
+// down one level of the tree at a time: since the children of a leaf are the leaf itself, this can
+// be done for the maximum depth without branching, and the samples are independent of each other.
+template <typename T>
+std::vector<T> GradientBoostedTrees<T>::Hypothesis(const Matrix<T> &x) const {
+  const auto m = x.rows();
+  auto hypothesis = std::vector<T>(m, base_);
+  auto nodes = std::vector<size_t>(m);
+  for (auto &tree: trees_) {
+    std::fill(nodes.begin(), nodes.end(), size_t{0});
+    for (auto depth=size_t{0}; depth<max_depth_; ++depth) {
+      for (auto mid=size_t{0}; mid<m; ++mid) {
+        const auto &node = tree[nodes[mid]];
+        const auto right = static_cast<size_t>(x(mid, node.feature) > node.threshold);
+        nodes[mid] = node.left + right*(node.right - node.left);
+      }
+    }
+    for (auto mid=size_t{0}; mid<m; ++mid) { hypothesis[mid] += tree[nodes[mid]].value; }
+  }
+  return hypothesis;
+}
+
+// Cost-function: computes the mean of the squared differences
+template <typename T>
+T GradientBoostedTrees<T>::Cost(const T, const Matrix<T> &x, const std::vector<T> &y) const {
+  const auto hypothesis = Hypothesis(x);
+  auto cost = static_cast<T>(0);
+  for (auto mid=size_t{0}; mid<x.rows(); ++mid) {
+    auto difference = hypothesis[mid] - y[mid];
+    cost += difference * difference;
+  }
+  return cost / static_cast<T>(x.rows());
+}
+
+// Gradient-function: fits a new tree to the residuals of the current model. The first iteration
+// bins the features and starts from the mean of the training data.
+template <typename T>
+void GradientBoostedTrees<T>::Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                                       const std::vector<T> &y) {
+  const auto m = x.rows();
+  if (m == 0) { throw std::runtime_error("No training data"); }
+  if (trees_.empty()) {
+    ComputeBins(x);
+    base_ = std::accumulate(y.begin(), y.end(), static_cast<T>(0)) / static_cast<T>(m);
+    predictions_.assign(m, base_);
+  }
+
+  // Computes the residuals and builds the tree, which also updates the predictions
+  residuals_.resize(m);
+  for (auto mid=size_t{0}; mid<m; ++mid) { residuals_[mid] = y[mid] - predictions_[mid]; }
+  indices_.resize(m);
+  std::iota(indices_.begin(), indices_.end(), size_t{0});
+  auto tree = Tree();
+  BuildNode(tree, 0, m, 0, lambda, alpha);
+  trees_.push_back(tree);
+}
+
+// =================================================================================================
+
+// Creates a leaf, or splits the node if that reduces the (regularized) squared error. The value of
+// a leaf is the regularized mean of its residuals, scaled by the learning rate.
+template <typename T>
+size_t GradientBoostedTrees<T>::BuildNode(Tree &tree, const size_t begin, const size_t end,
+                                          const size_t depth, const T lambda, const T alpha) {
+  const auto m = residuals_.size();
+  const auto n = edges_.size();
+  const auto num_samples = end - begin;
+  auto sum = 0.0;
+  for (auto i=begin; i<end; ++i) { sum += residuals_[indices_[i]]; }
+  const auto value = static_cast<T>(alpha * sum / (num_samples + lambda));
+  const auto node_id = tree.size();
+  tree.push_back(Node{true, value, 0, static_cast<T>(0), node_id, node_id});
+
+  // Finds the best split, dividing the features over threads
+  if (depth < max_depth_ && num_samples >= 2*min_samples_leaf_ && n > 0) {
+    const auto max_threads = std::min(max_threads_, (num_samples*n) / kMinWorkPerThread);
+    const auto num_threads = std::max(size_t{1}, std::min(max_threads, n));
+    auto splits = std::vector<Split>(num_threads, Split{0.0, 0, 0});
+    auto threads = std::vector<std::thread>();
+    for (auto tid=size_t{1}; tid<num_threads; ++tid) {
+      threads.emplace_back(&GradientBoostedTrees<T>::FindSplit, this, begin, end,
+                           (n*tid)/num_threads, (n*(tid + 1))/num_threads,
+                           static_cast<double>(lambda), std::ref(splits[tid]));
+    }
+    FindSplit(begin, end, 0, n/num_threads, static_cast<double>(lambda), splits[0]);
+    for (auto &thread: threads) { thread.join(); }
+    auto best = splits[0];
+    for (auto &split: splits) {
+      if (split.gain > best.gain) { best = split; }
+    }
+
+    // Splits the samples and builds the two sub-trees
+    if (best.gain > 0.0) {
+      const auto bins = &bins_[best.feature*m];
+      const auto middle = std::partition(indices_.begin() + begin, indices_.begin() + end,
+                                         [bins, &best] (const size_t i) -> bool {
+                                           return bins[i] <= best.bin;
+                                         });
+      const auto split = static_cast<size_t>(middle - indices_.begin());
+      const auto left = BuildNode(tree, begin, split, depth + 1, lambda, alpha);
+      const auto right = BuildNode(tree, split, end, depth + 1, lambda, alpha);
+      tree[node_id] = Node{false, value, best.feature, edges_[best.feature][best.bin], left, right};
+      return node_id;
+    }
+  }
+
+  // Leaf node: updates the predictions of its samples
+  for (auto i=begin; i<end; ++i) { predictions_[indices_[i]] += value; }
+  return node_id;
+}
+
+// Builds a histogram of the sums of the residuals and the sample counts per bin, after which each
+// split between two bins is evaluated by accumulating the histogram from left to right
+template <typename T>
+void GradientBoostedTrees<T>::FindSplit(const size_t begin, const size_t end,
+                                        const size_t feature_begin, const size_t feature_end,
+                                        const double lambda, Split &split) const {
+  const auto m = residuals_.size();
+  auto sums = std::vector<double>(kMaxBins);
+  auto counts = std::vector<size_t>(kMaxBins);
+  for (auto nid=feature_begin; nid<feature_end; ++nid) {
+    const auto num_bins = edges_[nid].size() + 1;
+    if (num_bins == 1) { continue; }
+    const auto bins = &bins_[nid*m];
+    std::fill(sums.begin(), sums.begin() + num_bins, 0.0);
+    std::fill(counts.begin(), counts.begin() + num_bins, size_t{0});
+    for (auto i=begin; i<end; ++i) {
+      const auto index = indices_[i];
+      sums[bins[index]] += residuals_[index];
+      counts[bins[index]] += 1;
+    }
+
+    // Computes the gain of each split: the reduction of the regularized squared error
+    const auto sum = std::accumulate(sums.begin(), sums.begin() + num_bins, 0.0);
+    const auto count = end - begin;
+    const auto parent_score = sum*sum / (count + lambda);
+    auto left_sum = 0.0;
+    auto left_count = size_t{0};
+    for (auto bin=size_t{0}; bin<num_bins - 1; ++bin) {
+      left_sum += sums[bin];
+      left_count += counts[bin];
+      const auto right_count = count - left_count;
+      if (left_count < min_samples_leaf_) { continue; }
+      if (right_count < min_samples_leaf_) { break; }
+      const auto right_sum = sum - left_sum;
+      const auto gain = left_sum*left_sum / (left_count + lambda) +
+                        right_sum*right_sum / (right_count + lambda) - parent_score;
+      if (gain > split.gain) { split = Split{gain, nid, bin}; }
+    }
+  }
+}
+
+// Evaluates a tree for a single sample
+template <typename T>
+T GradientBoostedTrees<T>::Evaluate(const Tree &tree, const T* x) const {
+  auto node = size_t{0};
+  while (!tree[node].leaf) {
+    node = (x[tree[node].feature] <= tree[node].threshold) ? tree[node].left : tree[node].right;
+  }
+  return tree[node].value;
+}
+
+// =================================================================================================
+
+// Saves the maximum depth, the initial prediction, and the bin edges per feature, followed by the
+// trees: the number of nodes and then one node per line
+template <typename T>
+void GradientBoostedTrees<T>::SaveParameters(std::ostream &file) const {
+  file << max_depth_ << " " << base_ << " " << edges_.size() << "\n";
+  for (auto &edges: edges_) { SaveVector(file, edges); }
+  file << trees_.size() << "\n";
+  for (auto &tree: trees_) {
+    file << tree.size() << "\n";
+    for (auto &node: tree) {
+      file << node.leaf << " " << node.value << " " << node.feature << " " << node.threshold << " ";
+      file << node.left << " " << node.right << "\n";
+    }
+  }
+}
+
+// Loads the trees as saved above, checking that all references to features and nodes are valid
+template <typename T>
+void GradientBoostedTrees<T>::LoadParameters(std::istream &file) {
+  auto num_features = size_t{0};
+  file >> max_depth_ >> base_ >> num_features;
+  edges_.clear();
+  for (auto nid=size_t{0}; nid<num_features && file; ++nid) { edges_.push_back(LoadVector(file)); }
+  auto num_trees = size_t{0};
+  file >> num_trees;
+  trees_.clear();
+  for (auto t=size_t{0}; t<num_trees && file; ++t) {
+    auto num_nodes = size_t{0};
+    file >> num_nodes;
+    auto tree = Tree();
+    for (auto i=size_t{0}; i<num_nodes && file; ++i) {
+      auto node = Node{true, static_cast<T>(0), 0, static_cast<T>(0), 0, 0};
+      file >> node.leaf >> node.value >> node.feature >> node.threshold >> node.left >> node.right;
+      if (node.feature >= num_features || node.left >= num_nodes || node.right >= num_nodes) {
+        throw std::runtime_error("Invalid decision tree in model file");
+      }
+      tree.push_back(node);
+    }
+    trees_.push_back(tree);
+  }
+}
+
+// =================================================================================================
+
+// Compiles the class
+template class GradientBoostedTrees<float>;
+
+// =================================================================================================
+} // namespace cltune
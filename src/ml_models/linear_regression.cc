@@ -30,15 +30,31 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 namespace cltune {
 // =================================================================================================
 
+// Limits and defaults of the solvers
+template <typename T> const size_t LinearRegression<T>::kMaxNormalEquationsFeatures = size_t{2048};
+template <typename T> const size_t LinearRegression<T>::kMaxRecursiveFeatures = size_t{512};
+template <typename T> const size_t LinearRegression<T>::kDefaultLearningIterations = size_t{800};
+template <typename T> const T LinearRegression<T>::kDefaultLearningRate = static_cast<T>(0.05);
+
 // Calls the base-class constructor
 template <typename T>
+LinearRegression<T>::LinearRegression(const T lambda, const bool debug_display):
+  MLModel<T>(debug_display),
+  solver_(Solver::kNormalEquations),
+  learning_iterations_(kDefaultLearningIterations),
+  learning_rate_(kDefaultLearningRate),
+  lambda_(lambda) {
+}
+template <typename T>
 LinearRegression<T>::LinearRegression(const size_t learning_iterations, const T learning_rate,
                                       const T lambda, const bool debug_display):
   MLModel<T>(debug_display),
+  solver_(Solver::kGradientDescent),
   learning_iterations_(learning_iterations),
   learning_rate_(learning_rate),
   lambda_(lambda) {
@@ -49,26 +65,36 @@ LinearRegression<T>::LinearRegression(const size_t learning_iterations, const T
 // Trains the model
 template <typename T>
 void LinearRegression<T>::Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-  auto x_temp = x;
+  auto x_temp = Matrix<T>(x);
   auto y_temp = y;
 
   // Modifies data to get a better model
+  inverse_ = Matrix<double>();
   ComputeNormalizations(x_temp);
   PreProcessFeatures(x_temp);
   PreProcessExecutionTimes(y_temp);
 
-  // Runs gradient descent to train the model
-  GradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_);
+  // Solves the normal equations to train the model. Gradient descent is used instead if requested,
+  // if there are too many features, or if solving failed.
+  auto solved = false;
+  if (solver_ == Solver::kNormalEquations && x_temp.cols() <= kMaxNormalEquationsFeatures) {
+    solved = SolveNormalEquations(x_temp, y_temp);
+  }
+  if (!solved) {
+    GradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_);
+  }
 
-  // Verifies and displays the trained results
+  // Verifies and displays the trained results (if requested)
   auto cost = Verify(x_temp, y_temp);
-  printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  if (debug_display_) {
+    printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  }
 }
 
 // Validates the model
 template <typename T>
 void LinearRegression<T>::Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-  auto x_temp = x;
+  auto x_temp = Matrix<T>(x);
   auto y_temp = y;
 
   // Modifies validation data in the same way as the training data
@@ -80,21 +106,60 @@ void LinearRegression<T>::Validate(const std::vector<std::vector<T>> &x, const s
   printf("%s Validation cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
 }
 
-// Prediction: pre-processe a single sample and pass it through the model
+// Pre-processes the new samples in the same way as the training data and applies the recursive
+// least squares update per sample: with P the inverse and x a sample, the gain is
+// k = P*x/(1+x^T*P*x), the weights move by k times the prediction error, and P becomes P-k*(P*x)^T.
 template <typename T>
-T LinearRegression<T>::Predict(const std::vector<T> &x) const {
-  auto x_preprocessed = std::vector<std::vector<T>>{x};
-  PreProcessFeatures(x_preprocessed);
-  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0]));
+bool LinearRegression<T>::Update(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
+  if (inverse_.rows() == 0) { return false; }
+  auto x_temp = Matrix<T>(x);
+  auto y_temp = y;
+  PreProcessFeatures(x_temp);
+  PreProcessExecutionTimes(y_temp);
+
+  const auto n = x_temp.cols();
+  auto xi = std::vector<double>(n);
+  auto px = std::vector<double>();
+  for (auto mid=size_t{0}; mid<x_temp.rows(); ++mid) {
+    std::copy(x_temp.row(mid), x_temp.row(mid) + n, xi.begin());
+    Gemv(inverse_, xi, px);
+    const auto denominator = 1.0 + Dot(xi.data(), px.data(), n);
+    auto error = static_cast<double>(y_temp[mid]);
+    for (auto nid=size_t{0}; nid<n; ++nid) { error -= xi[nid] * static_cast<double>(theta_[nid]); }
+    for (auto nid=size_t{0}; nid<n; ++nid) {
+      theta_[nid] += static_cast<T>(px[nid] * error / denominator);
+    }
+    for (auto row=size_t{0}; row<n; ++row) {
+      const auto gain = px[row] / denominator;
+      auto inverse_row = inverse_.row(row);
+      for (auto col=size_t{0}; col<n; ++col) { inverse_row[col] -= gain * px[col]; }
+    }
+  }
+  return true;
+}
+
+// Prediction: pre-processes a chunk of samples and passes them through the model
+template <typename T>
+std::vector<T> LinearRegression<T>::PredictRows(Matrix<T> &x) const {
+  PreProcessFeatures(x);
+  auto predictions = Hypothesis(x);
+  for (auto &prediction: predictions) { prediction = PostProcessExecutionTime(prediction); }
+  return predictions;
 }
 
 // =================================================================================================
 
-// Pre-processes the features based on normalization data
+// Pre-processes the features based on normalization data. The first feature is a constant one: its
+// weight (theta-zero) is the bias, which is not regularized.
 template <typename T>
-void LinearRegression<T>::PreProcessFeatures(std::vector<std::vector<T>> &x) const {
+void LinearRegression<T>::PreProcessFeatures(Matrix<T> &x) const {
   NormalizeFeatures(x);
-  AddPolynomialFeatures(x, {2}); // Second order polynomials
+  const auto x_polynomial = AddPolynomialFeatures(x, {2}); // Second order polynomials
+  x.Resize(x_polynomial.rows(), x_polynomial.cols() + 1);
+  for (auto mid=size_t{0}; mid<x.rows(); ++mid) {
+    x(mid, 0) = static_cast<T>(1);
+    std::copy(x_polynomial.row(mid), x_polynomial.row(mid) + x_polynomial.cols(), x.row(mid) + 1);
+  }
 }
 
 // Pre-processes the execution times using a logarithmic function
@@ -120,27 +185,25 @@ void LinearRegression<T>::InitializeTheta(const size_t n) {
 
 // =================================================================================================
 
-// Hypothesis-function: pass a single sample through the model and returns its hypothesis
+// Hypothesis-function: passes all samples through the model (a matrix-vector multiplication)
 template <typename T>
-T LinearRegression<T>::Hypothesis(const std::vector<T> &x) const {
-  auto n = x.size();
-  auto hypothesis = static_cast<T>(0);
-  for (auto nid=size_t{0}; nid<n; ++nid) {
-    hypothesis += theta_[nid] * x[nid];
-
-  }
+std::vector<T> LinearRegression<T>::Hypothesis(const Matrix<T> &x) const {
+  auto hypothesis = std::vector<T>();
+  Gemv(x, theta_, hypothesis);
   return hypothesis;
 }
 
 // Cost-function: computes the sum of squared differences
 template <typename T>
-T LinearRegression<T>::Cost(const size_t m, const size_t n, const T lambda,
-                            const std::vector<std::vector<T>> &x, const std::vector<T> &y) const {
+T LinearRegression<T>::Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const {
+  const auto m = x.rows();
+  const auto n = x.cols();
 
   // Computes the sum of squared differences
+  const auto hypothesis = Hypothesis(x);
   auto cost = static_cast<T>(0);
   for (auto mid=size_t{0}; mid<m; ++mid) {
-    auto difference = Hypothesis(x[mid]) - y[mid];
+    auto difference = hypothesis[mid] - y[mid];
     cost += difference * difference;
   }
 
@@ -154,34 +217,81 @@ T LinearRegression<T>::Cost(const size_t m, const size_t n, const T lambda,
   return (cost + lambda*theta_squared_sum) / (static_cast<T>(2) * static_cast<T>(m));
 }
 
-// Gradient-function: computes the gradient of the cost-function
+// Gradient-function: computes the gradient of the cost-function and updates theta. This takes a
+// single forward pass (X*theta) and a single backward pass (X^T*residuals) over the data.
 template <typename T>
-void LinearRegression<T>::Gradient(const size_t m, const size_t n, const T lambda, const T alpha,
-                                   const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-
-  // Temporary data storage
-  auto theta_temp = std::vector<T>(n, static_cast<T>(0));
+void LinearRegression<T>::Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                                   const std::vector<T> &y) {
+  const auto m = static_cast<T>(x.rows());
+  const auto n = x.cols();
+
+  // Computes the residuals and the gradient of the cost function
+  auto residuals = Hypothesis(x);
+  for (auto mid=size_t{0}; mid<residuals.size(); ++mid) {
+    residuals[mid] -= y[mid];
+  }
+  auto gradient = std::vector<T>();
+  GemvTransposed(x, residuals, gradient);
 
-  // Loops over all features
+  // Computes the final gradient with regularization (not for the bias) and sets the newly learned
+  // theta
   for (auto nid=size_t{0}; nid<n; ++nid) {
+    const auto regularization = (nid == 0) ? static_cast<T>(0) : (lambda * theta_[nid]) / m;
+    theta_[nid] = theta_[nid] - alpha * ((gradient[nid] / m) + regularization);
+  }
+}
 
-    // Computes the gradient of the cost function
-    auto gradient = static_cast<T>(0);
-    for (auto mid=size_t{0}; mid<m; ++mid) {
-      gradient += (Hypothesis(x[mid]) - y[mid]) * x[mid][nid];
-    }
-
-    // Computes the final gradient with regularization
-    gradient = (gradient / static_cast<T>(m)) + ((lambda * theta_[nid]) / static_cast<T>(m));
+// =================================================================================================
 
-    // Sets the newly learned theta (temporarily at first)
-    theta_temp[nid] = theta_[nid] - alpha * gradient;
+// Minimizes the same cost as gradient descent, in closed form: (X^T*X + lambda*I')*theta = X^T*y,
+// in which I' is the identity matrix except for a zero for the bias. This is solved using a Cholesky
+// decomposition, which applies since the matrix is symmetric and (for a positive lambda) positive
+// definite. Double precision is used, since X^T*X squares the condition number. For a limited
+// number of features, the matrix is inverted instead, such that the inverse can be used for updates.
+template <typename T>
+bool LinearRegression<T>::SolveNormalEquations(const Matrix<T> &x, const std::vector<T> &y) {
+  const auto n = x.cols();
+  auto x_double = Matrix<double>(x.rows(), n);
+  std::copy(x.data().begin(), x.data().end(), x_double.data().begin());
+  auto y_double = std::vector<double>(y.begin(), y.end());
+
+  // Sets up the regularized normal equations
+  auto a = Matrix<double>();
+  auto b = std::vector<double>();
+  GemmTN(x_double, x_double, a);
+  GemvTransposed(x_double, y_double, b);
+  for (auto nid=size_t{1}; nid<n; ++nid) {
+    a(nid, nid) += static_cast<double>(lambda_);
   }
 
-  // Sets the new final values for theta
+  // Solves them and stores the result as the weights
+  auto solution = std::vector<double>();
+  if (n <= kMaxRecursiveFeatures) {
+    if (!CholeskyInvert(a)) { return false; }
+    Gemv(a, b, solution);
+    inverse_ = a;
+  }
+  else {
+    if (!CholeskySolve(a, b)) { return false; }
+    solution = b;
+  }
+  theta_.resize(n);
   for (auto nid=size_t{0}; nid<n; ++nid) {
-    theta_[nid] = theta_temp[nid];
+    theta_[nid] = static_cast<T>(solution[nid]);
   }
+  return true;
+}
+
+// =================================================================================================
+
+// Saves and loads the weights
+template <typename T>
+void LinearRegression<T>::SaveParameters(std::ostream &file) const {
+  SaveVector(file, theta_);
+}
+template <typename T>
+void LinearRegression<T>::LoadParameters(std::istream &file) {
+  theta_ = LoadVector(file);
 }
 
 // =================================================================================================
@@ -32,23 +32,52 @@
 #include <cmath>
 #include <random>
 #include <exception>
-#include <chrono>
+#include <algorithm>
+#include <functional>
 
 namespace cltune {
 // =================================================================================================
 
+// Parameters of the Adam update rule (default values from the original paper) and the minimum
+// number of samples of a minibatch per thread, below which waking up the workers costs more than it
+// saves (a thread's part takes at least tens of microseconds for the default network sizes)
+template <typename T> const T NeuralNetwork<T>::kAdamBeta1 = static_cast<T>(0.9);
+template <typename T> const T NeuralNetwork<T>::kAdamBeta2 = static_cast<T>(0.999);
+template <typename T> const T NeuralNetwork<T>::kAdamEpsilon = static_cast<T>(1e-8);
+template <typename T> const size_t NeuralNetwork<T>::kMinSamplesPerThread = size_t{32};
+template <typename T> const size_t NeuralNetwork<T>::kUpdateStepsPerSample = size_t{4};
+
+// =================================================================================================
+
 // Calls the base-class constructor
 template <typename T>
 NeuralNetwork<T>::NeuralNetwork(const size_t learning_iterations, const T learning_rate,
                                 const T lambda, const std::vector<size_t> &layer_sizes,
-                                const bool debug_display):
+                                const size_t batch_size, const bool debug_display,
+                                const unsigned int random_seed):
     MLModel<T>(debug_display),
+    thetas_(),
+    moments1_(),
+    moments2_(),
+    adam_step_(0),
+    workspaces_(),
+    workers_(),
+    x_history_(),
+    y_history_(),
+    update_generator_(random_seed),
     num_layers_(layer_sizes.size()),
     layer_sizes_(layer_sizes),
     learning_iterations_(learning_iterations),
     learning_rate_(learning_rate),
-    lambda_(lambda) {
-  if (num_layers_ != 3) { throw std::runtime_error("Only supporting networks with 3 layers"); }
+    lambda_(lambda),
+    batch_size_(batch_size),
+    random_seed_(random_seed) {
+  if (num_layers_ < 2) { throw std::runtime_error("Neural network requires at least 2 layers"); }
+  if (layer_sizes_.back() != 1) { throw std::runtime_error("Only supporting a single output"); }
+  for (auto &layer_size: layer_sizes_) {
+    if (layer_size == 0) { throw std::runtime_error("Invalid size of a layer"); }
+  }
+  if (batch_size_ == 0) { throw std::runtime_error("Invalid minibatch size"); }
 }
 
 // =================================================================================================
@@ -56,7 +85,7 @@ NeuralNetwork<T>::NeuralNetwork(const size_t learning_iterations, const T learni
 // Trains the model
 template <typename T>
 void NeuralNetwork<T>::Train(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-  auto x_temp = x;
+  auto x_temp = Matrix<T>(x);
   auto y_temp = y;
 
   // Modifies data to get a better model
@@ -64,18 +93,66 @@ void NeuralNetwork<T>::Train(const std::vector<std::vector<T>> &x, const std::ve
   PreProcessFeatures(x_temp);
   PreProcessExecutionTimes(y_temp);
 
-  // Runs gradient descent to train the model
-  GradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_);
+  // Runs minibatch gradient descent to train the model
+  StartWorkers();
+  MinibatchGradientDescent(x_temp, y_temp, learning_rate_, lambda_, learning_iterations_,
+                           batch_size_, random_seed_);
+  workers_.reset();
 
-  // Verifies and displays the trained results
+  // Verifies and displays the trained results (if requested)
   auto cost = Verify(x_temp, y_temp);
-  printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  if (debug_display_) {
+    printf("%s Training cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
+  }
+
+  // Keeps the samples for replay during updates
+  x_history_ = x_temp;
+  y_history_ = y_temp;
+}
+
+// Learns the new samples one by one. The minibatches consist of the new sample and earlier samples.
+template <typename T>
+bool NeuralNetwork<T>::Update(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
+  if (thetas_.size() == 0 || moments1_.size() != thetas_.size()) { return false; }
+  auto x_temp = Matrix<T>(x);
+  auto y_temp = y;
+  PreProcessFeatures(x_temp);
+  PreProcessExecutionTimes(y_temp);
+
+  const auto n = x_temp.cols();
+  auto distribution = std::uniform_int_distribution<size_t>();
+  auto x_batch = Matrix<T>();
+  auto y_batch = std::vector<T>();
+  StartWorkers();
+  for (auto mid=size_t{0}; mid<x_temp.rows(); ++mid) {
+    const auto num_earlier = x_history_.rows();
+    x_history_.AddRow(x_temp.row(mid));
+    y_history_.push_back(y_temp[mid]);
+    const auto size = std::min(batch_size_, num_earlier + 1);
+    if (num_earlier != 0) {
+      distribution.param(std::uniform_int_distribution<size_t>::param_type(0, num_earlier - 1));
+    }
+    x_batch.Resize(size, n);
+    y_batch.resize(size);
+    std::copy(x_temp.row(mid), x_temp.row(mid) + n, x_batch.row(0));
+    y_batch[0] = y_temp[mid];
+    for (auto step=size_t{0}; step<kUpdateStepsPerSample; ++step) {
+      for (auto b=size_t{1}; b<size; ++b) {
+        const auto index = distribution(update_generator_);
+        std::copy(x_history_.row(index), x_history_.row(index) + n, x_batch.row(b));
+        y_batch[b] = y_history_[index];
+      }
+      Gradient(lambda_, learning_rate_, x_batch, y_batch);
+    }
+  }
+  workers_.reset();
+  return true;
 }
 
 // Validates the model
 template <typename T>
 void NeuralNetwork<T>::Validate(const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-  auto x_temp = x;
+  auto x_temp = Matrix<T>(x);
   auto y_temp = y;
 
   // Modifies validation data in the same way as the training data
@@ -87,19 +164,20 @@ void NeuralNetwork<T>::Validate(const std::vector<std::vector<T>> &x, const std:
   printf("%s Validation cost: %.2e\n", TunerImpl::kMessageResult.c_str(), cost);
 }
 
-// Prediction: pre-processe a single sample and pass it through the model
+// Prediction: pre-processes a chunk of samples and passes them through the model
 template <typename T>
-T NeuralNetwork<T>::Predict(const std::vector<T> &x) const {
-  auto x_preprocessed = std::vector<std::vector<T>>{x};
-  PreProcessFeatures(x_preprocessed);
-  return PostProcessExecutionTime(Hypothesis(x_preprocessed[0]));
+std::vector<T> NeuralNetwork<T>::PredictRows(Matrix<T> &x) const {
+  PreProcessFeatures(x);
+  auto predictions = Hypothesis(x);
+  for (auto &prediction: predictions) { prediction = PostProcessExecutionTime(prediction); }
+  return predictions;
 }
 
 // =================================================================================================
 
 // Pre-processes the features based on normalization data
 template <typename T>
-void NeuralNetwork<T>::PreProcessFeatures(std::vector<std::vector<T>> &x) const {
+void NeuralNetwork<T>::PreProcessFeatures(Matrix<T> &x) const {
   NormalizeFeatures(x);
 }
 
@@ -117,78 +195,67 @@ T NeuralNetwork<T>::PostProcessExecutionTime(T value) const {
 
 // =================================================================================================
 
-// Initialization-function: sets the initial weights theta
+// Initialization-function: sets the initial weights theta per layer and resets the Adam state
 template <typename T>
 void NeuralNetwork<T>::InitializeTheta(const size_t n) {
-
-  // Resizes the weight matrices theta
   if (layer_sizes_[0] != n) { throw std::runtime_error("Invalid size of the first layer"); }
-  if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-  theta1_.resize((layer_sizes_[0]+1)*layer_sizes_[1]);
-  theta2_.resize((layer_sizes_[1]+1)*layer_sizes_[2]);
-
-  // Calculates the random-initialization range
-  auto epsilon1 = static_cast<T>(sqrt(static_cast<T>(6))/sqrt(static_cast<T>(layer_sizes_[0]+layer_sizes_[1])));
-  auto epsilon2 = static_cast<T>(sqrt(static_cast<T>(6))/sqrt(static_cast<T>(layer_sizes_[1]+layer_sizes_[2])));
-  
-  // Creates a random number generator
-  const auto random_seed = std::chrono::system_clock::now().time_since_epoch().count();
-  std::default_random_engine generator(static_cast<unsigned int>(random_seed));
-  std::uniform_real_distribution<T> distribution1(-epsilon1, epsilon1);
-  std::uniform_real_distribution<T> distribution2(-epsilon2, epsilon2);
-
-  // Fills the weights with random values
-  for (auto &weight: theta1_) { weight = distribution1(generator); }
-  for (auto &weight: theta2_) { weight = distribution2(generator); }
+  std::default_random_engine generator(random_seed_);
+  thetas_.resize(num_layers_ - 1);
+  moments1_.resize(num_layers_ - 1);
+  moments2_.resize(num_layers_ - 1);
+  adam_step_ = 0;
+  for (auto layer=size_t{0}; layer<num_layers_ - 1; ++layer) {
+    const auto inputs = layer_sizes_[layer];
+    const auto outputs = layer_sizes_[layer + 1];
+
+    // Fills the weights with random values in a range based on the sizes of the two layers
+    thetas_[layer].Resize(outputs, inputs + 1);
+    auto epsilon = static_cast<T>(sqrt(static_cast<T>(6))/sqrt(static_cast<T>(inputs + outputs)));
+    std::uniform_real_distribution<T> distribution(-epsilon, epsilon);
+    for (auto &weight: thetas_[layer].data()) { weight = distribution(generator); }
+
+    // Sets the moment estimates to zero
+    moments1_[layer] = Matrix<T>(outputs, inputs + 1);
+    moments2_[layer] = Matrix<T>(outputs, inputs + 1);
+  }
+}
+
+// Starts as many threads as the minibatches can be divided over (at most the thread limit)
+template <typename T>
+void NeuralNetwork<T>::StartWorkers() {
+  const auto num_threads = std::min(max_threads_, batch_size_ / kMinSamplesPerThread);
+  workers_.reset((num_threads > 1) ? new WorkerPool(num_threads) : nullptr);
 }
 
 // =================================================================================================
 
-// Hypothesis-function: pass a single sample through the model and returns its hypothesis
-// TODO: Memory usage and performance can be improved
+// Hypothesis-function: passes all samples through the network and returns the output layer
 template <typename T>
-T NeuralNetwork<T>::Hypothesis(const std::vector<T> &x) const {
-
-  // Adds a bias to the input data
-  auto a0 = FeedForward0(x);
-  
-  // Performs the activations of the first hidden layer
-  auto a1 = FeedForward1(a0, true);
-  
-  // Performs the activations of the output layer
-  auto a2 = FeedForward2(a1);
-
-  // Only one output supported
-  if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-  auto hypothesis = a2[0];
-  return hypothesis;
+std::vector<T> NeuralNetwork<T>::Hypothesis(const Matrix<T> &x) const {
+  auto workspace = Workspace();
+  FeedForward(x, 0, x.rows(), workspace);
+  return workspace.activations.back().data(); // A single output: this holds a value per sample
 }
 
 // Cost-function: computes the sum of squared differences
 template <typename T>
-T NeuralNetwork<T>::Cost(const size_t m, const size_t, const T lambda,
-                         const std::vector<std::vector<T>> &x, const std::vector<T> &y) const {
+T NeuralNetwork<T>::Cost(const T lambda, const Matrix<T> &x, const std::vector<T> &y) const {
+  const auto m = x.rows();
 
   // Computes the sum of squared differences
+  const auto hypothesis = Hypothesis(x);
   auto cost = static_cast<T>(0);
   for (auto mid=size_t{0}; mid<m; ++mid) {
-    auto difference = Hypothesis(x[mid]) - y[mid];
+    auto difference = hypothesis[mid] - y[mid];
     cost += difference * difference;
   }
   cost /= static_cast<T>(m);
 
-  // Computes the squared sum of theta's (not counting theta-zero) for the regularization term
+  // Computes the squared sum of theta's (not counting the bias weights) for the regularization term
   auto theta_squared_sum = static_cast<T>(0);
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-    for (auto id0=size_t{1}; id0<layer_sizes_[0]+1; ++id0) {
-      auto value = theta1_[id1*(layer_sizes_[0]+1) + id0];
-      theta_squared_sum += value * value;
-    }
-  }
-  for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-    for (auto id1=size_t{1}; id1<layer_sizes_[1]+1; ++id1) {
-      auto value = theta2_[id2*(layer_sizes_[1]+1) + id1];
-      theta_squared_sum += value * value;
+  for (auto &theta: thetas_) {
+    for (auto row=size_t{0}; row<theta.rows(); ++row) {
+      theta_squared_sum += Dot(theta.row(row) + 1, theta.row(row) + 1, theta.cols() - 1);
     }
   }
 
@@ -196,127 +263,154 @@ T NeuralNetwork<T>::Cost(const size_t m, const size_t, const T lambda,
   return cost + (lambda*theta_squared_sum) / (static_cast<T>(2 * m));
 }
 
-// Gradient-function: computes the gradient of the cost-function
+// Gradient-function: computes the gradient of the cost-function of a minibatch using
+// backpropagation and updates the weights using the Adam update rule. The samples of the minibatch
+// are divided over the worker threads (if any), after which the per-thread gradients are summed.
 template <typename T>
-void NeuralNetwork<T>::Gradient(const size_t m, const size_t, const T lambda, const T alpha,
-                                const std::vector<std::vector<T>> &x, const std::vector<T> &y) {
-
-  // Temporary data storage for the gradients
-  auto gradient1 = std::vector<T>(theta1_.size(), static_cast<T>(0));
-  auto gradient2 = std::vector<T>(theta2_.size(), static_cast<T>(0));
-
-  // Loops over all samples of the training data
-  for (auto mid=size_t{0}; mid<m; ++mid) {
+void NeuralNetwork<T>::Gradient(const T lambda, const T alpha, const Matrix<T> &x,
+                                const std::vector<T> &y) {
+  const auto m = x.rows();
+
+  // Computes the gradients in parallel: the calling thread processes the first part of the samples
+  const auto max_threads = (workers_) ? workers_->size() : size_t{1};
+  const auto num_threads = std::max(size_t{1}, std::min(max_threads, m / kMinSamplesPerThread));
+  if (workspaces_.size() < num_threads) { workspaces_.resize(num_threads); }
+  if (num_threads == 1) {
+    Backpropagate(x, y, 0, m, workspaces_[0]);
+  }
+  else {
+    workers_->Run(num_threads, [this, &x, &y, m, num_threads] (const size_t tid) {
+      Backpropagate(x, y, (m*tid)/num_threads, (m*(tid + 1))/num_threads, workspaces_[tid]);
+    });
+  }
 
-    // Performs the feed-forward computations (with and without sigmoid)
-    auto a0 = FeedForward0(x[mid]);
-    auto z1 = FeedForward1(a0, false);
-    auto a1 = FeedForward1(a0, true);
-    auto a2 = FeedForward2(a1);
-
-    // Computes the error at the last layer
-    auto d2 = std::vector<T>(layer_sizes_[2]);
-    if (layer_sizes_[2] != 1) { throw std::runtime_error("Invalid size of the third layer"); }
-    d2[0] = a2[0] - y[mid];
-
-    // Propagates the error back (backpropagation) to compute the delta at the hidden layer
-    auto d1 = std::vector<T>(layer_sizes_[1]);
-    for (auto id1=size_t{1}; id1<layer_sizes_[1]+1; ++id1) {
-      auto value = static_cast<T>(0);
-      for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-        value += d2[id2] * theta2_[id2*(layer_sizes_[1]+1) + id1];
-      }
-      d1[id1-1] = value * SigmoidGradient(z1[id1]);
+  // Sums the gradients of all threads
+  auto &gradients = workspaces_[0].gradients;
+  for (auto tid=size_t{1}; tid<num_threads; ++tid) {
+    for (auto layer=size_t{0}; layer<num_layers_ - 1; ++layer) {
+      auto &gradient = gradients[layer].data();
+      const auto &thread_gradient = workspaces_[tid].gradients[layer].data();
+      for (auto i=size_t{0}; i<gradient.size(); ++i) { gradient[i] += thread_gradient[i]; }
     }
+  }
 
-    // Accumulates the partial gradients
-    for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-      for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-        gradient1[id1*(layer_sizes_[0]+1) + id0] += d1[id1] * a0[id0];
-      }
-    }
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-      for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-        gradient2[id2*(layer_sizes_[1]+1) + id1] += d2[id2] * a1[id1];
+  // Computes the final gradients, adding regularization (not for the bias weights), and sets the new
+  // values of theta using the bias-corrected moment estimates
+  ++adam_step_;
+  const auto correction1 = static_cast<T>(1) - static_cast<T>(pow(kAdamBeta1, adam_step_));
+  const auto correction2 = static_cast<T>(1) - static_cast<T>(pow(kAdamBeta2, adam_step_));
+  for (auto layer=size_t{0}; layer<num_layers_ - 1; ++layer) {
+    auto &theta = thetas_[layer];
+    for (auto row=size_t{0}; row<theta.rows(); ++row) {
+      for (auto col=size_t{0}; col<theta.cols(); ++col) {
+        auto value = gradients[layer](row, col);
+        if (col != 0) { value += lambda * theta(row, col); }
+        value /= static_cast<T>(m);
+        auto &moment1 = moments1_[layer](row, col);
+        auto &moment2 = moments2_[layer](row, col);
+        moment1 = kAdamBeta1 * moment1 + (static_cast<T>(1) - kAdamBeta1) * value;
+        moment2 = kAdamBeta2 * moment2 + (static_cast<T>(1) - kAdamBeta2) * value * value;
+        theta(row, col) -= alpha * (moment1 / correction1) /
+                           (static_cast<T>(sqrt(moment2 / correction2)) + kAdamEpsilon);
       }
     }
   }
+}
 
-  // Computes the final gradients, adding regularization
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-      auto index = id1*(layer_sizes_[0]+1) + id0;
-      if (id0 != 0) { // Don't add regularization for the bias term
-        gradient1[index] += lambda * theta1_[index];
-      }
-      gradient1[index] /= static_cast<T>(m);
-    }
+// =================================================================================================
+
+// Feed-forward function: adds the bias units and computes the activations layer by layer
+template <typename T>
+void NeuralNetwork<T>::FeedForward(const Matrix<T> &x, const size_t begin, const size_t end,
+                                   Workspace &workspace) const {
+  const auto m = end - begin;
+  auto &activations = workspace.activations;
+  activations.resize(num_layers_);
+
+  // Input layer (with bias unit)
+  activations[0].Resize(m, layer_sizes_[0]+1);
+  for (auto mid=size_t{0}; mid<m; ++mid) {
+    activations[0](mid, 0) = static_cast<T>(1);
+    std::copy(x.row(begin + mid), x.row(begin + mid) + layer_sizes_[0], activations[0].row(mid) + 1);
   }
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-    for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-      auto index = id2*(layer_sizes_[1]+1) + id1;
-      if (id1 != 0) { // Don't add regularization for the bias term
-        gradient2[index] += lambda * theta2_[index];
+
+  // Hidden layers (with bias unit and a sigmoid activation function)
+  for (auto layer=size_t{1}; layer<num_layers_ - 1; ++layer) {
+    GemmNT(activations[layer - 1], thetas_[layer - 1], workspace.scratch);
+    activations[layer].Resize(m, layer_sizes_[layer]+1);
+    for (auto mid=size_t{0}; mid<m; ++mid) {
+      activations[layer](mid, 0) = static_cast<T>(1);
+      for (auto unit=size_t{0}; unit<layer_sizes_[layer]; ++unit) {
+        activations[layer](mid, unit + 1) = Sigmoid(workspace.scratch(mid, unit));
       }
-      gradient2[index] /= static_cast<T>(m);
     }
   }
 
-  // Sets the new values of theta
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-      auto index = id1*(layer_sizes_[0]+1) + id0;
-      theta1_[index] = theta1_[index] - alpha * gradient1[index];
-    }
+  // Output layer (no sigmoid activation function)
+  GemmNT(activations[num_layers_ - 2], thetas_[num_layers_ - 2], activations[num_layers_ - 1]);
+}
+
+// Backpropagation function: computes the error at the output layer and propagates it back layer by
+// layer, skipping the bias units. The gradient of the sigmoid is computed from its output: s*(1-s).
+template <typename T>
+void NeuralNetwork<T>::Backpropagate(const Matrix<T> &x, const std::vector<T> &y, const size_t begin,
+                                     const size_t end, Workspace &workspace) const {
+  const auto m = end - begin;
+  const auto last = num_layers_ - 1;
+  FeedForward(x, begin, end, workspace);
+  auto &activations = workspace.activations;
+  auto &deltas = workspace.deltas;
+  deltas.resize(num_layers_);
+  workspace.gradients.resize(num_layers_ - 1);
+
+  // Computes the error at the last layer
+  deltas[last].Resize(m, 1);
+  for (auto mid=size_t{0}; mid<m; ++mid) {
+    deltas[last](mid, 0) = activations[last](mid, 0) - y[begin + mid];
   }
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-    for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-      auto index = id2*(layer_sizes_[1]+1) + id1;
-      theta2_[index] = theta2_[index] - alpha * gradient2[index];
+
+  // Accumulates the gradients over the samples and computes the delta of the previous layer
+  for (auto layer=last; layer>0; --layer) {
+    GemmTN(deltas[layer], activations[layer - 1], workspace.gradients[layer - 1]);
+    if (layer == 1) { break; }
+    Gemm(deltas[layer], thetas_[layer - 1], workspace.scratch);
+    deltas[layer - 1].Resize(m, layer_sizes_[layer - 1]);
+    for (auto mid=size_t{0}; mid<m; ++mid) {
+      for (auto unit=size_t{0}; unit<layer_sizes_[layer - 1]; ++unit) {
+        const auto sigmoid = activations[layer - 1](mid, unit + 1);
+        deltas[layer - 1](mid, unit) = workspace.scratch(mid, unit + 1) * sigmoid *
+                                       (static_cast<T>(1) - sigmoid);
+      }
     }
   }
 }
 
 // =================================================================================================
 
-// Feed-forward function: input layer (with bias unit)
+// Saves the layer sizes followed by the weights per layer
 template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward0(const std::vector<T> &x) const {
-  auto a0 = std::vector<T>(layer_sizes_[0]+1);
-  a0[0] = static_cast<T>(1);
-  for (auto id0=size_t{0}; id0<layer_sizes_[0]; ++id0) {
-    a0[id0 + 1] = x[id0];
-  }
-  return a0;
-}
-
-// Feed-forward function: hidden layer (with bias unit and optionally a sigmoid activation function)
-template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward1(const std::vector<T> &a0, const bool sigmoid) const {
-  auto a1 = std::vector<T>(layer_sizes_[1]+1);
-  a1[0] = static_cast<T>(1);
-  for (auto id1=size_t{0}; id1<layer_sizes_[1]; ++id1) {
-    auto z1 = static_cast<T>(0);
-    for (auto id0=size_t{0}; id0<layer_sizes_[0]+1; ++id0) {
-      z1 += a0[id0] * theta1_[id1*(layer_sizes_[0]+1) + id0];
-    }
-    a1[id1 + 1] = (sigmoid) ? Sigmoid(z1) : z1;
-  }
-  return a1;
+void NeuralNetwork<T>::SaveParameters(std::ostream &file) const {
+  file << num_layers_;
+  for (auto &layer_size: layer_sizes_) { file << " " << layer_size; }
+  file << "\n";
+  for (auto &theta: thetas_) { SaveMatrix(file, theta); }
 }
 
-// Feed-forward function: output layer
+// Loads the layer sizes and the weights, checking that their sizes match
 template <typename T>
-std::vector<T> NeuralNetwork<T>::FeedForward2(const std::vector<T> &a1) const {
-  auto a2 = std::vector<T>(layer_sizes_[2]);
-  for (auto id2=size_t{0}; id2<layer_sizes_[2]; ++id2) {
-    auto z2 = static_cast<T>(0);
-    for (auto id1=size_t{0}; id1<layer_sizes_[1]+1; ++id1) {
-      z2 += a1[id1] * theta2_[id2*(layer_sizes_[1]+1) + id1];
+void NeuralNetwork<T>::LoadParameters(std::istream &file) {
+  file >> num_layers_;
+  if (!file || num_layers_ < 2) { throw std::runtime_error("Invalid neural network in model file"); }
+  layer_sizes_.resize(num_layers_);
+  for (auto &layer_size: layer_sizes_) { file >> layer_size; }
+  thetas_.resize(num_layers_ - 1);
+  for (auto layer=size_t{0}; layer<num_layers_ - 1; ++layer) {
+    thetas_[layer] = LoadMatrix(file);
+    if (thetas_[layer].rows() != layer_sizes_[layer + 1] ||
+        thetas_[layer].cols() != layer_sizes_[layer] + 1) {
+      throw std::runtime_error("Invalid neural network in model file");
     }
-    a2[id2] = z2; // No sigmoid activation function in the output layer
   }
-  return a2;
 }
 
 // =================================================================================================
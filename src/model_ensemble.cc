@@ -0,0 +1,201 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the ModelEnsemble class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/model_ensemble.h"
+
+#include <random>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <cstdio>
+
+namespace cltune {
+// =================================================================================================
+
+// Creates the models, each with its own seed
+ModelEnsemble::ModelEnsemble(const ModelSettings &settings, const size_t num_models,
+                             const size_t num_features, const bool debug_display,
+                             const unsigned int seed):
+    models_(),
+    seed_(seed) {
+  if (num_models == 0) { throw std::runtime_error("An ensemble needs at least one model"); }
+  for (auto i=size_t{0}; i<num_models; ++i) {
+    models_.push_back(CreateModel(settings, num_features, debug_display && num_models == 1,
+                                  seed + static_cast<unsigned int>(i),
+                                  MLModel<float>::HardwareThreads()));
+  }
+}
+
+// Reads the number of models and loads each of them
+ModelEnsemble::ModelEnsemble(std::istream &file):
+    models_(),
+    seed_(0) {
+  auto num_models = size_t{0};
+  file >> num_models;
+  if (!file || num_models == 0) { throw std::runtime_error("Invalid model file"); }
+  for (auto i=size_t{0}; i<num_models; ++i) { models_.push_back(MLModel<float>::Load(file)); }
+}
+
+// =================================================================================================
+
+// Trains a single model on all data. Otherwise, each model gets its own bootstrap sample. Threads
+// (at most one per hardware thread) take the next model to train from a shared counter, and the
+// models share the remaining hardware threads (if any). The first error of any of the threads is
+// passed on.
+void ModelEnsemble::Train(const std::vector<std::vector<float>> &x, const std::vector<float> &y) {
+  const auto hardware_threads = MLModel<float>::HardwareThreads();
+  if (models_.size() == 1) {
+    models_[0]->SetMaxThreads(hardware_threads);
+    models_[0]->Train(x, y);
+    return;
+  }
+  const auto num_threads = std::min(hardware_threads, models_.size());
+  for (auto &model: models_) { model->SetMaxThreads(hardware_threads / num_threads); }
+  std::atomic<size_t> next_model(0);
+  auto errors = std::vector<std::exception_ptr>(models_.size());
+  auto train_model = [&] (const size_t i) {
+    try {
+      auto generator = std::default_random_engine(seed_ + static_cast<unsigned int>(i));
+      auto distribution = std::uniform_int_distribution<size_t>(0, x.size() - 1);
+      auto x_sample = std::vector<std::vector<float>>(x.size());
+      auto y_sample = std::vector<float>(y.size());
+      for (auto s=size_t{0}; s<x.size(); ++s) {
+        const auto index = distribution(generator);
+        x_sample[s] = x[index];
+        y_sample[s] = y[index];
+      }
+      models_[i]->Train(x_sample, y_sample);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+  auto train_models = [&] () {
+    for (auto i=next_model++; i<models_.size(); i=next_model++) { train_model(i); }
+  };
+  auto threads = std::vector<std::thread>();
+  for (auto tid=size_t{1}; tid<num_threads; ++tid) { threads.emplace_back(train_models); }
+  train_models();
+  for (auto &thread: threads) { thread.join(); }
+  for (auto &error: errors) {
+    if (error) { std::rethrow_exception(error); }
+  }
+}
+
+// Validates a single model as usual. For multiple models, prints the mean squared error of the
+// logarithms of the mean predictions (as used for cross-validation).
+void ModelEnsemble::Validate(const std::vector<std::vector<float>> &x,
+                             const std::vector<float> &y) const {
+  if (models_.size() == 1) {
+    models_[0]->Validate(x, y);
+    return;
+  }
+  const auto predictions = PredictBatch(Matrix<float>(x));
+  auto error = 0.0;
+  for (auto s=size_t{0}; s<predictions.size(); ++s) {
+    const auto difference = std::log(static_cast<double>(predictions[s])) -
+                            std::log(static_cast<double>(y[s]));
+    error += difference * difference / static_cast<double>(predictions.size());
+  }
+  printf("%s Validation error of the ensemble mean: %.2e\n", TunerImpl::kMessageResult.c_str(),
+         error);
+}
+
+// =================================================================================================
+
+// Copies the samples chunk by chunk (see below)
+void ModelEnsemble::PredictBatch(const Matrix<float> &x, std::vector<float> &means,
+                                 std::vector<float> &variances) const {
+  const auto n = x.cols();
+  PredictBatch(x.rows(), n, [&x, n] (const size_t sample, float* features) {
+    std::copy(x.row(sample), x.row(sample) + n, features);
+  }, means, variances);
+}
+
+// The samples are divided over threads in chunks. Each chunk is encoded once and predicted by each
+// of the models in turn, after which the mean and the (population) variance of their predictions
+// are computed.
+void ModelEnsemble::PredictBatch(const size_t m, const size_t n,
+                                 const MLModel<float>::SampleEncoder &encode,
+                                 std::vector<float> &means, std::vector<float> &variances) const {
+  const auto num_models = static_cast<double>(models_.size());
+  means.resize(m);
+  variances.resize(m);
+  const auto max_threads = MLModel<float>::HardwareThreads();
+  MLModel<float>::ForEachChunk(m, max_threads, [&] (const size_t begin, const size_t end) {
+    auto x_encoded = Matrix<float>(end - begin, n);
+    for (auto sample=begin; sample<end; ++sample) { encode(sample, x_encoded.row(sample - begin)); }
+    auto sums = std::vector<double>(end - begin, 0.0);
+    auto squared_sums = std::vector<double>(end - begin, 0.0);
+    auto x_chunk = Matrix<float>();
+    for (auto &model: models_) {
+      x_chunk = x_encoded; // The models pre-process the chunk in-place
+      const auto predictions = model->PredictRows(x_chunk);
+      for (auto s=size_t{0}; s<predictions.size(); ++s) {
+        sums[s] += predictions[s];
+        squared_sums[s] += static_cast<double>(predictions[s]) * predictions[s];
+      }
+    }
+    for (auto s=size_t{0}; s<sums.size(); ++s) {
+      const auto mean = sums[s] / num_models;
+      means[begin + s] = static_cast<float>(mean);
+      variances[begin + s] = static_cast<float>(std::max(0.0, squared_sums[s] / num_models -
+                                                              mean * mean));
+    }
+  });
+}
+
+// As above, but only returns the means
+std::vector<float> ModelEnsemble::PredictBatch(const Matrix<float> &x) const {
+  if (models_.size() == 1) { return models_[0]->PredictBatch(x); }
+  auto means = std::vector<float>();
+  auto variances = std::vector<float>();
+  PredictBatch(x, means, variances);
+  return means;
+}
+
+// Predicts a single sample
+float ModelEnsemble::Predict(const std::vector<float> &x) const {
+  auto mean = 0.0;
+  for (auto &model: models_) { mean += model->Predict(x); }
+  return static_cast<float>(mean / static_cast<double>(models_.size()));
+}
+
+// =================================================================================================
+
+// Saves the number of models on a line of its own
+void ModelEnsemble::Save(std::ostream &file) const {
+  file << models_.size() << "\n";
+  for (auto &model: models_) { model->Save(file); }
+}
+
+// =================================================================================================
+} // namespace cltune
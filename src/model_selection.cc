@@ -0,0 +1,248 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the creation and selection of machine learning models (see the header for
+// more information).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/model_selection.h"
+#include "internal/tuner_impl.h"
+
+// The machine learning models
+#include "internal/ml_models/linear_regression.h"
+#include "internal/ml_models/neural_network.h"
+#include "internal/ml_models/gradient_boosted_trees.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+
+namespace cltune {
+// =================================================================================================
+
+// Settings which are not selected: the training length of the neural network (epochs and minibatch
+// size) and of the trees (number of trees and minimum samples per leaf)
+const size_t kNeuralNetworkEpochs = size_t{200};
+const size_t kNeuralNetworkBatchSize = size_t{128};
+const size_t kNumTrees = size_t{200};
+const size_t kMinSamplesLeaf = size_t{2};
+
+// =================================================================================================
+
+// Lists the hyperparameters which apply to the type of model
+std::string ModelSettings::GetDescription() const {
+  auto description = std::string{"lambda "} + std::to_string(lambda);
+  if (type == Model::kNeuralNetwork) {
+    description += ", learning rate " + std::to_string(learning_rate) + ", hidden layers";
+    for (auto &layer: hidden_layers) { description += " " + std::to_string(layer); }
+  }
+  else if (type == Model::kGradientBoostedTrees) {
+    description += ", learning rate " + std::to_string(learning_rate) + ", maximum depth " +
+                   std::to_string(max_depth);
+  }
+  return description;
+}
+
+// The settings which were used before hyperparameter selection was introduced
+ModelSettings DefaultModelSettings(const Model type) {
+  switch (type) {
+    case Model::kLinearRegression: return ModelSettings{type, 0.0f, 0.2f, {}, 0};
+    case Model::kNeuralNetwork: return ModelSettings{type, 0.02f, 0.005f, {20}, 0};
+    case Model::kGradientBoostedTrees: return ModelSettings{type, 0.1f, 1.0f, {}, 6};
+    default: throw std::runtime_error("Unknown machine learning model");
+  }
+}
+
+// Varies the most important hyperparameters of each type of model
+std::vector<ModelSettings> CandidateModelSettings(const Model type) {
+  auto candidates = std::vector<ModelSettings>();
+  if (type == Model::kLinearRegression) {
+    for (auto &lambda: {0.02f, 0.2f, 2.0f, 20.0f}) {
+      candidates.push_back(ModelSettings{type, 0.0f, lambda, {}, 0});
+    }
+  }
+  else if (type == Model::kNeuralNetwork) {
+    for (auto &learning_rate: {0.005f, 0.02f}) {
+      for (auto &hidden_layers: {std::vector<size_t>{20}, std::vector<size_t>{32, 16}}) {
+        candidates.push_back(ModelSettings{type, learning_rate, 0.005f, hidden_layers, 0});
+      }
+    }
+  }
+  else if (type == Model::kGradientBoostedTrees) {
+    for (auto &learning_rate: {0.05f, 0.1f}) {
+      for (auto &max_depth: {size_t{3}, size_t{6}}) {
+        candidates.push_back(ModelSettings{type, learning_rate, 1.0f, {}, max_depth});
+      }
+    }
+  }
+  else {
+    throw std::runtime_error("Unknown machine learning model");
+  }
+  return candidates;
+}
+
+// =================================================================================================
+
+// Creates one of the models. The neural network gets an input layer of the size of the features and
+// a single output.
+std::unique_ptr<MLModel<float>> CreateModel(const ModelSettings &settings,
+                                            const size_t num_features, const bool debug_display,
+                                            const unsigned int seed, const size_t max_threads) {
+  auto model = std::unique_ptr<MLModel<float>>();
+  if (settings.type == Model::kLinearRegression) {
+    model.reset(new LinearRegression<float>(settings.lambda, debug_display));
+  }
+  else if (settings.type == Model::kNeuralNetwork) {
+    auto layers = std::vector<size_t>{num_features};
+    layers.insert(layers.end(), settings.hidden_layers.begin(), settings.hidden_layers.end());
+    layers.push_back(1);
+    model.reset(new NeuralNetwork<float>(kNeuralNetworkEpochs, settings.learning_rate,
+                                         settings.lambda, layers, kNeuralNetworkBatchSize,
+                                         debug_display, seed));
+  }
+  else if (settings.type == Model::kGradientBoostedTrees) {
+    model.reset(new GradientBoostedTrees<float>(kNumTrees, settings.learning_rate,
+                                                settings.max_depth, kMinSamplesLeaf,
+                                                settings.lambda, debug_display));
+  }
+  else {
+    throw std::runtime_error("Unknown machine learning model");
+  }
+  model->SetMaxThreads(max_threads);
+  return model;
+}
+
+// =================================================================================================
+
+// Each (candidate, fold) pair is a job. Threads take the next job from a shared counter until all
+// are done, and each job writes only its own error.
+std::vector<double> CrossValidate(const std::vector<ModelSettings> &candidates,
+                                  const std::vector<std::vector<float>> &x,
+                                  const std::vector<float> &y, const size_t num_folds,
+                                  const unsigned int seed) {
+  const auto m = x.size();
+  if (num_folds < 2 || m < num_folds) { throw std::runtime_error("Too few samples for the folds"); }
+  const auto num_features = x[0].size();
+
+  // Shuffles the samples, such that the folds don't depend on the order of the search
+  auto order = std::vector<size_t>(m);
+  std::iota(order.begin(), order.end(), size_t{0});
+  std::shuffle(order.begin(), order.end(), std::default_random_engine(seed));
+
+  // Runs the jobs on at most one thread per hardware thread. The models of the jobs share the
+  // remaining hardware threads (if any), such that the total number of threads doesn't exceed it.
+  const auto num_jobs = candidates.size() * num_folds;
+  const auto hardware_threads = MLModel<float>::HardwareThreads();
+  const auto num_threads = std::max(size_t{1}, std::min(hardware_threads, num_jobs));
+  const auto threads_per_model = hardware_threads / num_threads;
+
+  // Trains a candidate on all but one fold and computes the squared errors on that fold
+  auto fold_errors = std::vector<double>(num_jobs, 0.0);
+  auto run_job = [&] (const size_t job) {
+    const auto fold = job % num_folds;
+    const auto begin = (m*fold)/num_folds;
+    const auto end = (m*(fold + 1))/num_folds;
+    auto x_train = std::vector<std::vector<float>>();
+    auto y_train = std::vector<float>();
+    auto x_validation = Matrix<float>(end - begin, num_features);
+    auto y_validation = std::vector<float>();
+    for (auto i=size_t{0}; i<m; ++i) {
+      if (i >= begin && i < end) {
+        std::copy(x[order[i]].begin(), x[order[i]].end(), x_validation.row(i - begin));
+        y_validation.push_back(y[order[i]]);
+      }
+      else {
+        x_train.push_back(x[order[i]]);
+        y_train.push_back(y[order[i]]);
+      }
+    }
+    auto model = CreateModel(candidates[job / num_folds], num_features, false, seed,
+                             threads_per_model);
+    model->Train(x_train, y_train);
+    const auto predictions = model->PredictBatch(x_validation);
+    for (auto i=size_t{0}; i<predictions.size(); ++i) {
+      const auto difference = std::log(static_cast<double>(predictions[i])) -
+                              std::log(static_cast<double>(y_validation[i]));
+      fold_errors[job] += difference * difference;
+    }
+  };
+
+  // Runs the jobs in parallel, passing on the first error of any of the threads
+  std::atomic<size_t> next_job(0);
+  auto errors = std::vector<std::exception_ptr>(num_threads);
+  auto run_jobs = [&] (const size_t tid) {
+    try {
+      for (auto job=next_job++; job<num_jobs; job=next_job++) { run_job(job); }
+    } catch (...) {
+      errors[tid] = std::current_exception();
+    }
+  };
+  auto threads = std::vector<std::thread>();
+  for (auto tid=size_t{1}; tid<num_threads; ++tid) { threads.emplace_back(run_jobs, tid); }
+  run_jobs(0);
+  for (auto &thread: threads) { thread.join(); }
+  for (auto &error: errors) {
+    if (error) { std::rethrow_exception(error); }
+  }
+
+  // Sums the errors of the folds into the mean error per candidate. Non-finite predictions (e.g. a
+  // diverged model) give an infinite error.
+  auto cross_validation_errors = std::vector<double>(candidates.size(), 0.0);
+  for (auto job=size_t{0}; job<num_jobs; ++job) {
+    cross_validation_errors[job / num_folds] += fold_errors[job] / static_cast<double>(m);
+  }
+  for (auto &error: cross_validation_errors) {
+    if (!std::isfinite(error)) { error = std::numeric_limits<double>::infinity(); }
+  }
+  return cross_validation_errors;
+}
+
+// Cross-validates all candidates and keeps the best
+ModelSettings SelectModelSettings(const Model type, const std::vector<std::vector<float>> &x,
+                                  const std::vector<float> &y, const size_t num_folds,
+                                  const unsigned int seed, const bool print) {
+  if (num_folds < 2 || x.size() < num_folds) { return DefaultModelSettings(type); }
+  const auto candidates = CandidateModelSettings(type);
+  const auto errors = CrossValidate(candidates, x, y, num_folds, seed);
+  auto best = size_t{0};
+  for (auto c=size_t{0}; c<candidates.size(); ++c) {
+    if (print) {
+      printf("%s Cross-validation error %.2e: %s\n", TunerImpl::kMessageInfo.c_str(), errors[c],
+             candidates[c].GetDescription().c_str());
+    }
+    if (errors[c] < errors[best]) { best = c; }
+  }
+  return candidates[best];
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,135 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the PerformanceModel class (see the header for information about the class).
+// Its implementation class holds the loaded feature encoder and machine learning model.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "cltune.h"
+
+// The feature encoder and the machine learning models
+#include "internal/feature_encoder.h"
+#include "internal/model_ensemble.h"
+
+#include <fstream> // std::ifstream
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// The implementation of the performance model (Pimpl idiom)
+class PerformanceModelImpl {
+ public:
+
+  // Reads the header, the kernel name, the feature encoder, and the model in that order
+  explicit PerformanceModelImpl(std::istream &file):
+      kernel_name_(ReadHeader(file)),
+      encoder_(file),
+      model_(file) {
+  }
+
+  // Checks the header of the file and reads the kernel name
+  static std::string ReadHeader(std::istream &file) {
+    auto header = std::string{};
+    auto kernel_name = std::string{};
+    std::getline(file, header);
+    std::getline(file, kernel_name);
+    if (!file || header != TunerImpl::kModelFileHeader) {
+      throw std::runtime_error("Invalid model file");
+    }
+    return kernel_name;
+  }
+
+  // Encodes a configuration given by name into a row of features. Parameters are ordered as in the
+  // encoder.
+  void Encode(const std::unordered_map<std::string, size_t> &configuration, float* features) const {
+    auto settings = KernelInfo::Configuration();
+    for (auto &parameter: encoder_.parameters()) {
+      const auto setting = configuration.find(parameter.name);
+      if (setting == configuration.end()) {
+        throw std::runtime_error("Missing parameter in configuration: "+parameter.name);
+      }
+      settings.push_back(KernelInfo::Setting{parameter.name, setting->second});
+    }
+    encoder_.Encode(settings, features);
+  }
+
+  // Member variables
+  std::string kernel_name_;
+  FeatureEncoder encoder_;
+  ModelEnsemble model_;
+};
+
+// =================================================================================================
+
+// Opens the file and loads the model through the implementation class
+PerformanceModel::PerformanceModel(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file) { throw std::runtime_error("Could not open model file: "+filename); }
+  pimpl = std::unique_ptr<PerformanceModelImpl>(new PerformanceModelImpl(file));
+}
+
+// The destructor is defined here, where the implementation class is complete
+PerformanceModel::~PerformanceModel() {
+}
+
+// =================================================================================================
+
+// Retrieves the name of the kernel
+std::string PerformanceModel::GetKernelName() const {
+  return pimpl->kernel_name_;
+}
+
+// Retrieves the names of the parameters
+std::vector<std::string> PerformanceModel::GetParameterNames() const {
+  auto names = std::vector<std::string>();
+  for (auto &parameter: pimpl->encoder_.parameters()) { names.push_back(parameter.name); }
+  return names;
+}
+
+// =================================================================================================
+
+// Predicts a single configuration
+float PerformanceModel::Predict(const std::unordered_map<std::string, size_t> &configuration) const {
+  auto features = std::vector<float>(pimpl->encoder_.NumFeatures());
+  pimpl->Encode(configuration, features.data());
+  return pimpl->model_.Predict(features);
+}
+
+// Predicts all configurations at once. The threads encode and predict them chunk by chunk.
+std::vector<float> PerformanceModel::PredictBatch(
+    const std::vector<std::unordered_map<std::string, size_t>> &configurations) const {
+  auto means = std::vector<float>();
+  auto variances = std::vector<float>();
+  pimpl->model_.PredictBatch(configurations.size(), pimpl->encoder_.NumFeatures(),
+                             [this, &configurations] (const size_t c, float* row) {
+                               pimpl->Encode(configurations[c], row);
+                             },
+                             means, variances);
+  return means;
+}
+
+// =================================================================================================
+} // namespace cltune
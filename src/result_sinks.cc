@@ -0,0 +1,172 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the result sinks (see the header for information about them).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/result_sinks.h"
+#include "internal/results_writer.h"
+
+#include <limits> // std::numeric_limits
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// The names of the outcomes
+std::string OutcomeName(const Outcome outcome) {
+  switch (outcome) {
+    case Outcome::kSuccess: return "success";
+    case Outcome::kCompileFailure: return "compile_failure";
+    case Outcome::kLaunchFailure: return "launch_failure";
+    case Outcome::kVerificationFailure: return "verification_failure";
+    case Outcome::kPredictedFailure: return "predicted_failure";
+  }
+  return "unknown";
+}
+Outcome OutcomeFromName(const std::string &name) {
+  if (name == "success") { return Outcome::kSuccess; }
+  if (name == "compile_failure") { return Outcome::kCompileFailure; }
+  if (name == "launch_failure") { return Outcome::kLaunchFailure; }
+  if (name == "verification_failure") { return Outcome::kVerificationFailure; }
+  if (name == "predicted_failure") { return Outcome::kPredictedFailure; }
+  throw std::runtime_error("Unknown outcome: "+name);
+}
+
+// Creates a sink of the requested format. The text-based sinks only store the device name.
+std::unique_ptr<ResultSink> CreateResultSink(
+    const ResultFormat format, const std::string &filename,
+    const std::vector<std::pair<std::string,std::string>> &device_info,
+    const std::vector<KernelInfo> &kernels) {
+  auto device = std::string{};
+  for (auto &info: device_info) {
+    if (info.first == "device") { device = info.second; }
+  }
+  switch (format) {
+    case ResultFormat::kCSV:
+      return std::unique_ptr<ResultSink>(new CSVResultSink(filename, device, kernels));
+    case ResultFormat::kJSONLines:
+      return std::unique_ptr<ResultSink>(new JSONLinesResultSink(filename, device, kernels));
+    case ResultFormat::kBinary:
+      return std::unique_ptr<ResultSink>(new BinaryResultsWriter(filename, device_info, kernels));
+  }
+  throw std::runtime_error("Invalid result format");
+}
+
+// =================================================================================================
+
+// Opens the file and computes the hashes of the kernels up-front
+CSVResultSink::CSVResultSink(const std::string &filename, const std::string &device,
+                             const std::vector<KernelInfo> &kernels):
+    file_(fopen(filename.c_str(), "w")),
+    device_(device),
+    kernel_hashes_(),
+    kernel_name_() {
+  if (!file_) { throw std::runtime_error("Could not open results file: "+filename); }
+  for (auto &kernel: kernels) { kernel_hashes_[kernel.name()] = kernel.SourceHash(); }
+}
+
+// Closes the file
+CSVResultSink::~CSVResultSink() {
+  fclose(file_);
+}
+
+// Writes the header line if the kernel changed, followed by the result itself
+void CSVResultSink::Write(const TunerImpl::TunerResult &result) {
+  if (result.kernel_name != kernel_name_) {
+    kernel_name_ = result.kernel_name;
+    fprintf(file_, "name;time;threads;status;outcome;drift;device;kernel_hash;");
+    for (auto &setting: result.configuration) {
+      fprintf(file_, "%s;", setting.name.c_str());
+    }
+    fprintf(file_, "\n");
+  }
+  fprintf(file_, "%s;", result.kernel_name.c_str());
+  if (result.time != std::numeric_limits<float>::max()) { fprintf(file_, "%.3lf", result.time); }
+  fprintf(file_, ";%zu;%d;%s;", result.threads, result.status ? 1 : 0,
+          OutcomeName(result.outcome).c_str());
+  fprintf(file_, "%.3lf;%s;%s;", result.drift, device_.c_str(),
+          kernel_hashes_[result.kernel_name].c_str());
+  for (auto &setting: result.configuration) {
+    fprintf(file_, "%zu;", setting.value);
+  }
+  fprintf(file_, "\n");
+  Flush();
+}
+
+// Flushes the file, throws on failure (e.g. a full disk)
+void CSVResultSink::Flush() {
+  if (fflush(file_) != 0 || ferror(file_)) {
+    throw std::runtime_error("Could not write to the results file");
+  }
+}
+
+// =================================================================================================
+
+// Opens the file and computes the hashes of the kernels up-front
+JSONLinesResultSink::JSONLinesResultSink(const std::string &filename, const std::string &device,
+                                         const std::vector<KernelInfo> &kernels):
+    file_(fopen(filename.c_str(), "w")),
+    device_(device),
+    kernel_hashes_() {
+  if (!file_) { throw std::runtime_error("Could not open results file: "+filename); }
+  for (auto &kernel: kernels) { kernel_hashes_[kernel.name()] = kernel.SourceHash(); }
+}
+
+// Closes the file
+JSONLinesResultSink::~JSONLinesResultSink() {
+  fclose(file_);
+}
+
+// Writes the result as a single line
+void JSONLinesResultSink::Write(const TunerImpl::TunerResult &result) {
+  fprintf(file_, "{\"kernel\": \"%s\", \"kernel_hash\": \"%s\", \"device\": \"%s\", ",
+          result.kernel_name.c_str(), kernel_hashes_[result.kernel_name].c_str(), device_.c_str());
+  fprintf(file_, "\"time\": ");
+  if (result.time != std::numeric_limits<float>::max()) { fprintf(file_, "%.3lf", result.time); }
+  else { fprintf(file_, "null"); }
+  fprintf(file_, ", \"threads\": %zu, \"status\": %s, \"outcome\": \"%s\", \"drift\": %.3lf, ",
+          result.threads, result.status ? "true" : "false", OutcomeName(result.outcome).c_str(),
+          result.drift);
+  fprintf(file_, "\"parameters\": {");
+  const auto num_configs = result.configuration.size();
+  for (auto p=size_t{0}; p<num_configs; ++p) {
+    const auto &setting = result.configuration[p];
+    fprintf(file_, "\"%s\": %zu", setting.name.c_str(), setting.value);
+    if (p < num_configs-1) { fprintf(file_, ", "); }
+  }
+  fprintf(file_, "}}\n");
+  Flush();
+}
+
+// Flushes the file, throws on failure (e.g. a full disk)
+void JSONLinesResultSink::Flush() {
+  if (fflush(file_) != 0 || ferror(file_)) {
+    throw std::runtime_error("Could not write to the results file");
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,343 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the ResultsReader class, the reader of the binary columnar results format
+// (see the BinaryResultsWriter class for a description of the format). The file is memory-mapped
+// using POSIX mmap or its Windows equivalent.
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "cltune.h"
+
+// The format constants
+#include "internal/results_writer.h"
+
+#include <stdexcept> // std::runtime_error
+#include <cstring> // std::memcpy
+
+#if defined(_WIN32)
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+namespace cltune {
+// =================================================================================================
+
+// A read-only memory mapping of a whole file, unmapped when destroyed
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+ private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  const char* data_;
+  size_t size_;
+  #if defined(_WIN32)
+    HANDLE file_;
+    HANDLE mapping_;
+  #else
+    int file_;
+  #endif
+};
+
+#if defined(_WIN32)
+
+// Maps the file using a file mapping object
+MappedFile::MappedFile(const std::string &filename):
+    data_(nullptr),
+    size_(0),
+    file_(INVALID_HANDLE_VALUE),
+    mapping_(nullptr) {
+  file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Could not open results file: "+filename);
+  }
+  auto size = LARGE_INTEGER{};
+  if (GetFileSizeEx(file_, &size) && size.QuadPart > 0) {
+    size_ = static_cast<size_t>(size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr) {
+      data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+  }
+  if (data_ == nullptr) {
+    if (mapping_ != nullptr) { CloseHandle(mapping_); }
+    CloseHandle(file_);
+    throw std::runtime_error("Could not map results file: "+filename);
+  }
+}
+
+// Unmaps the file and closes the handles
+MappedFile::~MappedFile() {
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+  CloseHandle(file_);
+}
+
+#else
+
+// Maps the file read-only. The kernel is told that the file is read sequentially.
+MappedFile::MappedFile(const std::string &filename):
+    data_(nullptr),
+    size_(0),
+    file_(open(filename.c_str(), O_RDONLY)) {
+  if (file_ == -1) { throw std::runtime_error("Could not open results file: "+filename); }
+  struct stat status;
+  if (fstat(file_, &status) == 0 && status.st_size > 0) {
+    size_ = static_cast<size_t>(status.st_size);
+    const auto data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<const char*>(data);
+      madvise(data, size_, MADV_SEQUENTIAL);
+    }
+  }
+  if (data_ == nullptr) {
+    close(file_);
+    throw std::runtime_error("Could not map results file: "+filename);
+  }
+}
+
+// Unmaps and closes the file
+MappedFile::~MappedFile() {
+  munmap(const_cast<char*>(data_), size_);
+  close(file_);
+}
+
+#endif
+
+// =================================================================================================
+
+// The implementation of the results reader (Pimpl idiom)
+class ResultsReaderImpl {
+ public:
+
+  // A kernel as given in the header
+  struct Kernel {
+    std::string name;
+    std::vector<std::string> parameter_names;
+    std::vector<std::vector<size_t>> parameter_values;
+  };
+
+  // Maps the file, reads the header, and finds the blocks
+  explicit ResultsReaderImpl(const std::string &filename):
+      file_(filename),
+      device_info_(),
+      kernels_(),
+      block_offsets_(),
+      num_results_(0) {
+    auto offset = size_t{0};
+    const auto magic = BinaryResultsWriter::kMagic;
+    if (file_.size() < magic.size() || std::string(file_.data(), magic.size()) != magic) {
+      throw std::runtime_error("Invalid results file: "+filename);
+    }
+    offset += magic.size();
+    if (Read<uint32_t>(offset) != BinaryResultsWriter::kVersion) {
+      throw std::runtime_error("Unsupported version of results file: "+filename);
+    }
+    const auto num_info = Read<uint32_t>(offset);
+    for (auto i=uint32_t{0}; i<num_info; ++i) {
+      const auto key = ReadString(offset);
+      device_info_.push_back(std::make_pair(key, ReadString(offset)));
+    }
+    const auto num_kernels = Read<uint32_t>(offset);
+    for (auto k=uint32_t{0}; k<num_kernels; ++k) {
+      auto kernel = Kernel();
+      kernel.name = ReadString(offset);
+      const auto num_parameters = Read<uint32_t>(offset);
+      for (auto p=uint32_t{0}; p<num_parameters; ++p) {
+        kernel.parameter_names.push_back(ReadString(offset));
+        auto values = std::vector<size_t>(Read<uint32_t>(offset));
+        for (auto &value: values) { value = static_cast<size_t>(Read<uint64_t>(offset)); }
+        kernel.parameter_values.push_back(values);
+      }
+      kernels_.push_back(kernel);
+    }
+
+    // Hops from block to block using their headers, stopping at a block which is cut off
+    offset = Align(offset);
+    while (offset + 2*sizeof(uint32_t) <= file_.size()) {
+      auto header_offset = offset;
+      const auto kernel_id = Read<uint32_t>(header_offset);
+      const auto num_results = Read<uint32_t>(header_offset);
+      if (kernel_id >= kernels_.size() || num_results == 0) { break; }
+      const auto end = offset + BlockSize(kernel_id, num_results);
+      if (end > file_.size()) { break; }
+      block_offsets_.push_back(offset);
+      num_results_ += num_results;
+      offset = end;
+    }
+  }
+
+  // Computes the size of a block, including its header and padding
+  size_t BlockSize(const size_t kernel_id, const size_t num_results) const {
+    const auto num_parameters = kernels_[kernel_id].parameter_names.size();
+    return Align(2*sizeof(uint32_t) + num_results*(2*sizeof(float) +
+                                                   num_parameters*sizeof(uint32_t) + 2));
+  }
+
+  // Rounds an offset up to the alignment of the blocks
+  static size_t Align(const size_t offset) {
+    const auto alignment = BinaryResultsWriter::kAlignment;
+    return ((offset + alignment - 1) / alignment) * alignment;
+  }
+
+  // Reads a number from the header at the offset and moves the offset past it
+  template <typename T>
+  T Read(size_t &offset) const {
+    if (offset + sizeof(T) > file_.size()) { throw std::runtime_error("Truncated results file"); }
+    auto value = T{0};
+    std::memcpy(&value, file_.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+  }
+
+  // As above, but for a string
+  std::string ReadString(size_t &offset) const {
+    const auto length = static_cast<size_t>(Read<uint32_t>(offset));
+    if (offset + length > file_.size()) { throw std::runtime_error("Truncated results file"); }
+    const auto value = std::string(file_.data() + offset, length);
+    offset += length;
+    return value;
+  }
+
+  // Retrieves a kernel by ID, throws if it doesn't exist
+  const Kernel& GetKernel(const size_t kernel_id) const {
+    if (kernel_id >= kernels_.size()) { throw std::runtime_error("Invalid kernel ID"); }
+    return kernels_[kernel_id];
+  }
+
+  // Member variables
+  MappedFile file_;
+  std::vector<std::pair<std::string,std::string>> device_info_;
+  std::vector<Kernel> kernels_;
+  std::vector<size_t> block_offsets_;
+  size_t num_results_;
+};
+
+// =================================================================================================
+
+// Creates the implementation class
+ResultsReader::ResultsReader(const std::string &filename):
+    pimpl(new ResultsReaderImpl(filename)) {
+}
+
+// The destructor is defined here, where the implementation class is complete
+ResultsReader::~ResultsReader() {
+}
+
+// =================================================================================================
+
+// Retrieves the information of the device
+std::vector<std::pair<std::string,std::string>> ResultsReader::GetDeviceInfo() const {
+  return pimpl->device_info_;
+}
+
+// Retrieves the number of kernels
+size_t ResultsReader::NumKernels() const {
+  return pimpl->kernels_.size();
+}
+
+// Retrieves the name of a kernel
+std::string ResultsReader::GetKernelName(const size_t kernel_id) const {
+  return pimpl->GetKernel(kernel_id).name;
+}
+
+// Retrieves the names of the parameters of a kernel
+std::vector<std::string> ResultsReader::GetParameterNames(const size_t kernel_id) const {
+  return pimpl->GetKernel(kernel_id).parameter_names;
+}
+
+// Retrieves the values of a parameter of a kernel
+std::vector<size_t> ResultsReader::GetParameterValues(const size_t kernel_id,
+                                                      const size_t parameter_id) const {
+  const auto &kernel = pimpl->GetKernel(kernel_id);
+  if (parameter_id >= kernel.parameter_values.size()) {
+    throw std::runtime_error("Invalid parameter ID");
+  }
+  return kernel.parameter_values[parameter_id];
+}
+
+// =================================================================================================
+
+// Retrieves the number of blocks
+size_t ResultsReader::NumBlocks() const {
+  return pimpl->block_offsets_.size();
+}
+
+// Sets the pointers to the columns of the block, which follow its header in the order in which they
+// are written
+ResultsReader::Block ResultsReader::GetBlock(const size_t block_id) const {
+  if (block_id >= pimpl->block_offsets_.size()) { throw std::runtime_error("Invalid block ID"); }
+  auto offset = pimpl->block_offsets_[block_id];
+  auto block = Block();
+  block.kernel_id = static_cast<size_t>(pimpl->Read<uint32_t>(offset));
+  block.num_results = static_cast<size_t>(pimpl->Read<uint32_t>(offset));
+  const auto data = pimpl->file_.data();
+  const auto num_parameters = pimpl->kernels_[block.kernel_id].parameter_names.size();
+  block.times = reinterpret_cast<const float*>(data + offset);
+  offset += block.num_results*sizeof(float);
+  block.drifts = reinterpret_cast<const float*>(data + offset);
+  offset += block.num_results*sizeof(float);
+  for (auto p=size_t{0}; p<num_parameters; ++p) {
+    block.value_indices.push_back(reinterpret_cast<const uint32_t*>(data + offset));
+    offset += block.num_results*sizeof(uint32_t);
+  }
+  block.statuses = reinterpret_cast<const uint8_t*>(data + offset);
+  offset += block.num_results;
+  block.outcomes = reinterpret_cast<const uint8_t*>(data + offset);
+  return block;
+}
+
+// Retrieves the total number of results
+size_t ResultsReader::NumResults() const {
+  return pimpl->num_results_;
+}
+
+// Looks up the values of the parameters. Missing parameters are left out.
+std::unordered_map<std::string, size_t> ResultsReader::GetConfiguration(const Block &block,
+                                                                       const size_t result) const {
+  const auto &kernel = pimpl->GetKernel(block.kernel_id);
+  if (result >= block.num_results) { throw std::runtime_error("Invalid result ID"); }
+  auto configuration = std::unordered_map<std::string, size_t>();
+  for (auto p=size_t{0}; p<kernel.parameter_names.size(); ++p) {
+    const auto value_index = block.value_indices[p][result];
+    if (value_index >= kernel.parameter_values[p].size()) { continue; }
+    configuration[kernel.parameter_names[p]] = kernel.parameter_values[p][value_index];
+  }
+  return configuration;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,193 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the BinaryResultsWriter class (see the header for information about the
+// class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/results_writer.h"
+
+#include <algorithm> // std::find
+#include <stdexcept> // std::runtime_error
+
+namespace cltune {
+// =================================================================================================
+
+// Format constants
+const std::string BinaryResultsWriter::kMagic = "CLTuneRS";
+const uint32_t BinaryResultsWriter::kVersion = 1;
+const size_t BinaryResultsWriter::kBlockResults = size_t{4096};
+const size_t BinaryResultsWriter::kAlignment = size_t{8};
+const uint32_t BinaryResultsWriter::kMissingValue = UINT32_MAX;
+
+// =================================================================================================
+
+// Writes the header, which is padded such that the first block is aligned
+BinaryResultsWriter::BinaryResultsWriter(
+    const std::string &filename, const std::vector<std::pair<std::string,std::string>> &device_info,
+    const std::vector<KernelInfo> &kernels):
+    file_(fopen(filename.c_str(), "wb")),
+    offset_(0),
+    kernel_names_(),
+    kernel_parameters_(),
+    kernel_id_(0),
+    times_(),
+    drifts_(),
+    value_indices_(),
+    statuses_(),
+    outcomes_() {
+  if (!file_) { throw std::runtime_error("Could not open results file: "+filename); }
+  WriteBytes(kMagic.data(), kMagic.size());
+  WriteValue(kVersion);
+  WriteValue(static_cast<uint32_t>(device_info.size()));
+  for (auto &info: device_info) {
+    WriteString(info.first);
+    WriteString(info.second);
+  }
+  WriteValue(static_cast<uint32_t>(kernels.size()));
+  for (auto &kernel: kernels) {
+    const auto parameters = kernel.parameters();
+    kernel_names_.push_back(kernel.name());
+    kernel_parameters_.push_back(parameters);
+    WriteString(kernel.name());
+    WriteValue(static_cast<uint32_t>(parameters.size()));
+    for (auto &parameter: parameters) {
+      WriteString(parameter.name);
+      WriteValue(static_cast<uint32_t>(parameter.values.size()));
+      for (auto &value: parameter.values) { WriteValue(static_cast<uint64_t>(value)); }
+    }
+  }
+  WritePadding();
+}
+
+// Writes the remaining results. Errors can't be reported from here: call Flush first to get them.
+BinaryResultsWriter::~BinaryResultsWriter() {
+  try {
+    WriteBlock();
+  } catch (...) {
+  }
+  fclose(file_);
+}
+
+// =================================================================================================
+
+// Finds the kernel of the result and the index of each parameter's value. The settings of the
+// configuration are normally in the same order as the parameters, otherwise they are searched.
+void BinaryResultsWriter::Write(const TunerImpl::TunerResult &result) {
+  auto kernel_id = kernel_id_;
+  if (times_.size() == 0 || kernel_names_[kernel_id] != result.kernel_name) {
+    const auto kernel = std::find(kernel_names_.begin(), kernel_names_.end(), result.kernel_name);
+    if (kernel == kernel_names_.end()) {
+      throw std::runtime_error("Unknown kernel for the results file: "+result.kernel_name);
+    }
+    kernel_id = static_cast<size_t>(kernel - kernel_names_.begin());
+  }
+  if (times_.size() == kBlockResults || kernel_id != kernel_id_) { WriteBlock(); }
+  const auto &parameters = kernel_parameters_[kernel_id];
+  if (times_.size() == 0) {
+    kernel_id_ = kernel_id;
+    value_indices_.resize(parameters.size());
+  }
+
+  // Adds the result to the columns
+  times_.push_back(result.time);
+  drifts_.push_back(result.drift);
+  statuses_.push_back(static_cast<uint8_t>(result.status ? 1 : 0));
+  outcomes_.push_back(static_cast<uint8_t>(result.outcome));
+  const auto &configuration = result.configuration;
+  for (auto p=size_t{0}; p<parameters.size(); ++p) {
+    const auto &parameter = parameters[p];
+    auto setting = configuration.begin() + std::min(p, configuration.size());
+    if (setting == configuration.end() || setting->name != parameter.name) {
+      setting = std::find_if(configuration.begin(), configuration.end(),
+                             [&parameter] (const KernelInfo::Setting &s) {
+                               return s.name == parameter.name;
+                             });
+    }
+    auto value_index = kMissingValue;
+    if (setting != configuration.end()) {
+      const auto &values = parameter.values;
+      const auto value = std::find(values.begin(), values.end(), setting->value);
+      if (value != values.end()) {
+        value_index = static_cast<uint32_t>(value - values.begin());
+      }
+    }
+    value_indices_[p].push_back(value_index);
+  }
+}
+
+// Writes the block such that readers can see it
+void BinaryResultsWriter::Flush() {
+  WriteBlock();
+  fflush(file_);
+}
+
+// Writes the block header (the kernel ID and the number of results) followed by the columns: first
+// the 4-byte ones, then the 1-byte ones, such that all are aligned
+void BinaryResultsWriter::WriteBlock() {
+  const auto num_results = times_.size();
+  if (num_results == 0) { return; }
+  WriteValue(static_cast<uint32_t>(kernel_id_));
+  WriteValue(static_cast<uint32_t>(num_results));
+  WriteBytes(times_.data(), num_results*sizeof(float));
+  WriteBytes(drifts_.data(), num_results*sizeof(float));
+  for (auto &value_indices: value_indices_) {
+    WriteBytes(value_indices.data(), num_results*sizeof(uint32_t));
+    value_indices.clear();
+  }
+  WriteBytes(statuses_.data(), num_results);
+  WriteBytes(outcomes_.data(), num_results);
+  WritePadding();
+  times_.clear();
+  drifts_.clear();
+  statuses_.clear();
+  outcomes_.clear();
+}
+
+// =================================================================================================
+
+// Writes through the buffered file and throws on failure (e.g. a full disk)
+void BinaryResultsWriter::WriteBytes(const void* data, const size_t size) {
+  if (size == 0) { return; }
+  if (fwrite(data, 1, size, file_) != size) {
+    throw std::runtime_error("Could not write to the results file");
+  }
+  offset_ += size;
+}
+
+// Writes the length of a string and its characters
+void BinaryResultsWriter::WriteString(const std::string &value) {
+  WriteValue(static_cast<uint32_t>(value.size()));
+  WriteBytes(value.data(), value.size());
+}
+
+// Pads with zeros up to the next multiple of the alignment
+void BinaryResultsWriter::WritePadding() {
+  const auto zeros = std::vector<char>((kAlignment - offset_ % kAlignment) % kAlignment, 0);
+  WriteBytes(zeros.data(), zeros.size());
+}
+
+// =================================================================================================
+} // namespace cltune
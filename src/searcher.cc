@@ -29,16 +29,27 @@
 #include "internal/searcher.h"
 
 #include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
 
 namespace cltune {
 // =================================================================================================
 
+// Number of random attempts to find an unexplored configuration before scanning for one
+const size_t Searcher::kMaxRandomAttempts = size_t{16};
+
+// The execution time given to the search algorithm for a failed configuration
+const double Searcher::kFailureTime = std::numeric_limits<double>::infinity();
+
 // Simple base-class constructor
 Searcher::Searcher(const Configurations &configurations):
     configurations_(configurations),
     execution_times_(configurations.size(), std::numeric_limits<double>::max()),
     explored_indices_(),
-    index_(0) {
+    index_(0),
+    failure_model_(),
+    predicted_failures_(configurations.size(), false) {
 }
 
 // Adds the resulting execution time to the back of the execution times vector. Also stores the
@@ -48,15 +59,176 @@ void Searcher::PushExecutionTime(const double execution_time) {
   execution_times_[index_] = execution_time;
 }
 
-// Prints the explored indices and the corresponding execution times to a log(file)
+// Only compile and launch failures are taken into account by the failure model: a verification
+// failure is a problem of the kernel's output, not of its parameters' feasibility
+void Searcher::PushOutcome(const Outcome outcome, const double execution_time) {
+  if (outcome == Outcome::kSuccess || outcome == Outcome::kCompileFailure ||
+      outcome == Outcome::kLaunchFailure) {
+    const auto failed = (outcome != Outcome::kSuccess);
+    failure_model_.Add(configurations_[index_], failed);
+  }
+  if (outcome == Outcome::kPredictedFailure) { predicted_failures_[index_] = true; }
+  PushExecutionTime((outcome == Outcome::kSuccess) ? execution_time : kFailureTime);
+}
+
+// Queries the failure model for the current configuration
+double Searcher::FailureProbability() const {
+  return failure_model_.Probability(configurations_[index_]);
+}
+
+// Moves the given configurations to the front of the configuration list. This works for searchers
+// which explore the list in order, such as full search and random search.
+void Searcher::SetWarmStart(const Configurations &configurations) {
+  auto position = size_t{0};
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size() || index < position) { continue; }
+    std::swap(configurations_[position], configurations_[index]);
+    ++position;
+  }
+}
+
+// Prints the explored indices and the corresponding execution times to a log(file). These are
+// followed by the values of the parameters, such that the search can be replayed. Configurations
+// which were skipped as predicted failures were never run, so a replay shouldn't run them either.
 void Searcher::PrintLog(FILE* fp) const {
-  fprintf(fp, "step;index;time\n");
+  fprintf(fp, "step;index;time");
+  if (!explored_indices_.empty()) {
+    for (auto &setting: configurations_[explored_indices_[0]]) {
+      fprintf(fp, ";%s", setting.name.c_str());
+    }
+  }
+  fprintf(fp, "\n");
   auto step = 0;
   for (auto &explored_index: explored_indices_) {
-    fprintf(fp, "%d;%zu;%.3lf\n", step, explored_index, execution_times_[explored_index]);
+    if (predicted_failures_[explored_index]) { continue; }
+    fprintf(fp, "%d;%zu;%.3lf", step, explored_index, execution_times_[explored_index]);
+    for (auto &setting: configurations_[explored_index]) {
+      fprintf(fp, ";%s", setting.GetValueString().c_str());
+    }
+    fprintf(fp, "\n");
     ++step;
   }
 }
 
+// =================================================================================================
+
+// Searches all configuration to find which configuration is the 'target' (argument to this
+// function). The target's index in the total configuration vector is returned.
+size_t Searcher::IndexFromConfiguration(const KernelInfo::Configuration &target) const {
+
+  // Uses the neighbour index if it exists: encodes the target and looks up its key
+  if (!keys_.empty()) {
+    auto key = size_t{0};
+    for (auto p=size_t{0}; p<NumParameters(); ++p) {
+      const auto &values = parameter_values_[p];
+      const auto value = std::lower_bound(values.begin(), values.end(), target[p].value);
+      if (value == values.end() || *value != target[p].value) { return configurations_.size(); }
+      key += static_cast<size_t>(value - values.begin()) * strides_[p];
+    }
+    const auto match = key_to_index_.find(key);
+    return (match == key_to_index_.end()) ? configurations_.size() : match->second;
+  }
+
+  // Otherwise, searches through all configurations
+  auto config_index = size_t{0};
+  for (auto &configuration: configurations_) {
+    auto num_matches = size_t{0};
+    for (auto i=size_t{0}; i<configuration.size(); ++i) {
+      if (configuration[i].value == target[i].value) { num_matches++; }
+    }
+    if (num_matches == configuration.size()) { return config_index; }
+    ++config_index;
+  }
+
+  // No match is found: this is an invalid configuration
+  return config_index;
+}
+
+// Tries a couple of random configurations first, which is fast if most of the search space is still
+// unexplored. Otherwise, scans for an unexplored configuration starting at a random position.
+size_t Searcher::RandomUnexplored(std::default_random_engine &generator) const {
+  if (configurations_.empty()) { return 0; }
+  auto distribution = std::uniform_int_distribution<size_t>(0, configurations_.size() - 1);
+  for (auto attempt=size_t{0}; attempt<kMaxRandomAttempts; ++attempt) {
+    const auto index = distribution(generator);
+    if (!Explored(index)) { return index; }
+  }
+  const auto offset = distribution(generator);
+  for (auto i=size_t{0}; i<configurations_.size(); ++i) {
+    const auto index = (offset + i) % configurations_.size();
+    if (!Explored(index)) { return index; }
+  }
+  return configurations_.size();
+}
+
+// Builds the neighbour index. Each configuration is encoded as a mixed-radix number (the key) of
+// the positions of its values within the sorted distinct values of each parameter.
+void Searcher::BuildNeighbourIndex() {
+  parameter_values_.clear();
+  strides_.clear();
+  keys_.clear();
+  key_to_index_.clear();
+  if (configurations_.empty()) { return; }
+
+  // Collects the distinct values of each parameter
+  const auto num_parameters = configurations_[0].size();
+  parameter_values_.resize(num_parameters);
+  for (auto p=size_t{0}; p<num_parameters; ++p) {
+    auto &values = parameter_values_[p];
+    for (auto &configuration: configurations_) { values.push_back(configuration[p].value); }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+  }
+
+  // Computes the strides (the last parameter changes fastest)
+  strides_.resize(num_parameters);
+  auto stride = size_t{1};
+  for (auto p=num_parameters; p>0; --p) {
+    strides_[p-1] = stride;
+    const auto num_values = parameter_values_[p-1].size();
+    if (stride > std::numeric_limits<size_t>::max() / num_values) {
+      throw std::runtime_error("Search space too large to be indexed");
+    }
+    stride *= num_values;
+  }
+
+  // Encodes all configurations
+  keys_.resize(configurations_.size());
+  key_to_index_.reserve(configurations_.size());
+  for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+    auto key = size_t{0};
+    for (auto p=size_t{0}; p<num_parameters; ++p) {
+      const auto &values = parameter_values_[p];
+      const auto value = std::lower_bound(values.begin(), values.end(), configurations_[c][p].value);
+      key += static_cast<size_t>(value - values.begin()) * strides_[p];
+    }
+    keys_[c] = key;
+    key_to_index_[key] = c;
+  }
+}
+
+// Replaces the position of one value in the key and looks up the resulting configuration
+size_t Searcher::NeighbourOf(const size_t index, const size_t parameter,
+                             const size_t value_index) const {
+  const auto current_value_index = ValueIndex(index, parameter);
+  const auto key = keys_[index] - current_value_index*strides_[parameter] +
+                   value_index*strides_[parameter];
+  const auto match = key_to_index_.find(key);
+  return (match == key_to_index_.end()) ? configurations_.size() : match->second;
+}
+
+// Tries all other values of the parameter and keeps those which are part of the search space
+std::vector<size_t> Searcher::NeighboursAlong(const size_t index, const size_t parameter) const {
+  auto neighbours = std::vector<size_t>();
+  const auto current_value_index = ValueIndex(index, parameter);
+  for (auto v=size_t{0}; v<NumValues(parameter); ++v) {
+    if (v == current_value_index) { continue; }
+    const auto neighbour = NeighbourOf(index, parameter, v);
+    if (neighbour < configurations_.size()) { neighbours.push_back(neighbour); }
+  }
+  return neighbours;
+}
+
 // =================================================================================================
 } // namespace cltune
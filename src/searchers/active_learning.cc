@@ -0,0 +1,204 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the ActiveLearning class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/active_learning.h"
+
+// The machine learning models
+#include "internal/model_selection.h"
+
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+namespace cltune {
+// =================================================================================================
+
+// Minimum number of successfully measured configurations to train a model on
+const size_t ActiveLearning::kMinTrainingSamples = size_t{4};
+
+// Re-training at each doubling keeps the total training cost linear in the amount of data
+const size_t ActiveLearning::kRetrainGrowthFactor = size_t{2};
+
+// Initializes the searcher and selects a random first batch
+ActiveLearning::ActiveLearning(const Configurations &configurations,
+                               const FeatureEncoder &encoder, const double fraction,
+                               const Model model_type, const size_t batch_size,
+                               const double exploration_fraction, const size_t num_folds,
+                               const unsigned int seed):
+    Searcher(configurations),
+    features_(),
+    fraction_(fraction),
+    model_type_(model_type),
+    batch_size_(std::max(size_t{1}, batch_size)),
+    exploration_fraction_(std::min(1.0, std::max(0.0, exploration_fraction))),
+    num_folds_(num_folds),
+    model_(),
+    num_trained_(0),
+    num_learned_(0),
+    batch_(),
+    batch_position_(0),
+    explored_(configurations.size(), false),
+    generator_(seed) {
+  if (configurations_.size() == 0) { return; }
+  features_.Resize(configurations_.size(), encoder.NumFeatures());
+  for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+    encoder.Encode(configurations_[c], features_.row(c));
+  }
+  auto selected = std::vector<bool>(configurations_.size(), false);
+  AddRandomToBatch(batch_size_, selected);
+  index_ = batch_[0];
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration ActiveLearning::GetConfiguration() {
+  return configurations_[index_];
+}
+
+// Moves to the next configuration of the batch. At the end of a batch, the model is re-trained to
+// select the next batch.
+void ActiveLearning::CalculateNextIndex() {
+  ++batch_position_;
+  if (batch_position_ >= batch_.size()) { NextBatch(); }
+  if (batch_.size() != 0) { index_ = batch_[batch_position_]; }
+}
+
+// The number of configurations is equal to all possible configurations times the fraction
+size_t ActiveLearning::NumConfigurations() {
+  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+}
+
+// Stores the execution time and marks the configuration as explored. A successful measurement is
+// learned by the model right away, if it supports incremental updates.
+void ActiveLearning::PushExecutionTime(const double execution_time) {
+  Searcher::PushExecutionTime(execution_time);
+  explored_[index_] = true;
+  if (!model_ || num_learned_ == 0) { return; }
+  if (execution_time <= 0.0 || execution_time >= std::numeric_limits<float>::max()) { return; }
+  const auto features = features_.row(index_);
+  const auto x = std::vector<float>(features, features + features_.cols());
+  if (model_->Update({x}, {static_cast<float>(execution_time)})) { ++num_learned_; }
+  else { num_learned_ = 0; }
+}
+
+// The warm-start configurations replace the random first batch (they count as part of it)
+void ActiveLearning::SetWarmStart(const Configurations &configurations) {
+  auto selected = std::vector<bool>(configurations_.size(), false);
+  batch_.clear();
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size() || selected[index]) { continue; }
+    selected[index] = true;
+    batch_.push_back(index);
+  }
+  if (batch_.size() < batch_size_) { AddRandomToBatch(batch_size_ - batch_.size(), selected); }
+  batch_position_ = 0;
+  if (batch_.size() != 0) { index_ = batch_[0]; }
+}
+
+// =================================================================================================
+
+// Trains the model on all successfully measured configurations (failed configurations are reported
+// with an execution time of at least the maximum float value) and predicts the execution times of
+// all unexplored configurations. The best of these make up the first part of the batch. If there
+// is too little data to train a model on, the whole batch is chosen randomly.
+void ActiveLearning::NextBatch() {
+  batch_.clear();
+  batch_position_ = 0;
+  auto selected = std::vector<bool>(configurations_.size(), false);
+
+  // Collects the training data
+  auto x_train = std::vector<std::vector<float>>();
+  auto y_train = std::vector<float>();
+  for (auto &explored_index: explored_indices_) {
+    const auto execution_time = execution_times_[explored_index];
+    if (execution_time <= 0.0 || execution_time >= std::numeric_limits<float>::max()) { continue; }
+    x_train.push_back(std::vector<float>(features_.row(explored_index),
+                                         features_.row(explored_index) + features_.cols()));
+    y_train.push_back(static_cast<float>(execution_time));
+  }
+
+  // Trains the model, using the same settings as for model prediction after tuning. These are
+  // selected by cross-validation if enabled (with fall-back to the defaults for too little data).
+  // An incrementally updated model which has learned all data is kept, unless the data has grown
+  // enough since it was last trained.
+  const auto num_random = static_cast<size_t>(std::round(batch_size_*exploration_fraction_));
+  if (x_train.size() >= kMinTrainingSamples && num_random < batch_size_) {
+    const auto up_to_date = (model_ && num_learned_ == x_train.size());
+    if (!up_to_date || x_train.size() >= kRetrainGrowthFactor*num_trained_) {
+      const auto settings = SelectModelSettings(model_type_, x_train, y_train, num_folds_,
+                                                generator_(), false);
+      model_ = CreateModel(settings, x_train[0].size(), false, generator_(),
+                           MLModel<float>::HardwareThreads());
+      model_->Train(x_train, y_train);
+      num_trained_ = x_train.size();
+      num_learned_ = x_train.size();
+    }
+
+    // Predicts all configurations at once and keeps the unexplored ones
+    const auto predicted_times = model_->PredictBatch(features_);
+    auto predictions = std::vector<std::pair<float,size_t>>();
+    for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+      if (explored_[c]) { continue; }
+      predictions.push_back(std::make_pair(predicted_times[c], c));
+    }
+
+    // Selects the best predicted configurations
+    const auto num_best = std::min(batch_size_ - num_random, predictions.size());
+    std::partial_sort(predictions.begin(), predictions.begin() + num_best, predictions.end());
+    for (auto i=size_t{0}; i<num_best; ++i) {
+      batch_.push_back(predictions[i].second);
+      selected[predictions[i].second] = true;
+    }
+  }
+
+  // Completes the batch with random configurations
+  AddRandomToBatch(batch_size_ - batch_.size(), selected);
+}
+
+// Draws random configurations out of those which are not explored and not selected yet. If all
+// configurations are explored, the batch stays empty.
+void ActiveLearning::AddRandomToBatch(const size_t num_configurations,
+                                      std::vector<bool> &selected) {
+  auto candidates = std::vector<size_t>();
+  for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+    if (!explored_[c] && !selected[c]) { candidates.push_back(c); }
+  }
+  for (auto i=size_t{0}; i<num_configurations && i<candidates.size(); ++i) {
+    auto distribution = std::uniform_int_distribution<size_t>(i, candidates.size() - 1);
+    std::swap(candidates[i], candidates[distribution(generator_)]);
+    batch_.push_back(candidates[i]);
+    selected[candidates[i]] = true;
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -44,7 +44,8 @@ const size_t Annealing::kMaxDifferences = size_t{3};
 // Initializes the simulated annealing searcher by specifying the fraction of the total search space
 // to consider and the maximum annealing 'temperature'.
 Annealing::Annealing(const Configurations &configurations,
-                     const double fraction, const double max_temperature):
+                     const double fraction, const double max_temperature,
+                     const unsigned int seed):
     Searcher(configurations),
     fraction_(fraction),
     max_temperature_(max_temperature),
@@ -52,8 +53,8 @@ Annealing::Annealing(const Configurations &configurations,
     current_state_(0),
     neighbour_state_(0),
     num_already_visisted_states_(0),
-    generator_(RandomSeed()),
-    int_distribution_(0, static_cast<int>(configurations_.size())),
+    generator_(seed),
+    int_distribution_(0, static_cast<int>(std::max(configurations_.size(), size_t{1})) - 1),
     probability_distribution_(0.0, 1.0) {
   auto random_initial_state = static_cast<size_t>(int_distribution_(generator_));
   current_state_ = random_initial_state;
@@ -120,12 +121,26 @@ size_t Annealing::NumConfigurations() {
 // =================================================================================================
 
 // Adds the resulting execution time to the back of the execution times vector. Also stores the
-// index value (to keep track of which indices are explored).
+// index value (to keep track of which indices are explored, in the order in which they are
+// proposed).
 void Annealing::PushExecutionTime(const double execution_time) {
-  explored_indices_.push_back(current_state_);
+  explored_indices_.push_back(index_);
   execution_times_[index_] = execution_time;
 }
 
+// Sets the initial state to the first (best) warm-start configuration which is part of the search
+// space. This replaces the random initial state.
+void Annealing::SetWarmStart(const Configurations &configurations) {
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    current_state_ = index;
+    neighbour_state_ = index;
+    index_ = index;
+    return;
+  }
+}
+
 // =================================================================================================
 
 // Retrieves the neighbours IDs of a configuration identified by a reference ID. This searches
@@ -161,11 +176,14 @@ std::vector<size_t> Annealing::GetNeighboursOf(const size_t reference_id) const
 // Computes the acceptance probablity P(e_current, e_neighbour, T) based on the Kirkpatrick et al.
 // method: if the new (neighbouring) energy is lower, always accept it. If it is higher, there is
 // a chance to accept it based on the energy difference and the current temperature (decreasing
-// over time).
+// over time). Failed states have an infinite energy (see Searcher::kFailureTime): moving from one
+// failed state to another is always accepted, as between any states of equal energy, and moving
+// from a successful state to a failed one never is. This avoids the NaN of infinity minus infinity.
 double Annealing::AcceptanceProbability(const double current_energy,
                                         const double neighbour_energy,
                                         const double temperature) const {
-  if (neighbour_energy < current_energy) { return 1.0; }
+  if (neighbour_energy <= current_energy) { return 1.0; }
+  if (std::isinf(neighbour_energy)) { return 0.0; }
   return exp( - (neighbour_energy - current_energy) / temperature);
 }
 
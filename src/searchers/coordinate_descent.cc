@@ -0,0 +1,122 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the CoordinateDescent class (see the header for information about the
+// class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/coordinate_descent.h"
+
+#include <limits>
+#include <algorithm>
+
+namespace cltune {
+// =================================================================================================
+
+// Builds the neighbour index and starts at a random configuration. The first sweep is along the
+// first parameter.
+CoordinateDescent::CoordinateDescent(const Configurations &configurations, const double fraction,
+                                     const unsigned int seed):
+    Searcher(configurations),
+    fraction_(fraction),
+    incumbent_(0),
+    parameter_(0),
+    sweep_(),
+    improved_(true),
+    sweeps_without_improvement_(0),
+    generator_(seed) {
+  BuildNeighbourIndex();
+  if (configurations_.size() == 0) { return; }
+  parameter_ = NumParameters() - 1;
+  incumbent_ = RandomUnexplored(generator_);
+  index_ = incumbent_;
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration CoordinateDescent::GetConfiguration() {
+  return configurations_[index_];
+}
+
+// Updates the incumbent with the last measurement and continues with the current sweep. Note that
+// a new incumbent differs from the old one only in the swept parameter, so the remainder of the
+// sweep still holds the other parameters at the incumbent's values. Once a sweep is done, the next
+// sweep is along the next parameter.
+void CoordinateDescent::CalculateNextIndex() {
+  if (execution_times_[index_] < execution_times_[incumbent_]) {
+    incumbent_ = index_;
+    improved_ = true;
+  }
+  while (true) {
+    while (!sweep_.empty()) {
+      const auto candidate = sweep_.back();
+      sweep_.pop_back();
+      if (!Explored(candidate)) {
+        index_ = candidate;
+        return;
+      }
+    }
+
+    // Converged: a full cycle over all parameters did not improve the incumbent. Restarts at a
+    // random unexplored configuration.
+    sweeps_without_improvement_ = (improved_) ? 0 : sweeps_without_improvement_ + 1;
+    improved_ = false;
+    if (sweeps_without_improvement_ >= NumParameters()) {
+      const auto restart_state = RandomUnexplored(generator_);
+      if (restart_state == configurations_.size()) { return; }
+      incumbent_ = restart_state;
+      index_ = restart_state;
+      improved_ = true;
+      sweeps_without_improvement_ = 0;
+      return;
+    }
+
+    // Starts the sweep along the next parameter
+    parameter_ = (parameter_ + 1) % NumParameters();
+    sweep_ = NeighboursAlong(incumbent_, parameter_);
+    std::reverse(sweep_.begin(), sweep_.end());
+  }
+}
+
+// The number of configurations is equal to all possible configurations times the fraction
+size_t CoordinateDescent::NumConfigurations() {
+  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+}
+
+// Sets the incumbent to the first (best) warm-start configuration which is part of the search
+// space. This replaces the random initial state.
+void CoordinateDescent::SetWarmStart(const Configurations &configurations) {
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    incumbent_ = index;
+    index_ = index;
+    return;
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,282 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the DifferentialEvolution class (see the header for information about the
+// class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/differential_evolution.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace cltune {
+// =================================================================================================
+
+// Minimum population size for creating trial vectors out of three other members
+const size_t DifferentialEvolution::kMinPopulationSize = size_t{4};
+
+// Encodes all configurations and selects a random initial population, which is the first batch
+DifferentialEvolution::DifferentialEvolution(const Configurations &configurations,
+                                             const Parameters &parameters, const double fraction,
+                                             const size_t population_size,
+                                             const double differential_weight,
+                                             const double crossover_rate,
+                                             const unsigned int seed):
+    Searcher(configurations),
+    fraction_(fraction),
+    population_size_(std::min(std::max(population_size, kMinPopulationSize),
+                              configurations.size())),
+    differential_weight_(differential_weight),
+    crossover_rate_(crossover_rate),
+    num_parameters_(parameters.size()),
+    positions_(configurations.size()*parameters.size()),
+    num_values_(parameters.size()),
+    key_strides_(parameters.size()),
+    sorted_keys_(),
+    sorted_indices_(),
+    population_(),
+    batch_(),
+    batch_position_(0),
+    initial_generation_(true),
+    generator_(seed),
+    probability_distribution_(0.0, 1.0) {
+
+  // Stores the position of each value within the list of values of its parameter
+  for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+    for (auto p=size_t{0}; p<num_parameters_; ++p) {
+      const auto &values = parameters[p].values;
+      const auto value = std::find(values.begin(), values.end(), configurations_[c][p].value);
+      positions_[c*num_parameters_ + p] = static_cast<size_t>(value - values.begin());
+    }
+  }
+
+  // Encodes the positions as keys and sorts them
+  auto stride = size_t{1};
+  for (auto p=num_parameters_; p>0; --p) {
+    num_values_[p-1] = std::max(size_t{1}, parameters[p-1].values.size());
+    key_strides_[p-1] = stride;
+    if (stride > std::numeric_limits<size_t>::max() / num_values_[p-1]) {
+      throw std::runtime_error("Search space too large to be indexed");
+    }
+    stride *= num_values_[p-1];
+  }
+  auto keys = std::vector<std::pair<size_t,size_t>>(configurations_.size());
+  for (auto c=size_t{0}; c<configurations_.size(); ++c) {
+    auto key = size_t{0};
+    for (auto p=size_t{0}; p<num_parameters_; ++p) {
+      key += positions_[c*num_parameters_ + p] * key_strides_[p];
+    }
+    keys[c] = {key, c};
+  }
+  std::sort(keys.begin(), keys.end());
+  for (auto &key: keys) {
+    sorted_keys_.push_back(key.first);
+    sorted_indices_.push_back(key.second);
+  }
+
+  // Draws the initial population
+  auto indices = std::vector<size_t>(configurations_.size());
+  for (auto c=size_t{0}; c<indices.size(); ++c) { indices[c] = c; }
+  std::shuffle(indices.begin(), indices.end(), generator_);
+  population_.assign(indices.begin(), indices.begin() + population_size_);
+  batch_ = population_;
+  if (batch_.size() != 0) { index_ = batch_[0]; }
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration DifferentialEvolution::GetConfiguration() {
+  return configurations_[index_];
+}
+
+// Moves to the next configuration of the batch. At the end of a batch (a generation), the
+// selection takes place and the trials of the next generation are created.
+void DifferentialEvolution::CalculateNextIndex() {
+  ++batch_position_;
+  if (batch_position_ >= batch_.size()) {
+    Select();
+    NextGeneration();
+  }
+  if (batch_.size() != 0) { index_ = batch_[batch_position_]; }
+}
+
+// The number of configurations is equal to all possible configurations times the fraction
+size_t DifferentialEvolution::NumConfigurations() {
+  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+}
+
+// The warm-start configurations replace the first members of the initial population
+void DifferentialEvolution::SetWarmStart(const Configurations &configurations) {
+  auto member = size_t{0};
+  for (auto &configuration: configurations) {
+    if (member == population_.size()) { break; }
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    if (std::find(population_.begin(), population_.begin() + member, index) !=
+        population_.begin() + member) { continue; }
+    const auto duplicate = std::find(population_.begin() + member, population_.end(), index);
+    if (duplicate != population_.end()) { std::swap(*duplicate, population_[member]); }
+    else { population_[member] = index; }
+    ++member;
+  }
+  batch_ = population_;
+  batch_position_ = 0;
+  if (batch_.size() != 0) { index_ = batch_[0]; }
+}
+
+// =================================================================================================
+
+// After the initial generation, the batch holds the trial of each member of the population (unless
+// the population is too small for trials, see below)
+void DifferentialEvolution::Select() {
+  if (initial_generation_) {
+    initial_generation_ = false;
+    return;
+  }
+  if (!HasTrials()) { return; }
+  for (auto i=size_t{0}; i<batch_.size(); ++i) {
+    if (execution_times_[batch_[i]] < execution_times_[population_[i]]) {
+      population_[i] = batch_[i];
+    }
+  }
+}
+
+// Creates a trial vector per member: a mutant out of three other random members, crossed over with
+// the member itself. At least one dimension is taken from the mutant. A population which is too
+// small for trials (in a search space of fewer than kMinPopulationSize configurations) is followed
+// by a random unexplored configuration instead, or by the population itself once all are explored.
+void DifferentialEvolution::NextGeneration() {
+  batch_.clear();
+  batch_position_ = 0;
+  if (!HasTrials()) {
+    const auto index = RandomUnexplored(generator_);
+    if (index < configurations_.size()) { batch_.push_back(index); }
+    else { batch_ = population_; }
+    return;
+  }
+  auto member_distribution = std::uniform_int_distribution<size_t>(0, population_.size() - 1);
+  auto parameter_distribution = std::uniform_int_distribution<size_t>(0, num_parameters_ - 1);
+  for (auto i=size_t{0}; i<population_.size(); ++i) {
+
+    // Selects three distinct other members
+    auto a = i, b = i, c = i;
+    while (a == i) { a = member_distribution(generator_); }
+    while (b == i || b == a) { b = member_distribution(generator_); }
+    while (c == i || c == a || c == b) { c = member_distribution(generator_); }
+    const auto pa = &positions_[population_[a]*num_parameters_];
+    const auto pb = &positions_[population_[b]*num_parameters_];
+    const auto pc = &positions_[population_[c]*num_parameters_];
+    const auto pi = &positions_[population_[i]*num_parameters_];
+
+    // Mutation and binomial crossover
+    auto trial = std::vector<double>(num_parameters_);
+    const auto forced_parameter = parameter_distribution(generator_);
+    for (auto p=size_t{0}; p<num_parameters_; ++p) {
+      if (p == forced_parameter || probability_distribution_(generator_) < crossover_rate_) {
+        trial[p] = static_cast<double>(pa[p]) + differential_weight_ *
+                   (static_cast<double>(pb[p]) - static_cast<double>(pc[p]));
+      }
+      else {
+        trial[p] = static_cast<double>(pi[p]);
+      }
+    }
+
+    // Adds the nearest valid configuration to the batch
+    batch_.push_back(Snap(trial));
+  }
+}
+
+// Searches for the nearest new configuration first. Only if there is none left, the nearest
+// explored or batched configuration is taken.
+size_t DifferentialEvolution::Snap(const std::vector<double> &positions) const {
+  auto best_index = configurations_.size();
+  auto best_distance = std::numeric_limits<double>::max();
+  SnapParameter(positions, 0, 0, sorted_keys_.size(), 0, 0.0, true, best_index, best_distance);
+  if (best_index == configurations_.size()) {
+    SnapParameter(positions, 0, 0, sorted_keys_.size(), 0, 0.0, false, best_index, best_distance);
+  }
+  return best_index;
+}
+
+// The keys in [begin, end) share the positions of the parameters before 'parameter', which make up
+// 'key_prefix' at a squared distance 'distance'. The values of this parameter are visited in order
+// of increasing distance, such that the search can stop at the first value which is too far.
+void DifferentialEvolution::SnapParameter(const std::vector<double> &positions,
+                                          const size_t parameter, const size_t begin,
+                                          const size_t end, const size_t key_prefix,
+                                          const double distance, const bool only_new,
+                                          size_t &best_index, double &best_distance) const {
+  if (parameter == num_parameters_) {
+    const auto index = sorted_indices_[begin];
+    const auto in_batch = std::find(batch_.begin(), batch_.end(), index) != batch_.end();
+    if (only_new && (Explored(index) || in_batch)) { return; }
+    best_index = index;
+    best_distance = distance;
+    return;
+  }
+
+  // Starts at the nearest value and moves outwards to whichever side is nearer
+  const auto target = positions[parameter];
+  const auto max_position = static_cast<double>(num_values_[parameter] - 1);
+  const auto nearest = static_cast<size_t>(std::round(std::min(std::max(target, 0.0),
+                                                               max_position)));
+  auto lower = nearest;  // The next value below is at 'lower - 1'
+  auto upper = nearest;  // The next value is at 'upper'
+  while (lower > 0 || upper < num_values_[parameter]) {
+    const auto lower_distance = target - static_cast<double>(lower) + 1.0;
+    const auto upper_distance = static_cast<double>(upper) - target;
+    auto position = size_t{0};
+    if (upper == num_values_[parameter] || (lower > 0 && lower_distance < upper_distance)) {
+      position = --lower;
+    }
+    else {
+      position = upper++;
+    }
+    const auto difference = target - static_cast<double>(position);
+    const auto new_distance = distance + difference*difference;
+    if (new_distance >= best_distance) { break; }
+
+    // Finds the range of keys with this value and continues with the next parameter
+    const auto stride = key_strides_[parameter];
+    const auto first_key = key_prefix + position*stride;
+    const auto range_begin = std::lower_bound(sorted_keys_.begin() + begin,
+                                              sorted_keys_.begin() + end, first_key);
+    const auto range_end = std::lower_bound(range_begin, sorted_keys_.begin() + end,
+                                            first_key + stride);
+    if (range_begin == range_end) { continue; }
+    SnapParameter(positions, parameter + 1,
+                  static_cast<size_t>(range_begin - sorted_keys_.begin()),
+                  static_cast<size_t>(range_end - sorted_keys_.begin()), first_key, new_distance,
+                  only_new, best_index, best_distance);
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -0,0 +1,114 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the HillClimbing class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/hill_climbing.h"
+
+#include <limits>
+#include <algorithm>
+
+namespace cltune {
+// =================================================================================================
+
+// Builds the neighbour index and starts at a random configuration
+HillClimbing::HillClimbing(const Configurations &configurations, const double fraction,
+                           const unsigned int seed):
+    Searcher(configurations),
+    fraction_(fraction),
+    current_state_(0),
+    neighbours_(),
+    generator_(seed) {
+  BuildNeighbourIndex();
+  if (configurations_.size() == 0) { return; }
+  current_state_ = RandomUnexplored(generator_);
+  index_ = current_state_;
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration HillClimbing::GetConfiguration() {
+  return configurations_[index_];
+}
+
+// Moves to the last measured configuration if it is an improvement (or if it is the start of a new
+// climb) and continues with the next unexplored neighbour. Restarts if there are no neighbours left.
+void HillClimbing::CalculateNextIndex() {
+  if (index_ == current_state_ || execution_times_[index_] < execution_times_[current_state_]) {
+    current_state_ = index_;
+    SetNeighbours();
+  }
+  while (!neighbours_.empty()) {
+    const auto neighbour = neighbours_.back();
+    neighbours_.pop_back();
+    if (!Explored(neighbour)) {
+      index_ = neighbour;
+      return;
+    }
+  }
+
+  // A local optimum is reached: restarts at a random unexplored configuration
+  const auto restart_state = RandomUnexplored(generator_);
+  if (restart_state == configurations_.size()) { return; }
+  current_state_ = restart_state;
+  index_ = restart_state;
+}
+
+// The number of configurations is equal to all possible configurations times the fraction
+size_t HillClimbing::NumConfigurations() {
+  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+}
+
+// Sets the initial state to the first (best) warm-start configuration which is part of the search
+// space. This replaces the random initial state.
+void HillClimbing::SetWarmStart(const Configurations &configurations) {
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    current_state_ = index;
+    index_ = index;
+    return;
+  }
+}
+
+// =================================================================================================
+
+// The neighbours along all parameters, shuffled such that none of the parameters is preferred
+void HillClimbing::SetNeighbours() {
+  neighbours_.clear();
+  for (auto p=size_t{0}; p<NumParameters(); ++p) {
+    for (auto &neighbour: NeighboursAlong(current_state_, p)) {
+      if (!Explored(neighbour)) {
+        neighbours_.push_back(neighbour);
+      }
+    }
+  }
+  std::shuffle(neighbours_.begin(), neighbours_.end(), generator_);
+}
+
+// =================================================================================================
+} // namespace cltune
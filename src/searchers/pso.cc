@@ -37,7 +37,7 @@ namespace cltune {
 // Initializes the PSO searcher
 PSO::PSO(const Configurations &configurations, const Parameters &parameters,
          const double fraction, const size_t swarm_size, const double influence_global,
-         const double influence_local, const double influence_random):
+         const double influence_local, const double influence_random, const unsigned int seed):
     Searcher(configurations),
     fraction_(fraction),
     swarm_size_(swarm_size),
@@ -51,8 +51,8 @@ PSO::PSO(const Configurations &configurations, const Parameters &parameters,
     global_best_config_(),
     local_best_configs_(swarm_size_),
     parameters_(parameters),
-    generator_(RandomSeed()),
-    int_distribution_(0, static_cast<int>(configurations_.size())),
+    generator_(seed),
+    int_distribution_(0, static_cast<int>(std::max(configurations_.size(), size_t{1})) - 1),
     probability_distribution_(0.0, 1.0) {
   for (auto &position: particle_positions_) {
     position = static_cast<size_t>(int_distribution_(generator_));
@@ -91,7 +91,7 @@ void PSO::CalculateNextIndex() {
       }
       // Move in a random direction
       else if (probability_distribution_(generator_) <= influence_random_) {
-        std::uniform_int_distribution<size_t> distribution(0, parameters_[i].values.size());
+        std::uniform_int_distribution<size_t> distribution(0, parameters_[i].values.size() - 1);
         next_configuration[i].value = parameters_[i].values[distribution(generator_)];
       }
       // Else: stay at current location
@@ -130,21 +130,18 @@ void PSO::PushExecutionTime(const double execution_time) {
 
 // =================================================================================================
 
-// Searches all configuration to find which configuration is the 'target' (argument to this
-// function). The target's index in the total configuration vector is returned.
-size_t PSO::IndexFromConfiguration(const KernelInfo::Configuration target) const {
-  auto config_index = size_t{0};
-  for (auto &configuration: configurations_) {
-    auto num_matches = size_t{0};
-    for (auto i=size_t{0}; i<configuration.size(); ++i) {
-      if (configuration[i].value == target[i].value) { num_matches++; }
-    }
-    if (num_matches == configuration.size()) { return config_index; }
-    ++config_index;
+// Places the particles at the warm-start configurations (best first). Remaining particles keep
+// their random initial positions.
+void PSO::SetWarmStart(const Configurations &configurations) {
+  auto particle = size_t{0};
+  for (auto &configuration: configurations) {
+    if (particle == swarm_size_) { break; }
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    particle_positions_[particle] = index;
+    ++particle;
   }
-
-  // No match is found: this is an invalid configuration
-  return config_index;
+  index_ = particle_positions_[particle_index_];
 }
 
 // =================================================================================================
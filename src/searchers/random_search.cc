@@ -30,16 +30,65 @@
 
 #include <algorithm>
 #include <random>
+#include <limits>
 
 namespace cltune {
 // =================================================================================================
 
+// Number of mixing rounds of the format-preserving permutation used in sampling mode
+const size_t RandomSearch::kPermutationRounds = size_t{4};
+
 // Randomizes the configurations list
-RandomSearch::RandomSearch(const Configurations &configurations, const double fraction):
+RandomSearch::RandomSearch(const Configurations &configurations, const double fraction,
+                           const unsigned int seed):
     Searcher(configurations),
-    fraction_(fraction) {
-  std::srand(RandomSeed());
-  std::random_shuffle(configurations_.begin(), configurations_.end());
+    fraction_(fraction),
+    kernel_(nullptr),
+    num_raw_configurations_(0),
+    num_samples_(0),
+    counter_(0),
+    mask_(0),
+    shift_(0),
+    keys_(),
+    multipliers_(),
+    warm_start_indices_() {
+  std::default_random_engine generator(seed);
+  std::shuffle(configurations_.begin(), configurations_.end(), generator);
+}
+
+// Sampling mode: the list of configurations starts empty and is filled one sample at a time. This
+// sets up a random permutation of the unconstrained search space and draws the first sample.
+RandomSearch::RandomSearch(KernelInfo &kernel, const double fraction, const unsigned int seed):
+    Searcher(Configurations{}),
+    fraction_(fraction),
+    kernel_(&kernel),
+    num_raw_configurations_(kernel.NumRawConfigurations()),
+    num_samples_(0),
+    counter_(0),
+    mask_(0),
+    shift_(0),
+    keys_(kPermutationRounds),
+    multipliers_(kPermutationRounds),
+    warm_start_indices_() {
+  if (num_raw_configurations_ == 0) { return; }
+  num_samples_ = std::max(size_t{1}, static_cast<size_t>(num_raw_configurations_*fraction_));
+
+  // Finds the smallest power-of-two domain which holds the whole search space
+  auto num_bits = 1u;
+  while (num_bits < 64 && (1ULL << num_bits) < num_raw_configurations_) { ++num_bits; }
+  mask_ = (num_bits == 64) ? std::numeric_limits<unsigned long long>::max() : (1ULL << num_bits) - 1;
+  shift_ = num_bits/2 + 1;
+
+  // Sets the random keys of the permutation. Multipliers have to be odd to be invertible.
+  std::default_random_engine generator(seed);
+  std::uniform_int_distribution<unsigned long long> distribution;
+  for (auto r=size_t{0}; r<kPermutationRounds; ++r) {
+    keys_[r] = distribution(generator) & mask_;
+    multipliers_[r] = (distribution(generator) | 1ULL) & mask_;
+  }
+
+  // Draws the first sample: if there is none, there is nothing to explore
+  if (!DrawSample()) { num_samples_ = 0; }
 }
 
 // =================================================================================================
@@ -49,15 +98,92 @@ KernelInfo::Configuration RandomSearch::GetConfiguration() {
   return configurations_[index_];
 }
 
-// Calculates the index of the next configuration to test
+// Calculates the index of the next configuration to test. In sampling mode, this draws a new
+// sample. If the search space is exhausted before the requested number of samples is reached, the
+// number of configurations is lowered to the number of samples drawn so far.
 void RandomSearch::CalculateNextIndex() {
-  ++index_;
+  if (kernel_ == nullptr) {
+    ++index_;
+    return;
+  }
+  if (index_ + 1 < configurations_.size()) {
+    ++index_;
+    return;
+  }
+  if (configurations_.size() >= num_samples_) { return; }
+  if (DrawSample()) {
+    index_ = configurations_.size() - 1;
+  }
+  else {
+    num_samples_ = configurations_.size();
+  }
 }
 
 // The number of configurations is equal to all possible configurations
 size_t RandomSearch::NumConfigurations() {
+  if (kernel_ != nullptr) { return num_samples_; }
   return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
 }
 
+// In sampling mode, the warm-start configurations replace the start of the list of samples drawn so
+// far. They count as samples, but the total is raised if there are more of them than requested.
+void RandomSearch::SetWarmStart(const Configurations &configurations) {
+  if (kernel_ == nullptr) {
+    Searcher::SetWarmStart(configurations);
+    return;
+  }
+  auto samples = Configurations{};
+  for (auto &configuration: configurations) {
+    const auto raw_index = kernel_->IndexFromConfiguration(configuration);
+    if (raw_index >= num_raw_configurations_) { continue; }
+    if (!warm_start_indices_.insert(raw_index).second) { continue; }
+    samples.push_back(kernel_->ConfigurationFromIndex(raw_index));
+  }
+  for (auto &configuration: configurations_) {
+    if (warm_start_indices_.count(kernel_->IndexFromConfiguration(configuration)) == 0) {
+      samples.push_back(configuration);
+    }
+  }
+  configurations_ = samples;
+  execution_times_.assign(configurations_.size(), std::numeric_limits<double>::max());
+  num_samples_ = std::max(num_samples_, configurations_.size());
+  index_ = 0;
+}
+
+// =================================================================================================
+
+// Walks through the permutation of the search space until a valid configuration is found. Invalid
+// configurations (according to the constraints and device limits) are skipped and not counted, and
+// so are configurations which were already explored as part of the warm-start.
+bool RandomSearch::DrawSample() {
+  while (counter_ < num_raw_configurations_) {
+    const auto raw_index = Permute(counter_);
+    ++counter_;
+    if (warm_start_indices_.count(raw_index) != 0) { continue; }
+    auto configuration = kernel_->ConfigurationFromIndex(raw_index);
+    if (kernel_->ValidConfiguration(configuration)) {
+      configurations_.push_back(configuration);
+      execution_times_.push_back(std::numeric_limits<double>::max());
+      return true;
+    }
+  }
+  return false;
+}
+
+// Each round (add a key, multiply by an odd number, xor-shift) is a bijection on the power-of-two
+// domain. Results outside of the search space are permuted again (cycle-walking), which keeps the
+// mapping a bijection on the search space itself.
+size_t RandomSearch::Permute(const size_t counter) const {
+  auto value = static_cast<unsigned long long>(counter);
+  do {
+    for (auto r=size_t{0}; r<kPermutationRounds; ++r) {
+      value = (value + keys_[r]) & mask_;
+      value = (value * multipliers_[r]) & mask_;
+      value ^= value >> shift_;
+    }
+  } while (value >= num_raw_configurations_);
+  return static_cast<size_t>(value);
+}
+
 // =================================================================================================
 } // namespace cltune
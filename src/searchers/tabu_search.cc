@@ -0,0 +1,182 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the TabuSearch class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/searchers/tabu_search.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace cltune {
+// =================================================================================================
+
+// Maximum number of successive moves without anything new to measure
+const size_t TabuSearch::kMaxMovesWithoutMeasurement = size_t{16};
+
+// Builds the neighbour index, creates an empty tabu list, and starts at a random configuration
+TabuSearch::TabuSearch(const Configurations &configurations, const double fraction,
+                       const size_t tabu_tenure, const size_t neighbourhood_size,
+                       const unsigned int seed):
+    Searcher(configurations),
+    fraction_(fraction),
+    tabu_tenure_(tabu_tenure),
+    neighbourhood_size_(std::max(size_t{1}, neighbourhood_size)),
+    current_state_(0),
+    best_time_(std::numeric_limits<double>::max()),
+    aspiration_time_(std::numeric_limits<double>::max()),
+    neighbourhood_measured_(false),
+    batch_(),
+    batch_position_(0),
+    iteration_(0),
+    tabu_until_(),
+    generator_(seed) {
+  BuildNeighbourIndex();
+  for (auto p=size_t{0}; p<NumParameters(); ++p) {
+    tabu_until_.push_back(std::vector<size_t>(NumValues(p), 0));
+  }
+  if (configurations_.size() == 0) { return; }
+  current_state_ = RandomUnexplored(generator_);
+  batch_ = {current_state_};
+  index_ = current_state_;
+}
+
+// =================================================================================================
+
+// Returns the next configuration
+KernelInfo::Configuration TabuSearch::GetConfiguration() {
+  return configurations_[index_];
+}
+
+// Moves to the next configuration of the batch or creates a new batch
+void TabuSearch::CalculateNextIndex() {
+  ++batch_position_;
+  if (batch_position_ >= batch_.size()) { NextBatch(); }
+  if (batch_position_ < batch_.size()) { index_ = batch_[batch_position_]; }
+}
+
+// The number of configurations is equal to all possible configurations times the fraction
+size_t TabuSearch::NumConfigurations() {
+  return std::max(size_t{1}, static_cast<size_t>(configurations_.size()*fraction_));
+}
+
+// Also keeps track of the best execution time (for the aspiration criterion)
+void TabuSearch::PushExecutionTime(const double execution_time) {
+  Searcher::PushExecutionTime(execution_time);
+  best_time_ = std::min(best_time_, execution_time);
+}
+
+// Sets the current state to the first (best) warm-start configuration which is part of the search
+// space. This replaces the random initial state.
+void TabuSearch::SetWarmStart(const Configurations &configurations) {
+  for (auto &configuration: configurations) {
+    const auto index = IndexFromConfiguration(configuration);
+    if (index >= configurations_.size()) { continue; }
+    current_state_ = index;
+    batch_ = {current_state_};
+    batch_position_ = 0;
+    index_ = index;
+    return;
+  }
+}
+
+// =================================================================================================
+
+// Measures the neighbourhood of the current state first, including the neighbours which are tabu
+// such that the aspiration criterion can apply to them. Moves can lead to a state of which the
+// whole neighbourhood is measured already, in which case the search moves on without measuring. To
+// guarantee progress, the search restarts after too many of such moves (or if it cannot move).
+void TabuSearch::NextBatch() {
+  batch_.clear();
+  batch_position_ = 0;
+  for (auto move=size_t{0}; move<kMaxMovesWithoutMeasurement; ++move) {
+    if (!neighbourhood_measured_) {
+      neighbourhood_measured_ = true;
+      aspiration_time_ = best_time_;
+      for (auto p=size_t{0}; p<NumParameters(); ++p) {
+        for (auto &neighbour: NeighboursAlong(current_state_, p)) {
+          if (!Explored(neighbour)) { batch_.push_back(neighbour); }
+        }
+      }
+      std::shuffle(batch_.begin(), batch_.end(), generator_);
+      if (batch_.size() > neighbourhood_size_) { batch_.resize(neighbourhood_size_); }
+      if (!batch_.empty()) { return; }
+    }
+    if (!Move()) { break; }
+    neighbourhood_measured_ = false;
+  }
+
+  // Restarts at a random unexplored configuration
+  const auto restart_state = RandomUnexplored(generator_);
+  if (restart_state == configurations_.size()) { return; }
+  current_state_ = restart_state;
+  neighbourhood_measured_ = false;
+  batch_ = {restart_state};
+}
+
+// Considers all measured neighbours (also those of earlier iterations). A tabu neighbour is only
+// admissible if it is faster than the best time before the neighbourhood was measured (aspiration).
+// Failed configurations are reported with an execution time of at least the maximum float value
+// and are never moved to.
+bool TabuSearch::Move() {
+  auto best_neighbour = configurations_.size();
+  auto best_neighbour_time = static_cast<double>(std::numeric_limits<float>::max());
+  for (auto p=size_t{0}; p<NumParameters(); ++p) {
+    for (auto &neighbour: NeighboursAlong(current_state_, p)) {
+      const auto time = execution_times_[neighbour];
+      if (time >= best_neighbour_time) { continue; }
+      if (IsTabu(neighbour) && time >= aspiration_time_) { continue; }
+      best_neighbour = neighbour;
+      best_neighbour_time = time;
+    }
+  }
+  if (best_neighbour == configurations_.size()) { return false; }
+
+  // Makes the values which are left behind tabu
+  ++iteration_;
+  for (auto p=size_t{0}; p<NumParameters(); ++p) {
+    const auto value_index = ValueIndex(current_state_, p);
+    if (value_index != ValueIndex(best_neighbour, p)) {
+      tabu_until_[p][value_index] = iteration_ + tabu_tenure_;
+    }
+  }
+  current_state_ = best_neighbour;
+  return true;
+}
+
+// Checks the values of the changed parameters against the tabu list
+bool TabuSearch::IsTabu(const size_t neighbour) const {
+  for (auto p=size_t{0}; p<NumParameters(); ++p) {
+    const auto value_index = ValueIndex(neighbour, p);
+    if (value_index != ValueIndex(current_state_, p) && tabu_until_[p][value_index] > iteration_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -33,10 +33,19 @@
 #include "internal/searchers/random_search.h"
 #include "internal/searchers/annealing.h"
 #include "internal/searchers/pso.h"
+#include "internal/searchers/active_learning.h"
+#include "internal/searchers/hill_climbing.h"
+#include "internal/searchers/coordinate_descent.h"
+#include "internal/searchers/differential_evolution.h"
+#include "internal/searchers/tabu_search.h"
 
-// The machine learning models
-#include "internal/ml_models/linear_regression.h"
-#include "internal/ml_models/neural_network.h"
+// The machine learning models and their features
+#include "internal/feature_encoder.h"
+#include "internal/model_selection.h"
+#include "internal/model_ensemble.h"
+
+// The receivers of the results
+#include "internal/result_sinks.h"
 
 #include <sstream> // std::stringstream
 #include <fstream> // std::ifstream
@@ -46,6 +55,10 @@
 #include <memory> // std::unique_ptr
 #include <tuple> // std::tuple
 #include <cstdlib> // std::getenv
+#include <cmath> // std::ceil
+#include <cctype> // std::isspace
+#include <numeric> // std::iota
+#include <random> // std::default_random_engine
 
 namespace cltune {
 // =================================================================================================
@@ -53,6 +66,16 @@ namespace cltune {
 // This is the threshold for 'correctness'
 const double TunerImpl::kMaxL2Norm = 1e-4;
 
+// Finalists are only considered faster or slower than each other below this p-value
+const double TunerImpl::kFinalistSignificance = 0.05;
+
+// A warning is printed once the control configuration is this much slower or faster than at first
+const double TunerImpl::kMaxDrift = 0.1;
+
+// The first line of a saved model, including the version of the format
+const std::string TunerImpl::kModelFileHeader = "CLTune model 3";
+const std::string TunerImpl::kSearchLogKernelPrefix = "kernel;";
+
 // Messages printed to stdout (in colours)
 const std::string TunerImpl::kMessageFull    = "\x1b[32m[==========]\x1b[0m";
 const std::string TunerImpl::kMessageHead    = "\x1b[32m[----------]\x1b[0m";
@@ -78,9 +101,42 @@ TunerImpl::TunerImpl(const size_t platform_id, const size_t device_id):
     suppress_output_(false),
     output_search_process_(false),
     search_log_filename_(std::string{}),
+    max_tuning_time_(0.0),
+    max_evaluations_(0),
+    early_stopping_evaluations_(0),
+    early_stopping_improvement_(0.0),
+    tuning_start_time_(),
+    tuning_time_(0.0),
+    num_evaluations_(0),
+    stop_reason_(std::string{}),
     search_method_(SearchMethod::FullSearch),
     search_args_(0),
-    argument_counter_(0) {
+    has_seed_(false),
+    seed_(0),
+    replay_filename_(std::string{}),
+    failure_threshold_(0.9),
+    warm_start_results_(),
+    warm_start_count_(0),
+    imported_results_(),
+    result_cache_(),
+    num_finalists_(0),
+    num_finalist_rounds_(0),
+    finalist_results_(),
+    drift_interval_(0),
+    drift_normalize_(false),
+    num_folds_(0),
+    num_ensemble_models_(1),
+    acquisition_(Acquisition::kMean),
+    acquisition_kappa_(1.0),
+    models_(),
+    argument_counter_(0),
+    result_callback_(),
+    result_sink_files_(),
+    result_sinks_(),
+    retain_results_(true),
+    best_result_{std::string{}, std::numeric_limits<float>::max(), 0, false,
+                 KernelInfo::Configuration{}, Outcome::kSuccess, 1.0f},
+    finalist_candidates_() {
   if (!suppress_output_) {
     fprintf(stdout, "\n%s Initializing on platform %zu device %zu\n",
             kMessageFull.c_str(), platform_id, device_id);
@@ -112,6 +168,10 @@ TunerImpl::~TunerImpl() {
   for (auto &mem_argument: arguments_input_) { free_buffers(mem_argument); }
   for (auto &mem_argument: arguments_output_) { free_buffers(mem_argument); }
   for (auto &mem_argument: arguments_output_copy_) { free_buffers(mem_argument); }
+  for (auto &level: fidelity_levels_) {
+    for (auto &mem_argument: level.arguments_input) { free_buffers(mem_argument); }
+    for (auto &mem_argument: level.arguments_output) { free_buffers(mem_argument); }
+  }
 
   if (!suppress_output_) {
     fprintf(stdout, "\n%s End of the tuning process\n\n", kMessageFull.c_str());
@@ -123,9 +183,28 @@ TunerImpl::~TunerImpl() {
 // Starts the tuning process. First, the reference kernel is run if it exists (output results are
 // automatically verified with respect to this reference run). Next, all permutations of all tuning-
 // parameters are computed for each kernel and those kernels are run. Their timing-results are
-// collected and stored into the tuning_results_ vector.
+// collected and stored into the tuning_results_ vector (see StoreResult). The process stops early in
+// case the tuning budget is exhausted.
 void TunerImpl::Tune() {
 
+  // Starts the clock of the tuning budget
+  tuning_start_time_ = std::chrono::steady_clock::now();
+  num_evaluations_ = 0;
+  stop_reason_ = "completed";
+  finalist_results_.clear();
+  OpenResultSinks();
+  BuildResultCache();
+
+  // Sets the seed of the search methods. Without a user-supplied seed, this is based on the time. It
+  // is printed such that the search can be repeated.
+  if (!has_seed_) {
+    const auto time_seed = std::chrono::system_clock::now().time_since_epoch().count();
+    seed_ = static_cast<unsigned int>(time_seed);
+  }
+  if (!suppress_output_) {
+    fprintf(stdout, "\n%s Random seed of the search: %u\n", kMessageInfo.c_str(), seed_);
+  }
+
   // Runs the reference kernel if it is defined
   if (has_reference_) {
     PrintHeader("Testing reference "+reference_kernel_->name());
@@ -133,9 +212,16 @@ void TunerImpl::Tune() {
     StoreReferenceOutput();
   }
   
+  // The search log holds one section per kernel: the first kernel starts a new file, the others
+  // append to it
+  auto search_log_mode = "w";
+
   // Iterates over all tunable kernels
-  for (auto &kernel: kernels_) {
+  for (auto kernel_id=size_t{0}; kernel_id<kernels_.size(); ++kernel_id) {
+    auto &kernel = kernels_[kernel_id];
+    if (BudgetExhausted(0)) { break; }
     PrintHeader("Testing kernel "+kernel.name());
+    finalist_candidates_.clear();
 
     // If there are no tuning parameters, simply run the kernel and store the results
     if (kernel.parameters().size() == 0) {
@@ -143,45 +229,111 @@ void TunerImpl::Tune() {
         // Compiles and runs the kernel
       auto tuning_result = RunKernel(kernel.source(), kernel, 0, 1);
       tuning_result.status = VerifyOutput();
+      ++num_evaluations_;
 
       // Stores the result of the tuning
-      tuning_results_.push_back(tuning_result);
+      StoreResult(tuning_result);
 
     // Else: there are tuning parameters to iterate over
     } else {
 
-      // Computes the permutations of all parameters and pass them to a (smart) search algorithm
-      #ifdef VERBOSE
-        fprintf(stdout, "%s Computing the permutations of all parameters\n", kMessageVerbose.c_str());
-      #endif
-      kernel.SetConfigurations();
+      // Computes the permutations of all parameters and pass them to a (smart) search algorithm. This
+      // is not needed when sampling, since configurations are then drawn one-by-one, nor when
+      // replaying, since configurations are then read from a search log.
+      if (search_method_ != SearchMethod::RandomSampling && search_method_ != SearchMethod::Replay) {
+        #ifdef VERBOSE
+          fprintf(stdout, "%s Computing the permutations of all parameters\n", kMessageVerbose.c_str());
+        #endif
+        kernel.SetConfigurations();
+      }
 
       // Creates the selected search algorithm
       std::unique_ptr<Searcher> search;
+      const auto seed = seed_ + static_cast<unsigned int>(kernel_id);
       switch (search_method_) {
         case SearchMethod::FullSearch:
           search.reset(new FullSearch{kernel.configurations()});
           break;
         case SearchMethod::RandomSearch:
-          search.reset(new RandomSearch{kernel.configurations(), search_args_[0]});
+          search.reset(new RandomSearch{kernel.configurations(), search_args_[0], seed});
+          break;
+        case SearchMethod::RandomSampling:
+          search.reset(new RandomSearch{kernel, search_args_[0], seed});
           break;
         case SearchMethod::Annealing:
-          search.reset(new Annealing{kernel.configurations(), search_args_[0], search_args_[1]});
+          search.reset(new Annealing{kernel.configurations(), search_args_[0], search_args_[1],
+                                     seed});
           break;
         case SearchMethod::PSO:
           search.reset(new PSO{kernel.configurations(), kernel.parameters(), search_args_[0],
                                static_cast<size_t>(search_args_[1]), search_args_[2],
-                               search_args_[3], search_args_[4]});
+                               search_args_[3], search_args_[4], seed});
+          break;
+        case SearchMethod::ActiveLearning:
+          search.reset(new ActiveLearning{kernel.configurations(), FeatureEncoder(kernel),
+                                          search_args_[0],
+                                          static_cast<Model>(static_cast<int>(search_args_[1])),
+                                          static_cast<size_t>(search_args_[2]), search_args_[3],
+                                          num_folds_, seed});
+          break;
+        case SearchMethod::HillClimbing:
+          search.reset(new HillClimbing{kernel.configurations(), search_args_[0], seed});
+          break;
+        case SearchMethod::CoordinateDescent:
+          search.reset(new CoordinateDescent{kernel.configurations(), search_args_[0], seed});
+          break;
+        case SearchMethod::DifferentialEvolution:
+          search.reset(new DifferentialEvolution{kernel.configurations(), kernel.parameters(),
+                                                 search_args_[0],
+                                                 static_cast<size_t>(search_args_[1]),
+                                                 search_args_[2], search_args_[3], seed});
+          break;
+        case SearchMethod::TabuSearch:
+          search.reset(new TabuSearch{kernel.configurations(), search_args_[0],
+                                      static_cast<size_t>(search_args_[1]),
+                                      static_cast<size_t>(search_args_[2]), seed});
+          break;
+        case SearchMethod::Replay:
+          search.reset(new FullSearch{LoadSearchLog(kernel)});
           break;
       }
 
+      // Seeds the search with the best configurations of earlier tuning sessions (if any). A replay
+      // follows the search log exactly, so it is not seeded.
+      if (search_method_ != SearchMethod::Replay) {
+        const auto warm_start = WarmStartConfigurations(kernel);
+        if (warm_start.size() != 0) { search->SetWarmStart(warm_start); }
+      }
+
       // Iterates over all possible configurations (the permutations of the tuning parameters)
+      const auto first_result = tuning_results_.size();
+      auto best_time = std::numeric_limits<double>::max();
+      auto evaluations_without_improvement = size_t{0};
+      auto candidates = std::vector<TunerResult>();
+      auto control = KernelInfo::Configuration{};
+      auto control_time = 0.0f;
+      auto drift = 1.0f;
+      auto evaluations_since_control = size_t{0};
       for (auto p=size_t{0}; p<search->NumConfigurations(); ++p) {
+        if (BudgetExhausted(evaluations_without_improvement)) { break; }
         #ifdef VERBOSE
           fprintf(stdout, "%s Exploring configuration (%zu out of %zu):\n", kMessageVerbose.c_str(),
                   p + 1, search->NumConfigurations());
         #endif
         auto permutation = search->GetConfiguration();
+
+        // Skips configurations which are likely to fail to compile or launch, as predicted from the
+        // failures so far. Full search and replay measure all their configurations.
+        if (search_method_ != SearchMethod::FullSearch && search_method_ != SearchMethod::Replay &&
+            search->FailureProbability() > failure_threshold_) {
+          if (!suppress_output_) {
+            fprintf(stdout, "%s Skipping a configuration which is likely to fail (%zu out of %zu)\n",
+                    kMessageInfo.c_str(), p + 1, search->NumConfigurations());
+          }
+          search->PushOutcome(Outcome::kPredictedFailure, 0.0);
+          search->CalculateNextIndex();
+          continue;
+        }
         #ifdef VERBOSE
           fprintf(stdout, "%s ", kMessageVerbose.c_str());
           for (auto &config: permutation) {
@@ -190,190 +342,637 @@ void TunerImpl::Tune() {
           fprintf(stdout, "\n");
         #endif
 
-
-        // Adds the parameters to the source-code string as defines
-        auto source = std::string{};
-        for (auto &config: permutation) {
-          source += config.GetDefine();
+        // Compiles and runs the kernel, unless its result is known from the imported results. In
+        // case of multi-fidelity tuning, this is the first (lowest) fidelity level and the results
+        // are only candidates for promotion to the next level. Known results are of the full
+        // problem, so these skip the fidelity levels.
+        const auto num_configurations = search->NumConfigurations();
+        const auto known_result = FindCachedResult(kernel, permutation);
+        const auto is_known = (known_result != nullptr);
+        auto tuning_result = (is_known) ?
+                             KnownResult(*known_result, permutation, p, num_configurations) :
+                             (fidelity_levels_.size() == 0) ?
+                             RunConfiguration(kernel, permutation, p, num_configurations) :
+                             RunConfigurationAtFidelity(kernel, kernel_id, 0, permutation, p,
+                                                        num_configurations);
+
+        // Annotates the result with the drift measured by the latest control run (if any). A known
+        // result keeps the drift (and normalization) of the session in which it was measured.
+        if (!is_known) {
+          tuning_result.drift = drift;
+          if (drift_normalize_ && tuning_result.status) { tuning_result.time /= drift; }
         }
-        source += kernel.source();
-
-        // Updates the local range with the parameter values
-        kernel.ComputeRanges(permutation);
-
-        // Compiles and runs the kernel
-        auto tuning_result = RunKernel(source, kernel, p, search->NumConfigurations());
-        tuning_result.status = VerifyOutput();
 
-        // Gives timing feedback to the search algorithm and calculates the next index
-        search->PushExecutionTime(tuning_result.time);
+        // Gives feedback (the outcome and the timing) to the search algorithm and calculates the next
+        // index
+        search->PushOutcome(tuning_result.outcome, tuning_result.time);
         search->CalculateNextIndex();
 
         // Stores the parameters and the timing-result
-        tuning_result.configuration = permutation;
-        if (tuning_result.time == std::numeric_limits<float>::max()) {
-          tuning_result.time = 0.0;
-          PrintResult(stdout, tuning_result, kMessageFailure);
-          tuning_result.time = std::numeric_limits<float>::max();
-          tuning_result.status = false;
+        if (fidelity_levels_.size() == 0 || is_known) { StoreResult(tuning_result); }
+        else { candidates.push_back(tuning_result); }
+
+        // Keeps track of the budget: counts evaluations (runs on the device, not known results) and
+        // whether this one improved the best time
+        if (!is_known) { ++num_evaluations_; }
+        const auto improvement_factor = 1.0 - early_stopping_improvement_/100.0;
+        if (tuning_result.status && tuning_result.time < best_time*improvement_factor) {
+          best_time = tuning_result.time;
+          evaluations_without_improvement = 0;
+        }
+        else {
+          ++evaluations_without_improvement;
         }
-        else if (!tuning_result.status) {
-          PrintResult(stdout, tuning_result, kMessageWarning);
+
+        // Drift compensation: the first successfully measured configuration is the control. It is
+        // measured again periodically, its time relative to the first measurement is the drift of
+        // the device. Known results were measured in another session, so they don't count here.
+        if (drift_interval_ != 0 && fidelity_levels_.size() == 0 && !is_known) {
+          if (control.size() == 0) {
+            if (tuning_result.status) {
+              control = tuning_result.configuration;
+              control_time = tuning_result.time * tuning_result.drift;
+            }
+          }
+          else if (++evaluations_since_control == drift_interval_) {
+            evaluations_since_control = 0;
+            const auto time = RunControl(kernel, control);
+            if (time != std::numeric_limits<float>::max()) { drift = time / control_time; }
+            if (!suppress_output_) {
+              fprintf(stdout, "%s Drift of the control configuration: %.3lf\n",
+                      (std::fabs(drift - 1.0) > kMaxDrift) ? kMessageWarning.c_str() :
+                                                             kMessageInfo.c_str(), drift);
+            }
+          }
         }
-        tuning_results_.push_back(tuning_result);
       }
 
       // Prints a log of the searching process. This is disabled per default, but can be enabled
       // using the "OutputSearchLog" function.
       if (output_search_process_) {
-        auto file = fopen(search_log_filename_.c_str(), "w");
+        auto file = fopen(search_log_filename_.c_str(), search_log_mode);
+        if (file == nullptr) {
+          throw std::runtime_error("Could not open search log: "+search_log_filename_);
+        }
+        fprintf(file, "%s%s\n", kSearchLogKernelPrefix.c_str(), kernel.name().c_str());
         search->PrintLog(file);
         fclose(file);
+        search_log_mode = "a";
+      }
+
+      // Multi-fidelity tuning: promotes the best candidates level by level up to the full problem
+      if (fidelity_levels_.size() != 0) {
+        SuccessiveHalving(kernel, kernel_id, candidates);
+      }
+
+      // Re-measures the best configurations to select a robust best result
+      if (num_finalists_ != 0) {
+        if (retain_results_) {
+          RunFinalists(kernel, std::vector<TunerResult>(tuning_results_.begin() + first_result,
+                                                        tuning_results_.end()));
+        }
+        else {
+          RunFinalists(kernel, finalist_candidates_);
+        }
       }
     }
   }
+
+  // Reports the usage of the tuning budget
+  tuning_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - tuning_start_time_).count();
+  PrintBudgetUsage();
+
+  // Writes the results which the sinks may still have buffered
+  for (auto &sink: result_sinks_) { sink->Flush(); }
 }
 
 // =================================================================================================
 
-// Compiles the kernel and checks for error messages, sets all output buffers to zero,
-// launches the kernel, and collects the timing information.
-TunerImpl::TunerResult TunerImpl::RunKernel(const std::string &source, const KernelInfo &kernel,
-                                            const size_t configuration_id,
-                                            const size_t num_configurations) {
+// Checks the wall-clock time and the number of evaluations against the budget. These stop the whole
+// tuning process. The lack of improvement is counted per kernel and stops only the current search.
+// The stop-reason is the first criterion which stopped a search, such that an early stop of one
+// kernel is still reported after the next kernels are tuned.
+bool TunerImpl::BudgetExhausted(const size_t evaluations_without_improvement) {
+  const auto elapsed_time = std::chrono::steady_clock::now() - tuning_start_time_;
+  const auto elapsed_seconds = std::chrono::duration<double>(elapsed_time).count();
+  auto reason = std::string{};
+  if (max_tuning_time_ > 0.0 && elapsed_seconds >= max_tuning_time_) {
+    reason = "time budget exhausted";
+  }
+  else if (max_evaluations_ > 0 && num_evaluations_ >= max_evaluations_) {
+    reason = "evaluation budget exhausted";
+  }
+  else if (early_stopping_evaluations_ > 0 &&
+           evaluations_without_improvement >= early_stopping_evaluations_) {
+    reason = "no improvement in "+std::to_string(evaluations_without_improvement)+" evaluations";
+  }
+  if (reason.empty()) { return false; }
+  if (stop_reason_ == "completed") { stop_reason_ = reason; }
+  if (!suppress_output_) {
+    fprintf(stdout, "%s Stopping the search: %s\n", kMessageInfo.c_str(), reason.c_str());
+  }
+  return true;
+}
 
-  // In case of an exception, skip this run
-  try {
-    #ifdef VERBOSE
-      fprintf(stdout, "%s Starting compilation\n", kMessageVerbose.c_str());
-    #endif
+// Prints the used wall-clock time and evaluations, compared to the budget (if any)
+void TunerImpl::PrintBudgetUsage() const {
+  if (suppress_output_) { return; }
+  PrintHeader("Tuning budget usage");
+  if (max_tuning_time_ > 0.0) {
+    fprintf(stdout, "%s Wall-clock time: %.1lf out of %.1lf s\n", kMessageInfo.c_str(),
+            tuning_time_, max_tuning_time_);
+  }
+  else {
+    fprintf(stdout, "%s Wall-clock time: %.1lf s\n", kMessageInfo.c_str(), tuning_time_);
+  }
+  if (max_evaluations_ > 0) {
+    fprintf(stdout, "%s Evaluations: %zu out of %zu\n", kMessageInfo.c_str(),
+            num_evaluations_, max_evaluations_);
+  }
+  else {
+    fprintf(stdout, "%s Evaluations: %zu\n", kMessageInfo.c_str(), num_evaluations_);
+  }
+  fprintf(stdout, "%s Stop reason: %s\n", kMessageInfo.c_str(), stop_reason_.c_str());
+}
+
+// =================================================================================================
+
+// Compiles and runs a single configuration of a kernel at the full problem size and verifies its
+// output against the reference. Failures are printed and marked as such in the result.
+TunerImpl::TunerResult TunerImpl::RunConfiguration(KernelInfo &kernel,
+                                                   const KernelInfo::Configuration &configuration,
+                                                   const size_t configuration_id,
+                                                   const size_t num_configurations) {
+
+  // Answers from the imported results if the configuration is known, without touching the device
+  const auto known_result = FindCachedResult(kernel, configuration);
+  if (known_result != nullptr) {
+    return KnownResult(*known_result, configuration, configuration_id, num_configurations);
+  }
+
+  // Adds the parameters to the source-code string as defines
+  auto source = std::string{};
+  for (auto &config: configuration) {
+    source += config.GetDefine();
+  }
+  source += kernel.source();
+
+  // Updates the local range with the parameter values
+  kernel.ComputeRanges(configuration);
+
+  // Compiles and runs the kernel
+  auto tuning_result = RunKernel(source, kernel, configuration_id, num_configurations);
+  tuning_result.status = VerifyOutput();
+
+  // Stores the parameters and the timing-result
+  tuning_result.configuration = configuration;
+  if (tuning_result.time == std::numeric_limits<float>::max()) {
+    tuning_result.time = 0.0;
+    PrintResult(stdout, tuning_result, kMessageFailure);
+    tuning_result.time = std::numeric_limits<float>::max();
+    tuning_result.status = false;
+  }
+  else if (!tuning_result.status) {
+    tuning_result.outcome = Outcome::kVerificationFailure;
+    PrintResult(stdout, tuning_result, kMessageWarning);
+  }
+  return tuning_result;
+}
+
+// The known result is taken as is, only with the configuration in the order of the current
+// parameters
+TunerImpl::TunerResult TunerImpl::KnownResult(const TunerResult &known_result,
+                                              const KernelInfo::Configuration &configuration,
+                                              const size_t configuration_id,
+                                              const size_t num_configurations) const {
+  auto tuning_result = known_result;
+  tuning_result.configuration = configuration;
+  if (!suppress_output_) {
+    fprintf(stdout, "%s Known configuration (%zu out of %zu), taken from the imported results\n",
+            kMessageInfo.c_str(), configuration_id + 1, num_configurations);
+    auto printed_result = tuning_result;
+    if (printed_result.time == std::numeric_limits<float>::max()) { printed_result.time = 0.0; }
+    PrintResult(stdout, printed_result, (tuning_result.status) ? kMessageOK : kMessageFailure);
+  }
+  return tuning_result;
+}
+
+// As above, but now at a lower fidelity level: the arguments, global size, and number of runs of
+// the level are swapped in temporarily. The output is not verified, since the reference output is
+// only available for the full problem. Thus, only failing kernels are marked as such.
+TunerImpl::TunerResult TunerImpl::RunConfigurationAtFidelity(KernelInfo &kernel,
+                                                             const size_t kernel_id,
+                                                             const size_t level,
+                                                             const KernelInfo::Configuration &configuration,
+                                                             const size_t configuration_id,
+                                                             const size_t num_configurations) {
+  auto source = std::string{};
+  for (auto &config: configuration) {
+    source += config.GetDefine();
+  }
+  source += kernel.source();
+
+  // Runs the kernel with the settings of the fidelity level
+  SwapFidelityLevel(fidelity_levels_[level], kernel, kernel_id);
+  kernel.ComputeRanges(configuration);
+  auto tuning_result = RunKernel(source, kernel, configuration_id, num_configurations);
+  SwapFidelityLevel(fidelity_levels_[level], kernel, kernel_id);
+
+  // Stores the parameters and the timing-result
+  tuning_result.configuration = configuration;
+  tuning_result.status = (tuning_result.time != std::numeric_limits<float>::max());
+  if (!tuning_result.status) {
+    tuning_result.time = 0.0;
+    PrintResult(stdout, tuning_result, kMessageFailure);
+    tuning_result.time = std::numeric_limits<float>::max();
+  }
+  return tuning_result;
+}
 
-     // Sets the build options from an environmental variable (if set)
-    auto options = std::vector<std::string>();
-    const auto environment_variable = std::getenv("CLTUNE_BUILD_OPTIONS");
-    if (environment_variable != nullptr) {
-      options.push_back(std::string(environment_variable));
+// Swaps the number of runs, the kernel arguments (if the level has its own), and the global size of
+// the kernel (if the level overrides it) with those of a fidelity level. Calling this function a
+// second time restores the original settings.
+void TunerImpl::SwapFidelityLevel(FidelityLevel &level, KernelInfo &kernel, const size_t kernel_id) {
+  std::swap(num_runs_, level.num_runs);
+  if (level.argument_counter != 0) {
+    std::swap(arguments_input_, level.arguments_input);
+    std::swap(arguments_output_, level.arguments_output);
+    std::swap(arguments_int_, level.arguments_int);
+    std::swap(arguments_size_t_, level.arguments_size_t);
+    std::swap(arguments_float_, level.arguments_float);
+    std::swap(arguments_double_, level.arguments_double);
+    std::swap(arguments_float2_, level.arguments_float2);
+    std::swap(arguments_double2_, level.arguments_double2);
+  }
+  for (auto &global_size: level.global_sizes) {
+    if (global_size.first == kernel_id) {
+      const auto global_base = kernel.global_base();
+      kernel.set_global_base(global_size.second);
+      global_size.second = global_base;
+    }
+  }
+}
+
+// Successive halving: the candidates are measured at the lowest fidelity level. Per level, only the
+// best fraction of the successfully measured candidates is promoted and measured again at the next
+// level. The last level is the full problem: those results are verified and stored as the final
+// tuning results. The budget is checked in between, but at least one candidate is always measured
+// at the full problem size.
+void TunerImpl::SuccessiveHalving(KernelInfo &kernel, const size_t kernel_id,
+                                  std::vector<TunerResult> &candidates) {
+  const auto num_levels = fidelity_levels_.size();
+  for (auto level=size_t{0}; level<num_levels; ++level) {
+
+    // Sorts the successful candidates by execution time and selects the ones to promote
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [](const TunerResult &result) { return !result.status; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(),
+              [](const TunerResult &a, const TunerResult &b) { return a.time < b.time; });
+    const auto fraction = fidelity_levels_[level].promote_fraction;
+    const auto num_promoted = std::min(candidates.size(), std::max(size_t{1},
+      static_cast<size_t>(std::ceil(static_cast<double>(candidates.size())*fraction))));
+    candidates.resize(num_promoted);
+    if (candidates.size() == 0) { return; }
+
+    // Measures the promoted candidates at the next level
+    const auto next_level = level + 1;
+    const auto is_full_problem = (next_level == num_levels);
+    PrintHeader("Promoting "+std::to_string(num_promoted)+" configuration(s) to "+
+                ((is_full_problem) ? "the full problem" : "fidelity level "+std::to_string(next_level)));
+    auto promoted = std::vector<TunerResult>();
+    for (auto c=size_t{0}; c<candidates.size(); ++c) {
+      if (c > 0 && BudgetExhausted(0)) { break; }
+      const auto &configuration = candidates[c].configuration;
+      if (is_full_problem) {
+        StoreResult(RunConfiguration(kernel, configuration, c, num_promoted));
+      }
+      else {
+        promoted.push_back(RunConfigurationAtFidelity(kernel, kernel_id, next_level, configuration,
+                                                      c, num_promoted));
+      }
+      ++num_evaluations_;
     }
+    candidates = promoted;
+  }
+}
+
+// =================================================================================================
+
+// Measures the control configuration for drift compensation. This is not counted as an evaluation.
+float TunerImpl::RunControl(KernelInfo &kernel, const KernelInfo::Configuration &control) {
+  auto source = std::string{};
+  for (auto &config: control) {
+    source += config.GetDefine();
+  }
+  source += kernel.source();
+  kernel.ComputeRanges(control);
+  return RunKernel(source, kernel, 0, 1).time;
+}
+
+// =================================================================================================
 
-    // Compiles the kernel and prints the compiler errors/warnings
-    auto program = Program(context_, source);
-    auto build_status = program.Build(device_, options);
-    if (build_status == BuildStatus::kError) {
-      auto message = program.GetBuildInfo(device_);
-      fprintf(stdout, "device compiler error/warning: %s\n", message.c_str());
-      throw std::runtime_error("device compiler error/warning occurred ^^\n");
+// Finalist stage: the fastest successful results of a kernel are measured again in a number of
+// rounds. Within a round, the finalists are run in a random order, such that drift of the device
+// (e.g. clock throttling or other users) affects all of them alike. Each run yields one sample. A
+// finalist scores a point for every other finalist it is significantly faster than (according to
+// the Mann-Whitney U test) and loses one for every finalist it is significantly slower than. The
+// finalist with the highest score is the robust best result of the kernel; ties are broken by the
+// median time. This is not limited by the tuning budget.
+void TunerImpl::RunFinalists(KernelInfo &kernel, std::vector<TunerResult> finalists) {
+
+  // Selects the finalists among the successful results of this kernel
+  finalists.erase(std::remove_if(finalists.begin(), finalists.end(),
+                                 [](const TunerResult &result) { return !result.status; }),
+                  finalists.end());
+  std::sort(finalists.begin(), finalists.end(),
+            [](const TunerResult &a, const TunerResult &b) { return a.time < b.time; });
+  if (finalists.size() > num_finalists_) { finalists.resize(num_finalists_); }
+  if (finalists.size() == 0) { return; }
+  if (finalists.size() == 1) { finalist_results_.push_back(finalists[0]); return; }
+
+  // Compiles each finalist once. A finalist which fails to compile gets no samples.
+  const auto num_finalists = finalists.size();
+  const auto num_runs = num_finalists*num_finalist_rounds_;
+  PrintHeader("Re-measuring "+std::to_string(num_finalists)+" finalists in "+
+              std::to_string(num_finalist_rounds_)+" rounds");
+  auto compiled_kernels = std::vector<std::unique_ptr<Kernel>>(num_finalists);
+  for (auto i=size_t{0}; i<num_finalists; ++i) {
+    auto source = std::string{};
+    for (auto &config: finalists[i].configuration) {
+      source += config.GetDefine();
     }
-    if (build_status == BuildStatus::kInvalid) {
-      throw std::runtime_error("Invalid program binary");
+    source += kernel.source();
+    try {
+      auto program = BuildProgram(source);
+      compiled_kernels[i] = std::unique_ptr<Kernel>(new Kernel(program, kernel.name()));
     }
-    #ifdef VERBOSE
-      fprintf(stdout, "%s Finished compilation\n", kMessageVerbose.c_str());
-    #endif
+    catch(std::exception& e) {
+      FailedResult(kernel, Outcome::kCompileFailure, e);
+    }
+  }
 
-    // Clears all previous copies of output buffer(s)
-    for (auto &mem_info: arguments_output_copy_) {
-      #ifdef USE_OPENCL
-        CheckError(clReleaseMemObject(mem_info.buffer));
-      #else
-        CheckError(cuMemFree(mem_info.buffer));
-      #endif
+  // Measures the finalists round by round in a random order, only re-launching the compiled kernels
+  auto samples = std::vector<std::vector<float>>(num_finalists);
+  auto order = std::vector<size_t>(num_finalists);
+  std::iota(order.begin(), order.end(), 0);
+  auto generator = std::default_random_engine(seed_);
+  for (auto round=size_t{0}; round<num_finalist_rounds_; ++round) {
+    std::shuffle(order.begin(), order.end(), generator);
+    for (auto i=size_t{0}; i<num_finalists; ++i) {
+      if (!compiled_kernels[order[i]]) { continue; }
+      kernel.ComputeRanges(finalists[order[i]].configuration);
+      try {
+        const auto result = LaunchKernel(*compiled_kernels[order[i]], kernel,
+                                         round*num_finalists + i, num_runs);
+        samples[order[i]].push_back(result.time);
+      }
+      catch(std::exception& e) {
+        FailedResult(kernel, Outcome::kLaunchFailure, e);
+      }
     }
-    arguments_output_copy_.clear();
+  }
 
-    // Creates a copy of the output buffer(s)
-    #ifdef VERBOSE
-      fprintf(stdout, "%s Creating a copy of the output buffer\n", kMessageVerbose.c_str());
+  // Scores the finalists by pairwise tests. Finalists which failed in a round are ranked last.
+  auto scores = std::vector<int>(num_finalists, 0);
+  auto medians = std::vector<float>(num_finalists);
+  auto complete = std::vector<bool>(num_finalists);
+  for (auto i=size_t{0}; i<num_finalists; ++i) {
+    medians[i] = Median(samples[i]);
+    complete[i] = (samples[i].size() == num_finalist_rounds_);
+  }
+  for (auto i=size_t{0}; i<num_finalists; ++i) {
+    for (auto j=i+1; j<num_finalists; ++j) {
+      if (samples[i].size() == 0 || samples[j].size() == 0) { continue; }
+      if (MannWhitneyPValue(samples[i], samples[j]) >= kFinalistSignificance) { continue; }
+      const auto i_faster = (medians[i] < medians[j]) ? 1 : -1;
+      scores[i] += i_faster;
+      scores[j] -= i_faster;
+    }
+  }
+
+  // Ranks the finalists and stores the winner with its median time
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) -> bool {
+    if (complete[a] != complete[b]) { return complete[a]; }
+    return (scores[a] != scores[b]) ? scores[a] > scores[b] : medians[a] < medians[b];
+  });
+  PrintHeader("Ranking of the finalists (median time)");
+  for (auto &i: order) {
+    auto result = finalists[i];
+    result.time = medians[i];
+    PrintResult(stdout, result, kMessageResult);
+  }
+  auto winner = finalists[order[0]];
+  winner.time = medians[order[0]];
+  if (!suppress_output_) {
+    fprintf(stdout, "%s Selected the finalist with a score of %d (significantly faster minus slower)\n",
+            kMessageInfo.c_str(), scores[order[0]]);
+  }
+  if (complete[order[0]]) { finalist_results_.push_back(winner); }
+  else { finalist_results_.push_back(finalists[0]); }
+}
+
+// Two-sided p-value of the Mann-Whitney U test, using the normal approximation with a correction for
+// ties and for continuity. The samples are ranked jointly, with tied values getting their mean rank.
+double TunerImpl::MannWhitneyPValue(const std::vector<float> &a, const std::vector<float> &b) {
+  auto values = std::vector<std::pair<float,bool>>();
+  for (auto &value: a) { values.push_back({value, true}); }
+  for (auto &value: b) { values.push_back({value, false}); }
+  std::sort(values.begin(), values.end());
+  const auto n = static_cast<double>(values.size());
+  auto rank_sum_a = 0.0;
+  auto tie_correction = 0.0;
+  for (auto i=size_t{0}; i<values.size(); ) {
+    auto j = i;
+    while (j < values.size() && values[j].first == values[i].first) { ++j; }
+    const auto mean_rank = (static_cast<double>(i + j) + 1.0) / 2.0;
+    for (auto k=i; k<j; ++k) {
+      if (values[k].second) { rank_sum_a += mean_rank; }
+    }
+    const auto num_ties = static_cast<double>(j - i);
+    tie_correction += num_ties*num_ties*num_ties - num_ties;
+    i = j;
+  }
+  const auto n_a = static_cast<double>(a.size());
+  const auto n_b = static_cast<double>(b.size());
+  const auto u_a = rank_sum_a - n_a*(n_a + 1.0)/2.0;
+  const auto mean = n_a*n_b/2.0;
+  const auto variance = n_a*n_b/12.0 * ((n + 1.0) - tie_correction/(n*(n - 1.0)));
+  if (variance <= 0.0) { return 1.0; }
+  const auto z = std::max(0.0, std::fabs(u_a - mean) - 0.5) / std::sqrt(variance);
+  return std::erfc(z / std::sqrt(2.0));
+}
+
+// Returns the median of a set of samples (or the maximum float if there are none)
+float TunerImpl::Median(std::vector<float> samples) {
+  if (samples.size() == 0) { return std::numeric_limits<float>::max(); }
+  std::sort(samples.begin(), samples.end());
+  const auto middle = samples.size() / 2;
+  if (samples.size() % 2 == 1) { return samples[middle]; }
+  return (samples[middle - 1] + samples[middle]) / 2.0f;
+}
+
+// =================================================================================================
+
+// Compiles and launches the kernel (see BuildProgram and LaunchKernel). In case of an exception,
+// the run is skipped and the outcome records how far the run got.
+TunerImpl::TunerResult TunerImpl::RunKernel(const std::string &source, const KernelInfo &kernel,
+                                            const size_t configuration_id,
+                                            const size_t num_configurations) {
+  auto outcome = Outcome::kCompileFailure;
+  try {
+    auto program = BuildProgram(source);
+    outcome = Outcome::kLaunchFailure;
+    auto tune_kernel = Kernel(program, kernel.name());
+    return LaunchKernel(tune_kernel, kernel, configuration_id, num_configurations);
+  }
+  catch(std::exception& e) {
+    return FailedResult(kernel, outcome, e);
+  }
+}
+
+// Compiles the kernel and checks for error messages
+Program TunerImpl::BuildProgram(const std::string &source) {
+  #ifdef VERBOSE
+    fprintf(stdout, "%s Starting compilation\n", kMessageVerbose.c_str());
+  #endif
+
+  // Sets the build options from an environmental variable (if set)
+  auto options = std::vector<std::string>();
+  const auto environment_variable = std::getenv("CLTUNE_BUILD_OPTIONS");
+  if (environment_variable != nullptr) {
+    options.push_back(std::string(environment_variable));
+  }
+
+  // Compiles the kernel and prints the compiler errors/warnings
+  auto program = Program(context_, source);
+  auto build_status = program.Build(device_, options);
+  if (build_status == BuildStatus::kError) {
+    auto message = program.GetBuildInfo(device_);
+    fprintf(stdout, "device compiler error/warning: %s\n", message.c_str());
+    throw std::runtime_error("device compiler error/warning occurred ^^\n");
+  }
+  if (build_status == BuildStatus::kInvalid) {
+    throw std::runtime_error("Invalid program binary");
+  }
+  #ifdef VERBOSE
+    fprintf(stdout, "%s Finished compilation\n", kMessageVerbose.c_str());
+  #endif
+  return program;
+}
+
+// Sets all output buffers to zero, sets the arguments of the compiled kernel, launches it, and
+// collects the timing information. The thread-sizes are those of the last call to ComputeRanges.
+TunerImpl::TunerResult TunerImpl::LaunchKernel(Kernel &tune_kernel, const KernelInfo &kernel,
+                                               const size_t configuration_id,
+                                               const size_t num_configurations) {
+
+  // Clears all previous copies of output buffer(s)
+  for (auto &mem_info: arguments_output_copy_) {
+    #ifdef USE_OPENCL
+      CheckError(clReleaseMemObject(mem_info.buffer));
+    #else
+      CheckError(cuMemFree(mem_info.buffer));
     #endif
-    for (auto &output: arguments_output_) {
-      switch (output.type) {
-        case MemType::kShort: arguments_output_copy_.push_back(CopyOutputBuffer<short>(output)); break;
-        case MemType::kInt: arguments_output_copy_.push_back(CopyOutputBuffer<int>(output)); break;
-        case MemType::kSizeT: arguments_output_copy_.push_back(CopyOutputBuffer<size_t>(output)); break;
-        case MemType::kHalf: arguments_output_copy_.push_back(CopyOutputBuffer<half>(output)); break;
-        case MemType::kFloat: arguments_output_copy_.push_back(CopyOutputBuffer<float>(output)); break;
-        case MemType::kDouble: arguments_output_copy_.push_back(CopyOutputBuffer<double>(output)); break;
-        case MemType::kFloat2: arguments_output_copy_.push_back(CopyOutputBuffer<float2>(output)); break;
-        case MemType::kDouble2: arguments_output_copy_.push_back(CopyOutputBuffer<double2>(output)); break;
-        default: throw std::runtime_error("Unsupported reference output data-type");
-      }
+  }
+  arguments_output_copy_.clear();
+
+  // Creates a copy of the output buffer(s)
+  #ifdef VERBOSE
+    fprintf(stdout, "%s Creating a copy of the output buffer\n", kMessageVerbose.c_str());
+  #endif
+  for (auto &output: arguments_output_) {
+    switch (output.type) {
+      case MemType::kShort: arguments_output_copy_.push_back(CopyOutputBuffer<short>(output)); break;
+      case MemType::kInt: arguments_output_copy_.push_back(CopyOutputBuffer<int>(output)); break;
+      case MemType::kSizeT: arguments_output_copy_.push_back(CopyOutputBuffer<size_t>(output)); break;
+      case MemType::kHalf: arguments_output_copy_.push_back(CopyOutputBuffer<half>(output)); break;
+      case MemType::kFloat: arguments_output_copy_.push_back(CopyOutputBuffer<float>(output)); break;
+      case MemType::kDouble: arguments_output_copy_.push_back(CopyOutputBuffer<double>(output)); break;
+      case MemType::kFloat2: arguments_output_copy_.push_back(CopyOutputBuffer<float2>(output)); break;
+      case MemType::kDouble2: arguments_output_copy_.push_back(CopyOutputBuffer<double2>(output)); break;
+      default: throw std::runtime_error("Unsupported reference output data-type");
     }
+  }
+
+  // Sets the kernel arguments
+  #ifdef VERBOSE
+    fprintf(stdout, "%s Setting kernel arguments\n", kMessageVerbose.c_str());
+  #endif
+  for (auto &i: arguments_input_) { tune_kernel.SetArgument(i.index, i.buffer); }
+  for (auto &i: arguments_output_copy_) { tune_kernel.SetArgument(i.index, i.buffer); }
+  for (auto &i: arguments_int_) { tune_kernel.SetArgument(i.first, i.second); }
+  for (auto &i: arguments_size_t_) { tune_kernel.SetArgument(i.first, i.second); }
+  for (auto &i: arguments_float_) { tune_kernel.SetArgument(i.first, i.second); }
+  for (auto &i: arguments_double_) { tune_kernel.SetArgument(i.first, i.second); }
+  for (auto &i: arguments_float2_) { tune_kernel.SetArgument(i.first, i.second); }
+  for (auto &i: arguments_double2_) { tune_kernel.SetArgument(i.first, i.second); }
+
+  // Sets the global and local thread-sizes
+  auto global = kernel.global();
+  auto local = kernel.local();
+
+  // Makes sure that the global size is a multiple of the local
+  for (auto i=size_t{0}; i<global.size(); ++i) {
+    global[i] = Ceil(global[i], local[i]);
+  }
+
+  // Verifies the local memory usage of the kernel
+  auto local_mem_usage = tune_kernel.LocalMemUsage(device_);
+  if (!device_.IsLocalMemoryValid(local_mem_usage)) {
+    throw std::runtime_error("Using too much local memory");
+  }
 
-    // Sets the kernel and its arguments
+  // Prepares the kernel
+  queue_.Finish();
+
+  // Multiple runs of the kernel to find the minimum execution time
+  fprintf(stdout, "%s Running %s\n", kMessageRun.c_str(), kernel.name().c_str());
+  auto events = std::vector<Event>(num_runs_);
+  auto elapsed_time = std::numeric_limits<float>::max();
+  for (auto t=size_t{0}; t<num_runs_; ++t) {
     #ifdef VERBOSE
-      fprintf(stdout, "%s Setting kernel arguments\n", kMessageVerbose.c_str());
+      fprintf(stdout, "%s Launching kernel (%zu out of %zu for averaging)\n", kMessageVerbose.c_str(),
+              t + 1, num_runs_);
     #endif
-    auto tune_kernel = Kernel(program, kernel.name());
-    for (auto &i: arguments_input_) { tune_kernel.SetArgument(i.index, i.buffer); }
-    for (auto &i: arguments_output_copy_) { tune_kernel.SetArgument(i.index, i.buffer); }
-    for (auto &i: arguments_int_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_size_t_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_float_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_double_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_float2_) { tune_kernel.SetArgument(i.first, i.second); }
-    for (auto &i: arguments_double2_) { tune_kernel.SetArgument(i.first, i.second); }
-
-    // Sets the global and local thread-sizes
-    auto global = kernel.global();
-    auto local = kernel.local();
-
-    // Makes sure that the global size is a multiple of the local
-    for (auto i=size_t{0}; i<global.size(); ++i) {
-      global[i] = Ceil(global[i], local[i]);
-    }
-
-    // Verifies the local memory usage of the kernel
-    auto local_mem_usage = tune_kernel.LocalMemUsage(device_);
-    if (!device_.IsLocalMemoryValid(local_mem_usage)) {
-      throw std::runtime_error("Using too much local memory");
-    }
-
-    // Prepares the kernel
-    queue_.Finish();
-
-    // Multiple runs of the kernel to find the minimum execution time
-    fprintf(stdout, "%s Running %s\n", kMessageRun.c_str(), kernel.name().c_str());
-    auto events = std::vector<Event>(num_runs_);
-    auto elapsed_time = std::numeric_limits<float>::max();
-    for (auto t=size_t{0}; t<num_runs_; ++t) {
-      #ifdef VERBOSE
-        fprintf(stdout, "%s Launching kernel (%zu out of %zu for averaging)\n", kMessageVerbose.c_str(),
-                t + 1, num_runs_);
-      #endif
-      const auto start_time = std::chrono::steady_clock::now();
-
-      // Runs the kernel (this is the timed part)
-      tune_kernel.Launch(queue_, global, local, events[t].pointer());
-      queue_.Finish(events[t]);
-
-      // Collects the timing information
-      const auto cpu_timer = std::chrono::steady_clock::now() - start_time;
-      const auto cpu_timing = std::chrono::duration<float,std::milli>(cpu_timer).count();
-      #ifdef VERBOSE
-        fprintf(stdout, "%s Completed kernel in %.2lf ms\n", kMessageVerbose.c_str(), cpu_timing);
-      #endif
-      elapsed_time = std::min(elapsed_time, cpu_timing);
-    }
-    queue_.Finish();
-
-    // Prints diagnostic information
-    fprintf(stdout, "%s Completed %s (%.1lf ms) - %zu out of %zu\n",
-            kMessageOK.c_str(), kernel.name().c_str(), elapsed_time,
-            configuration_id+1, num_configurations);
-
-    // Computes the result of the tuning
-    auto local_threads = size_t{1};
-    for (auto &item: local) { local_threads *= item; }
-    TunerResult result = {kernel.name(), elapsed_time, local_threads, false, {}};
-    return result;
-  }
+    const auto start_time = std::chrono::steady_clock::now();
 
-  // There was an exception, now return an invalid tuner results
-  catch(std::exception& e) {
-    fprintf(stdout, "%s Kernel %s failed\n", kMessageFailure.c_str(), kernel.name().c_str());
-    fprintf(stdout, "%s   catched exception: %s\n", kMessageFailure.c_str(), e.what());
-    TunerResult result = {kernel.name(), std::numeric_limits<float>::max(), 0, false, {}};
-    return result;
+    // Runs the kernel (this is the timed part)
+    tune_kernel.Launch(queue_, global, local, events[t].pointer());
+    queue_.Finish(events[t]);
+
+    // Collects the timing information
+    const auto cpu_timer = std::chrono::steady_clock::now() - start_time;
+    const auto cpu_timing = std::chrono::duration<float,std::milli>(cpu_timer).count();
+    #ifdef VERBOSE
+      fprintf(stdout, "%s Completed kernel in %.2lf ms\n", kMessageVerbose.c_str(), cpu_timing);
+    #endif
+    elapsed_time = std::min(elapsed_time, cpu_timing);
   }
+  queue_.Finish();
+
+  // Prints diagnostic information
+  fprintf(stdout, "%s Completed %s (%.1lf ms) - %zu out of %zu\n",
+          kMessageOK.c_str(), kernel.name().c_str(), elapsed_time,
+          configuration_id+1, num_configurations);
+
+  // Computes the result of the tuning
+  auto local_threads = size_t{1};
+  for (auto &item: local) { local_threads *= item; }
+  TunerResult result = {kernel.name(), elapsed_time, local_threads, false, {},
+                        Outcome::kSuccess, 1.0f};
+  return result;
+}
+
+// Prints the exception of a failed run and returns an invalid tuner result
+TunerImpl::TunerResult TunerImpl::FailedResult(const KernelInfo &kernel, const Outcome outcome,
+                                               const std::exception &e) {
+  fprintf(stdout, "%s Kernel %s failed\n", kMessageFailure.c_str(), kernel.name().c_str());
+  fprintf(stdout, "%s   catched exception: %s\n", kMessageFailure.c_str(), e.what());
+  TunerResult result = {kernel.name(), std::numeric_limits<float>::max(), 0, false, {},
+                        outcome, 1.0f};
+  return result;
 }
 
 // =================================================================================================
@@ -494,137 +1093,219 @@ template <> double TunerImpl::AbsoluteDifference(const half reference, const hal
 // Trains a model and predicts all remaining configurations
 void TunerImpl::ModelPrediction(const Model model_type, const float validation_fraction,
                                 const size_t test_top_x_configurations) {
+  if (!retain_results_) {
+    throw std::runtime_error("ModelPrediction requires the results to be retained");
+  }
+  OpenResultSinks();
+  BuildResultCache();
 
   // Iterates over all tunable kernels
-  for (auto &kernel: kernels_) {
+  models_.resize(kernels_.size());
+  for (auto id=size_t{0}; id<kernels_.size(); ++id) {
+    auto &kernel = kernels_[id];
 
-    // Retrieves the number of training samples and features
-    auto validation_samples = static_cast<size_t>(tuning_results_.size()*validation_fraction);
-    auto training_samples = tuning_results_.size() - validation_samples;
-    auto features = tuning_results_[0].configuration.size();
+    // The configurations are not yet computed in case the search space was sampled
+    if (kernel.configurations().size() == 0) {
+      kernel.SetConfigurations();
+    }
 
-    // Sets the raw training and validation data
-    auto x_train = std::vector<std::vector<float>>(training_samples, std::vector<float>(features));
+    // Collects the successful results of this kernel and shuffles them, such that neither the
+    // validation set nor the cross-validation folds depend on the order of the search
+    const auto encoder = FeatureEncoder(kernel);
+    auto features = encoder.NumFeatures();
+    auto x = std::vector<std::vector<float>>();
+    auto y = std::vector<float>();
+    for (auto &tuning_result: tuning_results_) {
+      if (tuning_result.kernel_name != kernel.name() || !tuning_result.status) { continue; }
+      if (!std::isfinite(tuning_result.time) || tuning_result.time <= 0.0f) { continue; }
+      x.push_back(encoder.Encode(tuning_result.configuration));
+      y.push_back(tuning_result.time);
+    }
+    auto order = std::vector<size_t>(x.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::shuffle(order.begin(), order.end(), std::default_random_engine(seed_));
+
+    // Sets the encoded training and validation data
+    auto validation_samples = static_cast<size_t>(x.size()*validation_fraction);
+    auto training_samples = x.size() - validation_samples;
+    if (training_samples == 0) { throw std::runtime_error("No results to train a model on"); }
+    auto x_train = std::vector<std::vector<float>>(training_samples);
     auto y_train = std::vector<float>(training_samples);
     for (auto s=size_t{0}; s<training_samples; ++s) {
-      y_train[s] = tuning_results_[s].time;
-      for (auto f=size_t{0}; f<features; ++f) {
-        x_train[s][f] = static_cast<float>(tuning_results_[s].configuration[f].value);
-      }
+      x_train[s] = x[order[s]];
+      y_train[s] = y[order[s]];
     }
-    auto x_validation = std::vector<std::vector<float>>(validation_samples, std::vector<float>(features));
+    auto x_validation = std::vector<std::vector<float>>(validation_samples);
     auto y_validation = std::vector<float>(validation_samples);
     for (auto s=size_t{0}; s<validation_samples; ++s) {
-      y_validation[s] = tuning_results_[s+training_samples].time;
-      for (auto f=size_t{0}; f<features; ++f) {
-        x_validation[s][f] = static_cast<float>(tuning_results_[s + training_samples].configuration[f].value);
-      }
+      x_validation[s] = x[order[s + training_samples]];
+      y_validation[s] = y[order[s + training_samples]];
     }
 
-    // Pointer to one of the machine learning models
-    std::unique_ptr<MLModel<float>> model;
-
-    // Trains a linear regression model
-    if (model_type == Model::kLinearRegression) {
-      PrintHeader("Training a linear regression model");
-
-      // Sets the learning parameters
-      auto learning_iterations = size_t{800}; // For gradient descent
-      auto learning_rate = 0.05f; // For gradient descent
-      auto lambda = 0.2f; // Regularization parameter
-      auto debug_display = true; // Output learned data to stdout
-
-      // Trains and validates the model
-      model = std::unique_ptr<MLModel<float>>(
-        new LinearRegression<float>(learning_iterations, learning_rate, lambda, debug_display)
-      );
-      model->Train(x_train, y_train);
-      model->Validate(x_validation, y_validation);
+    // Selects the hyperparameters of the model using k-fold cross-validation on the training data,
+    // or uses the default settings if cross-validation is disabled
+    auto settings = DefaultModelSettings(model_type);
+    if (num_folds_ >= 2) {
+      PrintHeader("Selecting the model hyperparameters using "+std::to_string(num_folds_)+
+                  "-fold cross-validation");
+      settings = SelectModelSettings(model_type, x_train, y_train, num_folds_, seed_,
+                                     !suppress_output_);
     }
 
-    // Trains a neural network model
-    else if (model_type == Model::kNeuralNetwork) {
-      PrintHeader("Training a neural network model");
-
-      // Sets the learning parameters
-      auto learning_iterations = size_t{800}; // For gradient descent
-      auto learning_rate = 0.1f; // For gradient descent
-      auto lambda = 0.005f; // Regularization parameter
-      auto debug_display = true; // Output learned data to stdout
-      auto layers = std::vector<size_t>{features, 20, 1};
-
-      // Trains and validates the model
-      model = std::unique_ptr<MLModel<float>>(
-        new NeuralNetwork<float>(learning_iterations, learning_rate, lambda, layers, debug_display)
-      );
-      model->Train(x_train, y_train);
-      model->Validate(x_validation, y_validation);
+    // Trains and validates the model
+    switch (model_type) {
+      case Model::kLinearRegression: PrintHeader("Training a linear regression model"); break;
+      case Model::kNeuralNetwork: PrintHeader("Training a neural network model"); break;
+      case Model::kGradientBoostedTrees:
+        PrintHeader("Training a gradient-boosted decision trees model"); break;
+      default: throw std::runtime_error("Unknown machine learning model");
     }
-
-    // Unknown model
-    else {
-      throw std::runtime_error("Unknown machine learning model");
+    if (num_ensemble_models_ > 1) {
+      printf("%s Training an ensemble of %zu models on bootstrap samples\n",
+             kMessageInfo.c_str(), num_ensemble_models_);
     }
-
-    // Iterates over all configurations (the permutations of the tuning parameters)
+    auto debug_display = true; // Output learned data to stdout
+    auto model = std::make_shared<ModelEnsemble>(settings, num_ensemble_models_, features,
+                                                 debug_display, seed_);
+    model->Train(x_train, y_train);
+    if (validation_samples != 0) { model->Validate(x_validation, y_validation); }
+
+    // Predicts all configurations (the permutations of the tuning parameters) at once. The threads
+    // encode and predict them chunk by chunk.
     PrintHeader("Predicting the remaining configurations using the model");
-    auto model_results = std::vector<std::tuple<size_t,float>>();
-    auto p = size_t{0};
-    for (auto &permutation: kernel.configurations()) {
-
-      // Runs the trained model to predicts the result
-      auto x_test = std::vector<float>();
-      for (auto &setting: permutation) {
-        x_test.push_back(static_cast<float>(setting.value));
-      }
-      auto predicted_time = model->Predict(x_test);
-      model_results.push_back(std::make_tuple(p, predicted_time));
-      ++p;
-    }
-
-    // Sorts the modelled results by performance
-    std::sort(begin(model_results), end(model_results),
-      [](const std::tuple<size_t,float> &t1, const std::tuple<size_t,float> &t2) {
-        return std::get<1>(t1) < std::get<1>(t2);
-      }
-    );
+    const auto configurations = kernel.configurations();
+    auto predicted_times = std::vector<float>();
+    auto predicted_variances = std::vector<float>();
+    model->PredictBatch(configurations.size(), features,
+                        [&encoder, &configurations] (const size_t p, float* row) {
+                          encoder.Encode(configurations[p], row);
+                        },
+                        predicted_times, predicted_variances);
+
+    // Selects the best modelled results by performance
+    const auto num_best = std::min(test_top_x_configurations, configurations.size());
+    const auto model_results = SelectByAcquisition(predicted_times, predicted_variances, num_best);
 
     // Tests the best configurations on the device to verify the results
     PrintHeader("Testing the best-found configurations");
-    for (auto i=size_t{0}; i<test_top_x_configurations && i<model_results.size(); ++i) {
-      auto result = model_results[i];
-      printf("[ -------> ] The model predicted: %.3lf ms\n", std::get<1>(result));
-      auto pid = std::get<0>(result);
-      auto permutations = kernel.configurations();
-      auto permutation = permutations[pid];
-
-      // Adds the parameters to the source-code string as defines
-      auto source = std::string{};
-      for (auto &config: permutation) {
-        source += config.GetDefine();
+    for (auto i=size_t{0}; i<num_best; ++i) {
+      auto pid = model_results[i];
+      if (num_ensemble_models_ > 1) {
+        printf("[ -------> ] The model predicted: %.3lf ms (standard deviation %.3lf ms)\n",
+               predicted_times[pid], std::sqrt(predicted_variances[pid]));
+      }
+      else {
+        printf("[ -------> ] The model predicted: %.3lf ms\n", predicted_times[pid]);
       }
-      source += kernel.source();
 
-      // Updates the local range with the parameter values
-      kernel.ComputeRanges(permutation);
+      // Compiles and runs the kernel and stores the parameters and the timing-result
+      StoreResult(RunConfiguration(kernel, configurations[pid], pid, test_top_x_configurations));
+    }
 
-      // Compiles and runs the kernel
-      auto tuning_result = RunKernel(source, kernel, pid, test_top_x_configurations);
-      tuning_result.status = VerifyOutput();
+    // Keeps the model, such that it can be saved
+    models_[id] = model;
+  }
+  for (auto &sink: result_sinks_) { sink->Flush(); }
+}
 
-      // Stores the parameters and the timing-result
-      tuning_result.configuration = permutation;
-      tuning_results_.push_back(tuning_result);
-      if (tuning_result.time == std::numeric_limits<float>::max()) {
-        tuning_result.time = 0.0;
-        PrintResult(stdout, tuning_result, kMessageFailure);
-        tuning_result.time = std::numeric_limits<float>::max();
-      }
-      else if (!tuning_result.status) {
-        PrintResult(stdout, tuning_result, kMessageWarning);
+// Ranks the configurations by a score based on the mean and the standard deviation and keeps the
+// best. Thompson sampling instead draws a new sample from a normal distribution for every remaining
+// configuration each time it selects one, such that the selection spreads over the likely optima.
+std::vector<size_t> TunerImpl::SelectByAcquisition(const std::vector<float> &means,
+                                                   const std::vector<float> &variances,
+                                                   const size_t num_best) const {
+  const auto num_configurations = means.size();
+  auto indices = std::vector<size_t>(num_configurations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  if (acquisition_ == Acquisition::kThompsonSampling) {
+    auto generator = std::default_random_engine(seed_);
+    auto distribution = std::normal_distribution<double>(0.0, 1.0);
+    for (auto i=size_t{0}; i<num_best; ++i) {
+      auto best = i;
+      auto best_sample = std::numeric_limits<double>::max();
+      for (auto c=i; c<num_configurations; ++c) {
+        const auto sample = means[indices[c]] +
+                            std::sqrt(variances[indices[c]]) * distribution(generator);
+        if (sample < best_sample) { best_sample = sample; best = c; }
       }
+      std::swap(indices[i], indices[best]);
+    }
+  }
+  else {
+    auto factor = 0.0;
+    if (acquisition_ == Acquisition::kLowerConfidenceBound) { factor = -acquisition_kappa_; }
+    if (acquisition_ == Acquisition::kUpperConfidenceBound) { factor = acquisition_kappa_; }
+    auto scores = std::vector<double>(num_configurations);
+    for (auto c=size_t{0}; c<num_configurations; ++c) {
+      scores[c] = means[c] + factor * std::sqrt(variances[c]);
     }
+    std::partial_sort(indices.begin(), indices.begin() + num_best, indices.end(),
+      [&scores](const size_t p1, const size_t p2) { return scores[p1] < scores[p2]; }
+    );
+  }
+  indices.resize(num_best);
+  return indices;
+}
+
+// Saves a trained model together with the encoding of the configurations into features. Between the
+// header and the model are the name of the kernel and the encoder.
+void TunerImpl::SaveModel(const size_t id, const std::string &filename) {
+  if (id >= models_.size() || !models_[id]) {
+    throw std::runtime_error("No trained model for this kernel: call ModelPrediction first");
   }
+  auto &kernel = kernels_[id];
+  const auto encoder = FeatureEncoder(kernel);
+  std::ofstream file(filename);
+  if (!file) { throw std::runtime_error("Could not open model file: "+filename); }
+  file << kModelFileHeader << "\n";
+  file << kernel.name() << "\n";
+  encoder.Save(file);
+  models_[id]->Save(file);
+}
+
+// =================================================================================================
+
+// Results are first passed to the receivers, such that they see every result as soon as possible.
+// Without retaining the results, the fastest ones of the current kernel are kept in a list sorted
+// by execution time, which is limited to the number of finalists.
+void TunerImpl::StoreResult(const TunerResult &result) {
+  for (auto &sink: result_sinks_) { sink->Write(result); }
+  if (result_callback_) { result_callback_(PublicResult(result)); }
+  if (retain_results_) {
+    tuning_results_.push_back(result);
+    return;
+  }
+  if (!result.status) { return; }
+  if (!best_result_.status || result.time <= best_result_.time) { best_result_ = result; }
+  if (num_finalists_ != 0) {
+    const auto position = std::upper_bound(finalist_candidates_.begin(), finalist_candidates_.end(),
+                                           result, [](const TunerResult &a, const TunerResult &b) {
+                                             return a.time < b.time;
+                                           });
+    if (static_cast<size_t>(position - finalist_candidates_.begin()) < num_finalists_) {
+      finalist_candidates_.insert(position, result);
+      if (finalist_candidates_.size() > num_finalists_) { finalist_candidates_.pop_back(); }
+    }
+  }
+}
+
+// The sinks are opened as late as possible, such that the binary sink knows all the kernels
+void TunerImpl::OpenResultSinks() {
+  for (auto i=result_sinks_.size(); i<result_sink_files_.size(); ++i) {
+    const auto &sink_file = result_sink_files_[i];
+    result_sinks_.push_back(CreateResultSink(sink_file.first, sink_file.second, GetDeviceInfo(),
+                                             kernels_));
+  }
+}
+
+// Copies the fields and converts the configuration into a map of parameter names and values
+Result TunerImpl::PublicResult(const TunerResult &result) {
+  auto configuration = std::unordered_map<std::string, size_t>{};
+  for (auto &setting: result.configuration) {
+    configuration[setting.name] = setting.value;
+  }
+  return Result{result.kernel_name, result.time, result.threads, result.status, result.outcome,
+                result.drift, configuration};
 }
 
 // =================================================================================================
@@ -641,8 +1322,18 @@ void TunerImpl::PrintResult(FILE* fp, const TunerResult &result, const std::stri
 
 // =================================================================================================
 
-// Finds the best result
+// Finds the best result. If the finalist stage was run, this is the fastest of the winners of the
+// finalist stage (per kernel) in terms of median time. If the results are not retained, this is the
+// best result tracked while storing them.
 TunerImpl::TunerResult TunerImpl::GetBestResult() const {
+  if (finalist_results_.size() != 0) {
+    auto best_result = finalist_results_[0];
+    for (auto &finalist_result: finalist_results_) {
+      if (finalist_result.time < best_result.time) { best_result = finalist_result; }
+    }
+    return best_result;
+  }
+  if (!retain_results_) { return best_result_; }
   auto best_result = tuning_results_[0];
   auto best_time = std::numeric_limits<double>::max();
   for (auto &tuning_result: tuning_results_) {
@@ -654,6 +1345,19 @@ TunerImpl::TunerResult TunerImpl::GetBestResult() const {
   return best_result;
 }
 
+// The same device information as printed to JSON
+std::vector<std::pair<std::string,std::string>> TunerImpl::GetDeviceInfo() const {
+  return {
+    {"device", device_.Name()},
+    {"platform_version", platform_.Version()},
+    {"device_vendor", platform_.Vendor()},
+    {"device_type", device_.Type()},
+    {"device_core_clock", std::to_string(device_.CoreClock())},
+    {"device_compute_units", std::to_string(device_.ComputeUnits())},
+    {"device_extra_info", device_.GetExtraInfo()}
+  };
+}
+
 // =================================================================================================
 
 // Loads a file into a stringstream and returns the result as a string
@@ -665,6 +1369,466 @@ std::string TunerImpl::LoadFile(const std::string &filename) {
   return file_contents.str();
 }
 
+// Reads the results of an earlier tuning session as written by PrintJSON or by the JSON-lines sink.
+// This is a small parser for the subset of JSON used there: the values of other keys are skipped,
+// the results are parsed into their kernel name, execution time, configuration, etc. Throws on
+// malformed input.
+std::vector<TunerImpl::ImportedResult> TunerImpl::LoadJSONResults(const std::string &filename) {
+  std::ifstream file(filename);
+  if (file.fail()) { throw std::runtime_error("Could not open JSON file: "+filename); }
+  std::stringstream file_contents;
+  file_contents << file.rdbuf();
+  const auto json = file_contents.str();
+
+  // Helper functions to walk over the JSON string
+  auto pos = size_t{0};
+  auto fail = [&filename, &pos](const std::string &message) {
+    throw std::runtime_error("Invalid JSON file "+filename+" at position "+std::to_string(pos)+
+                             ": "+message);
+  };
+  auto peek = [&json, &pos]() {
+    while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) { ++pos; }
+    return (pos < json.size()) ? json[pos] : '\0';
+  };
+  auto expect = [&peek, &pos, &fail](const char character) {
+    if (peek() != character) { fail(std::string{"expected '"}+character+"'"); }
+    ++pos;
+  };
+  auto parse_string = [&json, &pos, &expect, &fail]() {
+    expect('"');
+    auto result = std::string{};
+    while (pos < json.size() && json[pos] != '"') {
+      if (json[pos] == '\\') { ++pos; }
+      if (pos < json.size()) { result += json[pos++]; }
+    }
+    if (pos == json.size()) { fail("unterminated string"); }
+    ++pos;
+    return result;
+  };
+  auto parse_number = [&json, &pos, &peek, &fail]() {
+    peek();
+    const auto start = json.c_str() + pos;
+    char* end = nullptr;
+    const auto value = std::strtod(start, &end);
+    if (end == start) { fail("expected a number"); }
+    pos += static_cast<size_t>(end - start);
+    return value;
+  };
+  auto skip_value = [&json, &pos, &peek, &parse_string]() {
+    auto depth = size_t{0};
+    while (pos < json.size()) {
+      const auto character = peek();
+      if (character == '"') { parse_string(); continue; }
+      if (depth == 0 && (character == ',' || character == '}' || character == ']')) { break; }
+      if (character == '{' || character == '[') { ++depth; }
+      else if (character == '}' || character == ']') { --depth; }
+      ++pos;
+    }
+  };
+
+  auto parse_literal = [&json, &pos, &peek, &fail]() {
+    peek();
+    auto literal = std::string{};
+    while (pos < json.size() && std::isalpha(static_cast<unsigned char>(json[pos]))) {
+      literal += json[pos++];
+    }
+    if (literal != "true" && literal != "false" && literal != "null") {
+      fail("expected true, false, or null");
+    }
+    return literal;
+  };
+
+  // Parses a key-value pair of a result. Returns false if the key is not part of a result.
+  auto parse_result_value = [&](const std::string &key, ImportedResult &imported) {
+    auto &result = imported.result;
+    if (key == "kernel") { result.kernel_name = parse_string(); }
+    else if (key == "kernel_hash") { imported.kernel_hash = parse_string(); }
+    else if (key == "time") {
+      if (peek() == 'n') { parse_literal(); }
+      else { result.time = static_cast<float>(parse_number()); }
+    }
+    else if (key == "threads") { result.threads = static_cast<size_t>(parse_number()); }
+    else if (key == "status") { result.status = (parse_literal() == "true"); }
+    else if (key == "outcome") { result.outcome = OutcomeFromName(parse_string()); }
+    else if (key == "drift") { result.drift = static_cast<float>(parse_number()); }
+    else if (key == "parameters") {
+      expect('{');
+      while (peek() != '}') {
+        const auto name = parse_string();
+        expect(':');
+        const auto value = static_cast<size_t>(parse_number());
+        result.configuration.push_back({name, value});
+        if (peek() == ',') { ++pos; }
+      }
+      expect('}');
+    }
+    else { return false; }
+    return true;
+  };
+  const auto empty_result = ImportedResult{"", "", TunerResult{"",
+                                                               std::numeric_limits<float>::max(), 0,
+                                                               true, {}, Outcome::kSuccess, 1.0f}};
+
+  // Parses the top-level objects: either a single one with the device and a list of results (as
+  // written by PrintJSON) or one result per object (as written by the JSON-lines sink)
+  auto results = std::vector<ImportedResult>();
+  while (peek() != '\0') {
+    const auto first_result = results.size();
+    auto device = std::string{};
+    auto object_result = empty_result;
+    auto is_result = false;
+    expect('{');
+    while (peek() != '}') {
+      const auto key = parse_string();
+      expect(':');
+      if (key == "device") { device = parse_string(); }
+      else if (key == "results") {
+        expect('[');
+        while (peek() != ']') {
+          auto result = empty_result;
+          expect('{');
+          while (peek() != '}') {
+            const auto result_key = parse_string();
+            expect(':');
+            if (!parse_result_value(result_key, result)) { skip_value(); }
+            if (peek() == ',') { ++pos; }
+          }
+          expect('}');
+          results.push_back(result);
+          if (peek() == ',') { ++pos; }
+        }
+        expect(']');
+      }
+      else if (parse_result_value(key, object_result)) { is_result = true; }
+      else { skip_value(); }
+      if (peek() == ',') { ++pos; }
+    }
+    expect('}');
+    if (is_result) { results.push_back(object_result); }
+    for (auto r=first_result; r<results.size(); ++r) {
+      if (results[r].device.empty()) { results[r].device = device; }
+    }
+  }
+  return results;
+}
+
+// Reads the results from a file with semicolon-separated values. Each header line (starting with
+// the "name" column) sets the columns of the lines below it: the columns of a result are known by
+// name and all other columns are parameters. Files written by PrintToFile only hold successful
+// results and lack the status and outcome columns.
+std::vector<TunerImpl::ImportedResult> TunerImpl::LoadCSVResults(const std::string &filename) {
+  std::ifstream file(filename);
+  if (file.fail()) { throw std::runtime_error("Could not open CSV file: "+filename); }
+  auto split = [](const std::string &line) {
+    auto fields = std::vector<std::string>();
+    auto field = std::string{};
+    std::stringstream line_stream(line);
+    while (std::getline(line_stream, field, ';')) { fields.push_back(field); }
+    return fields;
+  };
+  auto results = std::vector<ImportedResult>();
+  auto header = std::vector<std::string>();
+  auto line = std::string{};
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+    if (line.empty()) { continue; }
+    const auto fields = split(line);
+    if (fields[0] == "name") { header = fields; continue; }
+    if (fields.size() != header.size()) {
+      throw std::runtime_error("Invalid line in CSV file "+filename+": "+line);
+    }
+    auto imported = ImportedResult{"", "", TunerResult{"", std::numeric_limits<float>::max(), 0,
+                                                       true, {}, Outcome::kSuccess, 1.0f}};
+    auto &result = imported.result;
+    try {
+      for (auto c=size_t{0}; c<fields.size(); ++c) {
+        const auto &column = header[c];
+        const auto &field = fields[c];
+        if (column == "name") { result.kernel_name = field; }
+        else if (column == "time") { if (!field.empty()) { result.time = std::stof(field); } }
+        else if (column == "threads") { result.threads = static_cast<size_t>(std::stoull(field)); }
+        else if (column == "status") { result.status = (field == "1"); }
+        else if (column == "outcome") { result.outcome = OutcomeFromName(field); }
+        else if (column == "drift") { result.drift = std::stof(field); }
+        else if (column == "device") { imported.device = field; }
+        else if (column == "kernel_hash") { imported.kernel_hash = field; }
+        else { result.configuration.push_back({column, static_cast<size_t>(std::stoull(field))}); }
+      }
+    } catch (const std::logic_error &) { // Thrown by the string-to-number conversions
+      throw std::runtime_error("Invalid line in CSV file "+filename+": "+line);
+    }
+    results.push_back(imported);
+  }
+  return results;
+}
+
+// JSON files start with an object, CSV files with a header line
+std::vector<TunerImpl::ImportedResult> TunerImpl::LoadResults(const std::string &filename) {
+  std::ifstream file(filename);
+  if (file.fail()) { throw std::runtime_error("Could not open results file: "+filename); }
+  auto first_character = char{0};
+  file >> first_character;
+  return (first_character == '{') ? LoadJSONResults(filename) : LoadCSVResults(filename);
+}
+
+// =================================================================================================
+
+// Caches the imported results of each kernel. Kernels of which no results are known get an empty
+// cache.
+void TunerImpl::BuildResultCache() {
+  result_cache_.clear();
+  if (imported_results_.size() == 0) { return; }
+  const auto device_name = device_.Name();
+  for (auto &kernel: kernels_) {
+    const auto cache = CacheImportedResults(kernel, device_name, imported_results_);
+    if (!suppress_output_ && cache.results.size() != 0) {
+      fprintf(stdout, "%s Found %zu known configuration(s) of kernel %s in the imported results\n",
+              kMessageInfo.c_str(), cache.results.size(), kernel.name().c_str());
+      if (cache.num_mapped != 0) {
+        fprintf(stdout, "%s Of these, %zu lack parameters which are filled in\n",
+                kMessageInfo.c_str(), cache.num_mapped);
+      }
+      if (cache.num_unverified != 0) {
+        fprintf(stdout, "%s Of these, %zu lack the device or the source hash: assumed to match\n",
+                kMessageWarning.c_str(), cache.num_unverified);
+      }
+    }
+    result_cache_[kernel.name()] = cache;
+  }
+}
+
+// Keeps the imported results of the kernel by the index of their configuration. Results of another
+// device or of another version of the kernel's source-code are skipped, results which lack this
+// information are assumed to match. Later results overwrite earlier ones.
+//
+// Results of a search space with other parameters are mapped onto the current one where the values
+// are implied. A missing parameter takes its default given when importing, or otherwise its only
+// value, or otherwise (if the kernel doesn't use it) any value. A setting which is no longer a
+// parameter has to equal its default. Other results can't be mapped and are skipped.
+TunerImpl::ResultCache TunerImpl::CacheImportedResults(
+    const KernelInfo &kernel, const std::string &device_name,
+    const std::vector<ImportedResults> &imported_results) {
+  auto cache = ResultCache{KernelInfo::Configuration(), {}, 0, 0};
+  const auto num_raw_configurations = kernel.NumRawConfigurations();
+  if (num_raw_configurations == 0) { return cache; }
+  const auto kernel_hash = kernel.SourceHash();
+  const auto parameters = kernel.parameters();
+  auto is_used = std::vector<bool>();
+  for (auto &parameter: parameters) {
+    is_used.push_back(kernel.UsesParameter(parameter.name));
+    if (!is_used.back()) {
+      cache.unused_parameters.push_back({parameter.name, parameter.values[0]});
+    }
+  }
+  for (auto &imported_file: imported_results) {
+    const auto &defaults = imported_file.defaults;
+    for (auto &imported: imported_file.results) {
+      if (imported.result.kernel_name != kernel.name()) { continue; }
+      if (!imported.device.empty() && imported.device != device_name) { continue; }
+      if (!imported.kernel_hash.empty() && imported.kernel_hash != kernel_hash) { continue; }
+
+      // Checks the settings which are not parameters against their defaults
+      auto configuration = imported.result.configuration;
+      auto is_mappable = true;
+      for (auto &setting: configuration) {
+        const auto is_setting = [&setting] (const KernelInfo::Parameter &parameter) {
+          return parameter.name == setting.name;
+        };
+        if (std::none_of(parameters.begin(), parameters.end(), is_setting)) {
+          const auto default_value = defaults.find(setting.name);
+          if (default_value == defaults.end() || default_value->second != setting.value) {
+            is_mappable = false;
+          }
+        }
+      }
+
+      // Adds the missing parameters
+      const auto num_settings = configuration.size();
+      for (auto p=size_t{0}; p<parameters.size(); ++p) {
+        const auto &parameter = parameters[p];
+        const auto is_parameter = [&parameter] (const KernelInfo::Setting &setting) {
+          return setting.name == parameter.name;
+        };
+        if (std::any_of(configuration.begin(), configuration.begin() + num_settings,
+                        is_parameter)) { continue; }
+        const auto default_value = defaults.find(parameter.name);
+        if (default_value != defaults.end()) {
+          configuration.push_back({parameter.name, default_value->second});
+        }
+        else if (parameter.values.size() == 1 || !is_used[p]) {
+          configuration.push_back({parameter.name, parameter.values[0]});
+        }
+        else {
+          is_mappable = false;
+        }
+      }
+      if (!is_mappable) { continue; }
+
+      const auto index = ResultCacheIndex(kernel, cache, configuration);
+      if (index >= num_raw_configurations) { continue; }
+      cache.results[index] = imported.result;
+      if (imported.device.empty() || imported.kernel_hash.empty()) { ++cache.num_unverified; }
+      if (configuration.size() != num_settings) { ++cache.num_mapped; }
+    }
+  }
+  return cache;
+}
+
+// Looks up the cache of the kernel
+const TunerImpl::TunerResult* TunerImpl::FindCachedResult(
+    const KernelInfo &kernel, const KernelInfo::Configuration &configuration) const {
+  const auto kernel_cache = result_cache_.find(kernel.name());
+  if (kernel_cache == result_cache_.end()) { return nullptr; }
+  return FindCachedResult(kernel, kernel_cache->second, configuration);
+}
+
+// Looks up the configuration by its index
+const TunerImpl::TunerResult* TunerImpl::FindCachedResult(
+    const KernelInfo &kernel, const ResultCache &cache,
+    const KernelInfo::Configuration &configuration) {
+  if (cache.results.size() == 0) { return nullptr; }
+  const auto result = cache.results.find(ResultCacheIndex(kernel, cache, configuration));
+  return (result == cache.results.end()) ? nullptr : &result->second;
+}
+
+// Puts the first values of the unused parameters in front of the configuration. The index is based
+// on the first setting of each parameter, so these replace the values of the configuration.
+size_t TunerImpl::ResultCacheIndex(const KernelInfo &kernel, const ResultCache &cache,
+                                   const KernelInfo::Configuration &configuration) {
+  if (cache.unused_parameters.size() == 0) { return kernel.IndexFromConfiguration(configuration); }
+  auto canonical = cache.unused_parameters;
+  canonical.insert(canonical.end(), configuration.begin(), configuration.end());
+  return kernel.IndexFromConfiguration(canonical);
+}
+
+// =================================================================================================
+
+// Reads the configurations proposed by a search method from a search log (see Searcher::PrintLog),
+// in the order in which they were proposed. The log holds one section per kernel, each starting
+// with a "kernel;<name>" line; only the section of this kernel is read. A log without such lines
+// (as written by earlier versions) is a single section. The parameters are matched to those of the
+// kernel by name, a mismatch is an error since the log then belongs to another kernel.
+std::vector<KernelInfo::Configuration> TunerImpl::LoadSearchLog(const KernelInfo &kernel) {
+  std::ifstream file(replay_filename_);
+  if (file.fail()) { throw std::runtime_error("Could not open search log: "+replay_filename_); }
+  auto split = [](const std::string &line) {
+    auto fields = std::vector<std::string>();
+    auto field = std::string{};
+    std::stringstream line_stream(line);
+    while (std::getline(line_stream, field, ';')) { fields.push_back(field); }
+    return fields;
+  };
+  auto is_section = [](const std::string &line) {
+    return line.compare(0, kSearchLogKernelPrefix.size(), kSearchLogKernelPrefix) == 0;
+  };
+
+  // Collects the lines of this kernel's section
+  auto lines = std::vector<std::string>();
+  auto has_sections = false;
+  auto in_section = true;
+  auto line = std::string{};
+  while (std::getline(file, line)) {
+    if (is_section(line)) {
+      if (!has_sections) { lines.clear(); }
+      has_sections = true;
+      in_section = (line.substr(kSearchLogKernelPrefix.size()) == kernel.name());
+      continue;
+    }
+    if (in_section) { lines.push_back(line); }
+  }
+  if (lines.empty()) {
+    throw std::runtime_error("Search log "+replay_filename_+" has no section for kernel "+
+                             kernel.name());
+  }
+
+  // Matches the header's parameter names (following the step, index, and time columns)
+  const auto kNumLeadingColumns = size_t{3};
+  const auto header = split(lines[0]);
+  const auto parameters = kernel.parameters();
+  auto columns = std::vector<size_t>();
+  for (auto &parameter: parameters) {
+    const auto column = std::find(header.begin(), header.end(), parameter.name);
+    if (column == header.end()) {
+      throw std::runtime_error("Search log "+replay_filename_+" lacks parameter "+parameter.name);
+    }
+    columns.push_back(static_cast<size_t>(column - header.begin()));
+  }
+  if (header.size() != kNumLeadingColumns + parameters.size()) {
+    throw std::runtime_error("Search log "+replay_filename_+" does not match kernel "+kernel.name());
+  }
+
+  // Reads the configurations
+  auto configurations = std::vector<KernelInfo::Configuration>();
+  for (auto l=size_t{1}; l<lines.size(); ++l) {
+    const auto &line = lines[l];
+    if (line.empty()) { continue; }
+    const auto fields = split(line);
+    if (fields.size() != header.size()) {
+      throw std::runtime_error("Invalid line in search log "+replay_filename_+": "+line);
+    }
+    auto configuration = KernelInfo::Configuration();
+    for (auto p=size_t{0}; p<parameters.size(); ++p) {
+      const auto value = static_cast<size_t>(std::stoull(fields[columns[p]]));
+      configuration.push_back({parameters[p].name, value});
+    }
+    configurations.push_back(configuration);
+  }
+  if (!suppress_output_) {
+    fprintf(stdout, "%s Replaying %zu configuration(s) from %s\n", kMessageInfo.c_str(),
+            configurations.size(), replay_filename_.c_str());
+  }
+  return configurations;
+}
+
+// Selects the warm-start configurations for a kernel: the best results of earlier tuning sessions of
+// a kernel with the same name. Settings are matched to the current parameters by name. Results
+// which lack a parameter or which are invalid in the current search space (e.g. a value which is no
+// longer part of the parameter's values or a violated constraint) are skipped.
+std::vector<KernelInfo::Configuration> TunerImpl::WarmStartConfigurations(KernelInfo &kernel) {
+  auto configurations = std::vector<KernelInfo::Configuration>();
+  if (warm_start_count_ == 0) { return configurations; }
+
+  // Collects the results of this kernel and sorts them from best to worst
+  auto results = std::vector<TunerResult>();
+  for (auto &result: warm_start_results_) {
+    if (result.status && result.kernel_name == kernel.name()) { results.push_back(result); }
+  }
+  std::stable_sort(results.begin(), results.end(), [](const TunerResult &a, const TunerResult &b) {
+    return a.time < b.time;
+  });
+
+  // Maps the results onto the current search space
+  const auto parameters = kernel.parameters();
+  auto raw_indices = std::vector<size_t>();
+  for (auto &result: results) {
+    if (configurations.size() == warm_start_count_) { break; }
+    auto configuration = KernelInfo::Configuration();
+    for (auto &parameter: parameters) {
+      for (auto &setting: result.configuration) {
+        if (setting.name == parameter.name) {
+          configuration.push_back({parameter.name, setting.value});
+          break;
+        }
+      }
+    }
+    if (configuration.size() != parameters.size()) { continue; }
+    const auto raw_index = kernel.IndexFromConfiguration(configuration);
+    if (raw_index >= kernel.NumRawConfigurations()) { continue; }
+    if (std::find(raw_indices.begin(), raw_indices.end(), raw_index) != raw_indices.end()) {
+      continue;
+    }
+    if (!kernel.ValidConfiguration(configuration)) { continue; }
+    raw_indices.push_back(raw_index);
+    configurations.push_back(configuration);
+  }
+
+  if (!suppress_output_ && configurations.size() != 0) {
+    fprintf(stdout, "%s Warm-starting with %zu configuration(s) of earlier tuning sessions\n",
+            kMessageInfo.c_str(), configurations.size());
+  }
+  return configurations;
+}
+
 // =================================================================================================
 
 // Converts a C++ string to a C string and print it out with nice formatting
@@ -0,0 +1,128 @@
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author: cedric.nugteren@surfsara.nl (Cedric Nugteren)
+//
+// This file implements the WorkerPool class (see the header for information about the class).
+//
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright 2014 SURFsara
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//  http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// =================================================================================================
+
+// The corresponding header file
+#include "internal/worker_pool.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace cltune {
+// =================================================================================================
+
+// Starts the workers, which wait for the first task
+WorkerPool::WorkerPool(const size_t num_threads):
+    workers_(),
+    mutex_(),
+    task_ready_(),
+    task_done_(),
+    task_(nullptr),
+    num_tasks_(0),
+    generation_(0),
+    num_running_(0),
+    stop_(false),
+    errors_(std::max(size_t{1}, num_threads)) {
+  for (auto tid=size_t{1}; tid<num_threads; ++tid) {
+    workers_.emplace_back(&WorkerPool::Work, this, tid);
+  }
+}
+
+// Wakes up the workers to let them stop and waits for them
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_ready_.notify_all();
+  for (auto &worker: workers_) { worker.join(); }
+}
+
+// =================================================================================================
+
+// Publishes the task to the workers, runs the first part, and waits for the workers which have a
+// part in the task
+void WorkerPool::Run(const size_t num_tasks, const std::function<void(size_t)> &task) {
+  if (num_tasks > size()) { throw std::runtime_error("WorkerPool: more tasks than threads"); }
+  if (num_tasks == 0) { return; }
+  if (num_tasks > 1) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      num_tasks_ = num_tasks;
+      num_running_ = num_tasks - 1;
+      ++generation_;
+    }
+    task_ready_.notify_all();
+  }
+  try {
+    task(0);
+  } catch (...) {
+    errors_[0] = std::current_exception();
+  }
+  if (num_tasks > 1) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_done_.wait(lock, [this] { return num_running_ == 0; });
+    task_ = nullptr;
+  }
+
+  // Passes on the first error of any of the tasks
+  for (auto tid=size_t{0}; tid<num_tasks; ++tid) {
+    if (errors_[tid]) {
+      auto error = errors_[tid];
+      for (auto &e: errors_) { e = nullptr; }
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Each worker sleeps until the generation changes. Workers without a part in the task skip it.
+void WorkerPool::Work(const size_t tid) {
+  auto generation = size_t{0};
+  while (true) {
+    auto task = static_cast<const std::function<void(size_t)>*>(nullptr);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_ready_.wait(lock, [this, generation] { return stop_ || generation_ != generation; });
+      if (stop_) { return; }
+      generation = generation_;
+      if (tid >= num_tasks_) { continue; }
+      task = task_;
+    }
+    try {
+      (*task)(tid);
+    } catch (...) {
+      errors_[tid] = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_running_;
+    }
+    task_done_.notify_one();
+  }
+}
+
+// =================================================================================================
+} // namespace cltune
@@ -96,3 +96,37 @@ SCENARIO("kernel info objects can be used", "[KernelInfo]") {
 }
 
 // =================================================================================================
+
+SCENARIO("the unconstrained search space can be indexed", "[KernelInfo]") {
+  GIVEN("An example kernel info object with parameters") {
+
+    auto platform = cltune::Platform(kPlatformID);
+    auto device = cltune::Device(platform, kDeviceID);
+    cltune::KernelInfo kernel("name", "source", device);
+    kernel.set_global_base({64});
+    kernel.set_local_base({1});
+    kernel.AddParameter("example_param_0", {1, 2, 4});
+    kernel.AddParameter("example_param_1", {8, 16});
+
+    WHEN("the configurations are computed") {
+      kernel.SetConfigurations();
+      THEN("the raw size equals the number of configurations") {
+        REQUIRE(kernel.NumRawConfigurations() == size_t{6});
+        REQUIRE(kernel.configurations().size() == kernel.NumRawConfigurations());
+      }
+      AND_THEN("decoding an index gives the configuration at that position") {
+        auto configurations = kernel.configurations();
+        for (auto i=size_t{0}; i<configurations.size(); ++i) {
+          auto config = kernel.ConfigurationFromIndex(i);
+          REQUIRE(config.size() == configurations[i].size());
+          for (auto j=size_t{0}; j<config.size(); ++j) {
+            REQUIRE(config[j].name == configurations[i][j].name);
+            REQUIRE(config[j].value == configurations[i][j].value);
+          }
+        }
+      }
+    }
+  }
+}
+
+// =================================================================================================
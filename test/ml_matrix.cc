@@ -0,0 +1,215 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the matrix routines of the machine-learning models and the batched prediction
+// against naive reference loops. These tests do not require a device.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include <random>
+#include <vector>
+
+#include "internal/ml_matrix.h"
+#include "internal/ml_models/linear_regression.h"
+
+// Creates a matrix with random values between -1 and 1
+cltune::Matrix<float> RandomMatrix(const size_t rows, const size_t cols, const unsigned int seed) {
+  auto generator = std::default_random_engine(seed);
+  auto distribution = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+  auto matrix = cltune::Matrix<float>(rows, cols);
+  for (auto &value: matrix.data()) { value = distribution(generator); }
+  return matrix;
+}
+
+// Reference matrix-matrix multiplication with optionally transposed inputs
+cltune::Matrix<float> ReferenceGemm(const cltune::Matrix<float> &a, const bool a_transposed,
+                                    const cltune::Matrix<float> &b, const bool b_transposed) {
+  const auto m = a_transposed ? a.cols() : a.rows();
+  const auto k = a_transposed ? a.rows() : a.cols();
+  const auto n = b_transposed ? b.rows() : b.cols();
+  auto c = cltune::Matrix<float>(m, n);
+  for (auto i=size_t{0}; i<m; ++i) {
+    for (auto j=size_t{0}; j<n; ++j) {
+      auto sum = 0.0;
+      for (auto l=size_t{0}; l<k; ++l) {
+        const auto a_value = a_transposed ? a(l, i) : a(i, l);
+        const auto b_value = b_transposed ? b(j, l) : b(l, j);
+        sum += a_value * b_value;
+      }
+      c(i, j) = static_cast<float>(sum);
+    }
+  }
+  return c;
+}
+
+// Compares two matrices element by element
+void RequireEqual(const cltune::Matrix<float> &a, const cltune::Matrix<float> &b) {
+  REQUIRE(a.rows() == b.rows());
+  REQUIRE(a.cols() == b.cols());
+  for (auto i=size_t{0}; i<a.data().size(); ++i) {
+    REQUIRE(a.data()[i] == Approx(b.data()[i]).epsilon(1e-4));
+  }
+}
+
+// Creates a symmetric positive-definite matrix: B^T*B plus a multiple of the identity
+cltune::Matrix<double> RandomPositiveDefinite(const size_t n, const unsigned int seed) {
+  const auto b = RandomMatrix(n, n, seed);
+  auto a = cltune::Matrix<double>(n, n);
+  for (auto i=size_t{0}; i<n; ++i) {
+    for (auto j=size_t{0}; j<n; ++j) {
+      for (auto k=size_t{0}; k<n; ++k) { a(i, j) += b(k, i) * b(k, j); }
+    }
+    a(i, i) += static_cast<double>(n);
+  }
+  return a;
+}
+
+// =================================================================================================
+
+SCENARIO("matrix-vector and matrix-matrix multiplications match naive loops", "[Matrix]") {
+  GIVEN("Matrices of odd sizes") {
+
+    // Covers the vectorized and the remainder parts of the dot products
+    const auto a = RandomMatrix(37, 53, 1);
+    const auto x = RandomMatrix(1, 53, 2).data();
+    const auto x_transposed = RandomMatrix(1, 37, 3).data();
+
+    THEN("Gemv and GemvTransposed match") {
+      auto y = std::vector<float>();
+      cltune::Gemv(a, x, y);
+      auto x_matrix = cltune::Matrix<float>(53, 1);
+      x_matrix.data() = x;
+      auto y_matrix = cltune::Matrix<float>(37, 1);
+      y_matrix.data() = y;
+      RequireEqual(y_matrix, ReferenceGemm(a, false, x_matrix, false));
+      cltune::GemvTransposed(a, x_transposed, y);
+      auto xt_matrix = cltune::Matrix<float>(37, 1);
+      xt_matrix.data() = x_transposed;
+      y_matrix = cltune::Matrix<float>(53, 1);
+      y_matrix.data() = y;
+      RequireEqual(y_matrix, ReferenceGemm(a, true, xt_matrix, false));
+      REQUIRE_THROWS_AS(cltune::Gemv(a, x_transposed, y), std::runtime_error);
+    }
+    THEN("Gemm matches") {
+      const auto b = RandomMatrix(53, 29, 4);
+      auto c = cltune::Matrix<float>();
+      cltune::Gemm(a, b, c);
+      RequireEqual(c, ReferenceGemm(a, false, b, false));
+      REQUIRE_THROWS_AS(cltune::Gemm(a, a, c), std::runtime_error);
+    }
+    THEN("GemmNT matches, with long rows and with short rows of a tall B") {
+      const auto b = RandomMatrix(41, 53, 5);
+      auto c = cltune::Matrix<float>();
+      cltune::GemmNT(a, b, c);
+      RequireEqual(c, ReferenceGemm(a, false, b, true));
+      const auto a_short = RandomMatrix(23, 7, 6);
+      const auto b_tall = RandomMatrix(301, 7, 7);
+      cltune::GemmNT(a_short, b_tall, c);
+      RequireEqual(c, ReferenceGemm(a_short, false, b_tall, true));
+    }
+    THEN("GemmTN matches, with wide outputs and with tall and narrow inputs") {
+      const auto b = RandomMatrix(37, 31, 8);
+      auto c = cltune::Matrix<float>();
+      cltune::GemmTN(a, b, c);
+      RequireEqual(c, ReferenceGemm(a, true, b, false));
+      const auto a_tall = RandomMatrix(513, 9, 9);
+      const auto b_tall = RandomMatrix(513, 3, 10);
+      cltune::GemmTN(a_tall, b_tall, c);
+      RequireEqual(c, ReferenceGemm(a_tall, true, b_tall, false));
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("Cholesky solves and inverts positive-definite matrices", "[Matrix]") {
+  GIVEN("A symmetric positive-definite matrix") {
+    const auto n = size_t{19};
+    const auto a = RandomPositiveDefinite(n, 11);
+    auto b = std::vector<double>(n);
+    for (auto i=size_t{0}; i<n; ++i) { b[i] = static_cast<double>(i) - 5.0; }
+
+    THEN("CholeskySolve gives x with A*x = b") {
+      auto decomposition = a;
+      auto x = b;
+      REQUIRE(cltune::CholeskySolve(decomposition, x));
+      for (auto i=size_t{0}; i<n; ++i) {
+        auto sum = 0.0;
+        for (auto j=size_t{0}; j<n; ++j) { sum += a(i, j) * x[j]; }
+        REQUIRE(sum == Approx(b[i]).epsilon(1e-9));
+      }
+    }
+    THEN("CholeskyInvert gives the inverse") {
+      auto inverse = a;
+      REQUIRE(cltune::CholeskyInvert(inverse));
+      for (auto i=size_t{0}; i<n; ++i) {
+        for (auto j=size_t{0}; j<n; ++j) {
+          auto sum = 0.0;
+          for (auto k=size_t{0}; k<n; ++k) { sum += a(i, k) * inverse(k, j); }
+          REQUIRE(sum == Approx((i == j) ? 1.0 : 0.0).epsilon(1e-9));
+        }
+      }
+    }
+  }
+  GIVEN("Matrices which are not positive definite") {
+    auto indefinite = cltune::Matrix<double>({{1.0, 2.0}, {2.0, 1.0}});
+    auto singular = cltune::Matrix<double>({{1.0, 1.0, 0.0}, {1.0, 1.0, 0.0}, {0.0, 0.0, 1.0}});
+    auto b = std::vector<double>{1.0, 1.0};
+
+    THEN("both routines return false") {
+      auto decomposition = indefinite;
+      REQUIRE_FALSE(cltune::CholeskySolve(decomposition, b));
+      REQUIRE_FALSE(cltune::CholeskyInvert(indefinite));
+      REQUIRE_FALSE(cltune::CholeskyInvert(singular));
+    }
+    THEN("invalid sizes throw") {
+      auto rectangular = cltune::Matrix<double>(2, 3);
+      REQUIRE_THROWS_AS(cltune::CholeskyInvert(rectangular), std::runtime_error);
+      auto too_long = std::vector<double>{1.0, 2.0, 3.0};
+      REQUIRE_THROWS_AS(cltune::CholeskySolve(indefinite, too_long), std::runtime_error);
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("batched prediction matches prediction sample by sample", "[Matrix]") {
+  GIVEN("A trained linear-regression model") {
+    const auto num_features = size_t{3};
+    auto generator = std::default_random_engine(12);
+    auto distribution = std::uniform_real_distribution<float>(1.0f, 8.0f);
+    auto x = std::vector<std::vector<float>>();
+    auto y = std::vector<float>();
+    for (auto i=size_t{0}; i<200; ++i) {
+      auto sample = std::vector<float>(num_features);
+      for (auto &value: sample) { value = distribution(generator); }
+      x.push_back(sample);
+      y.push_back(sample[0] + 2.0f*sample[1]*sample[2]);
+    }
+    auto model = cltune::LinearRegression<float>(0.1f, false);
+    model.Train(x, y);
+
+    THEN("PredictBatch equals a loop over Predict, also over multiple chunks and threads") {
+
+      // Spans several threads (if available) and chunks, with a partial last chunk
+      const auto num_samples = size_t{3*4096 + 1031};
+      auto samples = cltune::Matrix<float>(num_samples, num_features);
+      for (auto &value: samples.data()) { value = distribution(generator); }
+      const auto predictions = model.PredictBatch(samples);
+      REQUIRE(predictions.size() == num_samples);
+      for (auto i=size_t{0}; i<num_samples; ++i) {
+        const auto sample = std::vector<float>(samples.row(i), samples.row(i) + num_features);
+        REQUIRE(predictions[i] == model.Predict(sample));
+      }
+    }
+  }
+}
+
+// =================================================================================================
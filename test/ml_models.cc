@@ -0,0 +1,187 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the training of the machine-learning models on synthetic data and the worker
+// threads used for training. These tests do not require a device.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "internal/ml_models/linear_regression.h"
+#include "internal/model_ensemble.h"
+#include "internal/worker_pool.h"
+
+// Creates random samples with features between 1 and 8 and their execution times, given as a
+// function of the features
+template <typename F>
+void RandomSamples(const size_t num_samples, const size_t num_features, const unsigned int seed,
+                   F time, std::vector<std::vector<float>> &x, std::vector<float> &y) {
+  auto generator = std::default_random_engine(seed);
+  auto distribution = std::uniform_real_distribution<float>(1.0f, 8.0f);
+  for (auto i=size_t{0}; i<num_samples; ++i) {
+    auto sample = std::vector<float>(num_features);
+    for (auto &value: sample) { value = distribution(generator); }
+    x.push_back(sample);
+    y.push_back(time(sample));
+  }
+}
+
+// A quadratic function of the logarithm of the execution time, including cross terms
+float QuadraticTime(const std::vector<float> &x) {
+  const auto log_time = 0.5 + 0.3*x[0] - 0.2*x[1] + 0.1*x[2] + 0.04*x[0]*x[1] - 0.03*x[1]*x[2] +
+                        0.02*x[0]*x[0] - 0.01*x[2]*x[2];
+  return static_cast<float>(std::exp(log_time));
+}
+
+// =================================================================================================
+
+SCENARIO("linear regression fits a quadratic exactly without regularization", "[Models]") {
+  GIVEN("Samples of a quadratic function of three features") {
+    auto x = std::vector<std::vector<float>>();
+    auto y = std::vector<float>();
+    RandomSamples(60, 3, 1, QuadraticTime, x, y);
+    auto x_test = std::vector<std::vector<float>>();
+    auto y_test = std::vector<float>();
+    RandomSamples(20, 3, 2, QuadraticTime, x_test, y_test);
+
+    THEN("the model trained with the normal equations predicts unseen samples") {
+      auto model = cltune::LinearRegression<float>(0.0f, false);
+      model.Train(x, y);
+      for (auto i=size_t{0}; i<x_test.size(); ++i) {
+        REQUIRE(model.Predict(x_test[i]) == Approx(y_test[i]).epsilon(1e-3));
+      }
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("recursive least squares matches re-training on all samples", "[Models]") {
+  GIVEN("Noisy samples, split into a training set and new samples") {
+    auto noise_generator = std::default_random_engine(3);
+    auto noise = std::uniform_real_distribution<float>(0.8f, 1.25f);
+    auto noisy_time = [&](const std::vector<float> &sample) {
+      return QuadraticTime(sample) * noise(noise_generator);
+    };
+    auto x = std::vector<std::vector<float>>();
+    auto y = std::vector<float>();
+    RandomSamples(50, 3, 4, noisy_time, x, y);
+    auto x_new = std::vector<std::vector<float>>();
+    auto y_new = std::vector<float>();
+    RandomSamples(30, 3, 5, noisy_time, x_new, y_new);
+    auto x_all = x;
+    auto y_all = y;
+    x_all.insert(x_all.end(), x_new.begin(), x_new.end());
+    y_all.insert(y_all.end(), y_new.begin(), y_new.end());
+
+    THEN("updating with the new samples predicts as training on all samples") {
+      auto updated = cltune::LinearRegression<float>(0.0f, false);
+      updated.Train(x, y);
+      REQUIRE(updated.Update(x_new, y_new));
+      auto refitted = cltune::LinearRegression<float>(0.0f, false);
+      refitted.Train(x_all, y_all);
+      auto x_test = std::vector<std::vector<float>>();
+      auto y_test = std::vector<float>();
+      RandomSamples(20, 3, 6, QuadraticTime, x_test, y_test);
+      for (auto &sample: x_test) {
+        REQUIRE(updated.Predict(sample) == Approx(refitted.Predict(sample)).epsilon(1e-3));
+      }
+    }
+    THEN("a model trained with gradient descent can't be updated") {
+      auto model = cltune::LinearRegression<float>(size_t{10}, 0.05f, 0.0f, false);
+      model.Train(x, y);
+      REQUIRE_FALSE(model.Update(x_new, y_new));
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("the worker pool runs each part of a task once per request", "[Models]") {
+  GIVEN("A pool of four threads") {
+    cltune::WorkerPool pool(4);
+    auto counts = std::vector<size_t>(4, 0);
+
+    THEN("repeated tasks with varying numbers of parts run each part once") {
+      for (auto request=size_t{0}; request<1000; ++request) {
+        pool.Run(1 + request % 4, [&counts] (const size_t tid) { ++counts[tid]; });
+      }
+      REQUIRE(counts[0] == 1000);
+      REQUIRE(counts[1] == 750);
+      REQUIRE(counts[2] == 500);
+      REQUIRE(counts[3] == 250);
+    }
+    THEN("an error of a worker is passed on, after which the pool can be used again") {
+      auto failing_task = [] (const size_t tid) {
+        if (tid == 2) { throw std::runtime_error("failing part"); }
+      };
+      REQUIRE_THROWS_AS(pool.Run(3, failing_task), std::runtime_error);
+      pool.Run(4, [&counts] (const size_t tid) { ++counts[tid]; });
+      REQUIRE(counts == std::vector<size_t>(4, 1));
+      REQUIRE_THROWS_AS(pool.Run(5, failing_task), std::runtime_error);
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("trained models predict the same after saving and loading", "[Models]") {
+  GIVEN("Samples of a quadratic function of three features") {
+    auto x = std::vector<std::vector<float>>();
+    auto y = std::vector<float>();
+    RandomSamples(80, 3, 7, QuadraticTime, x, y);
+    auto x_test = std::vector<std::vector<float>>();
+    auto y_test = std::vector<float>();
+    RandomSamples(20, 3, 8, QuadraticTime, x_test, y_test);
+    const auto types = {cltune::Model::kLinearRegression, cltune::Model::kNeuralNetwork,
+                        cltune::Model::kGradientBoostedTrees};
+
+    THEN("each type of model is restored exactly") {
+      for (auto &type: types) {
+        auto model = cltune::CreateModel(cltune::DefaultModelSettings(type), 3, false, 9, 1);
+        model->Train(x, y);
+        auto file = std::stringstream();
+        model->Save(file);
+        const auto loaded = cltune::MLModel<float>::Load(file);
+        for (auto &sample: x_test) {
+          REQUIRE(loaded->Predict(sample) == model->Predict(sample));
+        }
+      }
+    }
+    THEN("an ensemble is restored exactly, including the spread of its predictions") {
+      for (auto &type: types) {
+        auto ensemble = cltune::ModelEnsemble(cltune::DefaultModelSettings(type), 3, 3, false, 10);
+        ensemble.Train(x, y);
+        auto file = std::stringstream();
+        ensemble.Save(file);
+        const auto loaded = cltune::ModelEnsemble(file);
+        REQUIRE(loaded.size() == 3);
+        auto means = std::vector<float>();
+        auto variances = std::vector<float>();
+        auto loaded_means = std::vector<float>();
+        auto loaded_variances = std::vector<float>();
+        ensemble.PredictBatch(cltune::Matrix<float>(x_test), means, variances);
+        loaded.PredictBatch(cltune::Matrix<float>(x_test), loaded_means, loaded_variances);
+        REQUIRE(loaded_means == means);
+        REQUIRE(loaded_variances == variances);
+      }
+    }
+    THEN("an unknown type of model can't be loaded") {
+      auto file = std::stringstream("support_vector_machine\n0\n0\n");
+      REQUIRE_THROWS_AS(cltune::MLModel<float>::Load(file), std::runtime_error);
+    }
+  }
+}
+
+// =================================================================================================
@@ -0,0 +1,463 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the reading and writing of result files and the cache of imported results. These
+// tests do not require a device.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "internal/tuner_impl.h"
+#include "internal/results_writer.h"
+#include "internal/result_sinks.h"
+
+// Writes an example file to disk
+void WriteFixture(const std::string &filename, const std::string &contents) {
+  auto file = fopen(filename.c_str(), "w");
+  fprintf(file, "%s", contents.c_str());
+  fclose(file);
+}
+
+// Copies the first 'size' bytes of a file, e.g. to simulate a file which is still being written
+void CopyPrefix(const std::string &source, const std::string &destination, const size_t size) {
+  std::ifstream input(source, std::ios::binary);
+  const auto contents = std::string(std::istreambuf_iterator<char>(input),
+                                    std::istreambuf_iterator<char>());
+  std::ofstream output(destination, std::ios::binary);
+  output.write(contents.data(), static_cast<std::streamsize>(std::min(size, contents.size())));
+}
+
+// Creates a result of a kernel with the given configuration
+cltune::TunerImpl::TunerResult ExampleResult(const std::string &kernel_name, const float time,
+                                             const cltune::KernelInfo::Configuration &configuration,
+                                             const cltune::Outcome outcome) {
+  const auto status = (outcome == cltune::Outcome::kSuccess);
+  return cltune::TunerImpl::TunerResult{kernel_name, time, 0, status, configuration, outcome, 1.0f};
+}
+
+// Example output of PrintToFile, which has a header line per kernel and only successful results
+const auto kPrintToFile = R"(name;time;threads;MWG;NWG;
+gemm;2.50;256;64;32;
+gemm;3.13;128;32;32;
+
+name;time;threads;WPT;
+copy;1.00;64;4;
+)";
+
+// Example output of PrintJSON, extended with keys which the parser does not know
+const auto kPrintJSON = R"({
+  "precision": "32",
+  "device": "Example device",
+  "device_core_clock": "1000",
+  "future_number": 256,
+  "future_literal": true,
+  "future_object": {"a": [1, 2, {"b": null}], "c": "}],"},
+  "results": [
+    {
+      "kernel": "gemm",
+      "kernel_hash": "0123456789abcdef",
+      "time": 2.500,
+      "future_threads": 256,
+      "future_flag": false,
+      "future_list": [1, 2, 3],
+      "parameters": {"MWG": 64,"NWG": 32}
+    },
+    {
+      "future_null": null,
+      "kernel": "gemm",
+      "time": 3.125,
+      "parameters": {"MWG": 32,"NWG": 32}
+    }
+  ],
+  "future_last": -1.5e3
+}
+)";
+
+// =================================================================================================
+
+SCENARIO("JSON results with unknown keys can be read", "[Results]") {
+  GIVEN("A file as written by PrintJSON with additional keys") {
+    const auto filename = std::string{"cltune_test_results.json"};
+    WriteFixture(filename, kPrintJSON);
+    const auto results = cltune::TunerImpl::LoadJSONResults(filename);
+    remove(filename.c_str());
+
+    THEN("the unknown keys are skipped and the results are read") {
+      REQUIRE(results.size() == 2);
+      REQUIRE(results[0].device == "Example device");
+      REQUIRE(results[0].kernel_hash == "0123456789abcdef");
+      REQUIRE(results[0].result.kernel_name == "gemm");
+      REQUIRE(results[0].result.time == Approx(2.5f));
+      REQUIRE(results[0].result.status);
+      REQUIRE(results[0].result.configuration.size() == 2);
+      REQUIRE(results[0].result.configuration[0].name == "MWG");
+      REQUIRE(results[0].result.configuration[0].value == 64);
+      REQUIRE(results[1].device == "Example device");
+      REQUIRE(results[1].kernel_hash == "");
+      REQUIRE(results[1].result.time == Approx(3.125f));
+      REQUIRE(results[1].result.configuration[0].value == 32);
+    }
+  }
+  GIVEN("A malformed file") {
+    const auto filename = std::string{"cltune_test_malformed.json"};
+    WriteFixture(filename, "{\"results\": [{\"kernel\": \"gemm\", \"time\": }]}");
+    THEN("reading it throws") {
+      REQUIRE_THROWS_AS(cltune::TunerImpl::LoadJSONResults(filename), std::runtime_error);
+    }
+    remove(filename.c_str());
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("binary results can be read back after writing", "[Results]") {
+  GIVEN("A file with blocks of two kernels, written by the binary results writer") {
+    const auto filename = std::string{"cltune_test_results.bin"};
+    const auto block_results = cltune::BinaryResultsWriter::kBlockResults;
+    const auto missing = cltune::BinaryResultsWriter::kMissingValue;
+
+    // The writer only needs the names and the parameters of the kernels, not the device. The odd
+    // lengths of the strings make the header need padding.
+    const auto device = cltune::Device(0);
+    auto gemm = cltune::KernelInfo("gemm", "", device);
+    gemm.AddParameter("MWG", {16, 32, 64});
+    gemm.AddParameter("NWG", {8, 16});
+    auto copy = cltune::KernelInfo("copy", "", device);
+    copy.AddParameter("WPT", {1, 2, 4});
+    const auto device_info = std::vector<std::pair<std::string,std::string>>{
+      {"device", "Example device"}, {"precision", "32"}
+    };
+
+    // Three results of the first kernel: one with its settings in a different order, one without a
+    // parameter, and one with a value which is not in the list. Then the kernel switches twice,
+    // after which the first kernel gets more results than fit in a block.
+    {
+      cltune::BinaryResultsWriter writer(filename, device_info, {gemm, copy});
+      writer.Write(ExampleResult("gemm", 2.5f, {{"MWG", 32}, {"NWG", 16}},
+                                 cltune::Outcome::kSuccess));
+      writer.Write(ExampleResult("gemm", 3.0f, {{"NWG", 8}, {"MWG", 64}},
+                                 cltune::Outcome::kSuccess));
+      writer.Write(ExampleResult("gemm", 0.0f, {{"MWG", 16}}, cltune::Outcome::kCompileFailure));
+      writer.Write(ExampleResult("copy", 1.5f, {{"WPT", 4}}, cltune::Outcome::kSuccess));
+      writer.Write(ExampleResult("copy", 0.0f, {{"WPT", 3}}, cltune::Outcome::kLaunchFailure));
+      for (auto i=size_t{0}; i<block_results + 1; ++i) {
+        writer.Write(ExampleResult("gemm", static_cast<float>(i), {{"MWG", 16}, {"NWG", 8}},
+                                   cltune::Outcome::kSuccess));
+      }
+      REQUIRE_THROWS_AS(writer.Write(ExampleResult("gemv", 1.0f, {}, cltune::Outcome::kSuccess)),
+                        std::runtime_error);
+    }
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    const auto file_size = static_cast<size_t>(file.tellg());
+    file.close();
+
+    THEN("the header is read back") {
+      const cltune::ResultsReader reader(filename);
+      REQUIRE(reader.GetDeviceInfo() == device_info);
+      REQUIRE(reader.NumKernels() == 2);
+      REQUIRE(reader.GetKernelName(0) == "gemm");
+      REQUIRE(reader.GetKernelName(1) == "copy");
+      REQUIRE(reader.GetParameterNames(0) == std::vector<std::string>({"MWG", "NWG"}));
+      REQUIRE(reader.GetParameterValues(0, 1) == std::vector<size_t>({8, 16}));
+      REQUIRE(reader.GetParameterValues(1, 0) == std::vector<size_t>({1, 2, 4}));
+      REQUIRE_THROWS_AS(reader.GetParameterValues(1, 1), std::runtime_error);
+    }
+    THEN("a new block starts when the kernel switches or the block is full") {
+      const cltune::ResultsReader reader(filename);
+      REQUIRE(reader.NumBlocks() == 4);
+      REQUIRE(reader.NumResults() == 5 + block_results + 1);
+      const auto expected_kernels = std::vector<size_t>{0, 1, 0, 0};
+      const auto expected_sizes = std::vector<size_t>{3, 2, block_results, 1};
+      for (auto b=size_t{0}; b<reader.NumBlocks(); ++b) {
+        const auto block = reader.GetBlock(b);
+        REQUIRE(block.kernel_id == expected_kernels[b]);
+        REQUIRE(block.num_results == expected_sizes[b]);
+      }
+      const auto full = reader.GetBlock(2);
+      REQUIRE(full.times[block_results - 1] == static_cast<float>(block_results - 1));
+      REQUIRE(reader.GetBlock(3).times[0] == static_cast<float>(block_results));
+    }
+    THEN("the columns hold the results, with missing values for unknown settings") {
+      const cltune::ResultsReader reader(filename);
+      const auto gemm_block = reader.GetBlock(0);
+      REQUIRE(gemm_block.times[0] == 2.5f);
+      REQUIRE(gemm_block.drifts[1] == 1.0f);
+      REQUIRE(gemm_block.value_indices[0][0] == 1);
+      REQUIRE(gemm_block.value_indices[1][0] == 1);
+      REQUIRE(gemm_block.value_indices[0][1] == 2);
+      REQUIRE(gemm_block.value_indices[1][1] == 0);
+      REQUIRE(gemm_block.value_indices[1][2] == missing);
+      REQUIRE(gemm_block.statuses[2] == 0);
+      REQUIRE(gemm_block.outcomes[2] == static_cast<uint8_t>(cltune::Outcome::kCompileFailure));
+      REQUIRE(reader.GetConfiguration(gemm_block, 1).at("MWG") == 64);
+      REQUIRE(reader.GetConfiguration(gemm_block, 2).count("NWG") == 0);
+      const auto copy_block = reader.GetBlock(1);
+      REQUIRE(copy_block.statuses[0] == 1);
+      REQUIRE(copy_block.value_indices[0][0] == 2);
+      REQUIRE(copy_block.value_indices[0][1] == missing);
+      REQUIRE(reader.GetConfiguration(copy_block, 1).empty());
+    }
+    THEN("the file and the columns of each block are 8-byte aligned") {
+      const cltune::ResultsReader reader(filename);
+      REQUIRE(file_size % cltune::BinaryResultsWriter::kAlignment == 0);
+      for (auto b=size_t{0}; b<reader.NumBlocks(); ++b) {
+        const auto block = reader.GetBlock(b);
+        REQUIRE(reinterpret_cast<uintptr_t>(block.times) % 8 == 0);
+        REQUIRE(reinterpret_cast<uintptr_t>(block.drifts) % 4 == 0);
+        for (auto &value_indices: block.value_indices) {
+          REQUIRE(reinterpret_cast<uintptr_t>(value_indices) % 4 == 0);
+        }
+      }
+    }
+    THEN("a block which is cut off is ignored") {
+      const auto truncated = std::string{"cltune_test_truncated.bin"};
+      CopyPrefix(filename, truncated, file_size - 1);
+      auto reader = std::unique_ptr<cltune::ResultsReader>(new cltune::ResultsReader(truncated));
+      REQUIRE(reader->NumBlocks() == 3);
+      REQUIRE(reader->NumResults() == 5 + block_results);
+      CopyPrefix(filename, truncated, file_size - 1000);
+      reader.reset(new cltune::ResultsReader(truncated));
+      REQUIRE(reader->NumBlocks() == 2);
+      REQUIRE(reader->NumResults() == 5);
+      reader.reset();
+      remove(truncated.c_str());
+    }
+    remove(filename.c_str());
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("imported results are mapped onto a search space with added parameters", "[Results]") {
+  GIVEN("A kernel to which parameters were added since its results were measured") {
+
+    // VW is used by the kernel, SINGLE has a single value, and UNUSED is not used by the kernel
+    const auto device = cltune::Device(0);
+    auto kernel = cltune::KernelInfo("copy", "__kernel void copy() { int x = WPT*VW*SINGLE; }",
+                                     device);
+    kernel.AddParameter("WPT", {1, 2, 4});
+    kernel.AddParameter("VW", {1, 2});
+    kernel.AddParameter("SINGLE", {4});
+    kernel.AddParameter("UNUSED", {1, 2, 3});
+    const auto device_name = std::string{"Example device"};
+    const auto hash = kernel.SourceHash();
+    auto imported = cltune::TunerImpl::ImportedResults();
+    imported.results.push_back({device_name, hash, ExampleResult("copy", 2.5f, {{"WPT", 2}},
+                                                                 cltune::Outcome::kSuccess)});
+    imported.results.push_back({device_name, hash,
+                                ExampleResult("copy", 1.5f, {{"WPT", 4}, {"OLD", 8}},
+                                              cltune::Outcome::kSuccess)});
+    const auto full = cltune::KernelInfo::Configuration{{"WPT", 2}, {"VW", 1}, {"SINGLE", 4},
+                                                        {"UNUSED", 3}};
+
+    THEN("the parameters are detected as used or unused") {
+      REQUIRE(kernel.UsesParameter("WPT"));
+      REQUIRE(kernel.UsesParameter("VW"));
+      REQUIRE_FALSE(kernel.UsesParameter("UNUSED"));
+      REQUIRE_FALSE(kernel.UsesParameter("WP"));
+      REQUIRE_FALSE(kernel.UsesParameter("copy_"));
+    }
+    THEN("results which lack a used parameter without a default are skipped") {
+      const auto cache = cltune::TunerImpl::CacheImportedResults(kernel, device_name, {imported});
+      REQUIRE(cache.results.size() == 0);
+      REQUIRE(cltune::TunerImpl::FindCachedResult(kernel, cache, full) == nullptr);
+    }
+    THEN("the defaults, single values, and unused parameters fill in the missing parameters") {
+      imported.defaults = {{"VW", 1}, {"OLD", 8}};
+      const auto cache = cltune::TunerImpl::CacheImportedResults(kernel, device_name, {imported});
+      REQUIRE(cache.results.size() == 2);
+      REQUIRE(cache.num_mapped == 2);
+      const auto result = cltune::TunerImpl::FindCachedResult(kernel, cache, full);
+      REQUIRE(result != nullptr);
+      REQUIRE(result->time == 2.5f);
+      auto other_unused = full;
+      other_unused[3].value = 1;
+      REQUIRE(cltune::TunerImpl::FindCachedResult(kernel, cache, other_unused) == result);
+      auto other_used = full;
+      other_used[1].value = 2;
+      REQUIRE(cltune::TunerImpl::FindCachedResult(kernel, cache, other_used) == nullptr);
+      auto removed = full;
+      removed[0].value = 4;
+      REQUIRE(cltune::TunerImpl::FindCachedResult(kernel, cache, removed) != nullptr);
+    }
+    THEN("results with a removed parameter of another value than its default are skipped") {
+      imported.defaults = {{"VW", 1}, {"OLD", 16}};
+      const auto cache = cltune::TunerImpl::CacheImportedResults(kernel, device_name, {imported});
+      REQUIRE(cache.results.size() == 1);
+      auto removed = full;
+      removed[0].value = 4;
+      REQUIRE(cltune::TunerImpl::FindCachedResult(kernel, cache, removed) == nullptr);
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("results of each text format are read and the format is detected", "[Results]") {
+  GIVEN("Two kernels and results of which one failed to compile") {
+    const auto device = cltune::Device(0);
+    auto gemm = cltune::KernelInfo("gemm", "__kernel void gemm() { }", device);
+    gemm.AddParameter("MWG", {32, 64});
+    gemm.AddParameter("NWG", {32});
+    auto copy = cltune::KernelInfo("copy", "__kernel void copy() { }", device);
+    copy.AddParameter("WPT", {1, 4});
+    const auto kernels = std::vector<cltune::KernelInfo>{gemm, copy};
+    const auto device_info = std::vector<std::pair<std::string,std::string>>{
+      {"device", "Example device"}
+    };
+    auto results = std::vector<cltune::TunerImpl::TunerResult>{
+      ExampleResult("gemm", 2.5f, {{"MWG", 64}, {"NWG", 32}}, cltune::Outcome::kSuccess),
+      ExampleResult("copy", 0.0f, {{"WPT", 4}}, cltune::Outcome::kCompileFailure),
+      ExampleResult("gemm", 3.125f, {{"MWG", 32}, {"NWG", 32}}, cltune::Outcome::kSuccess)
+    };
+    results[1].time = std::numeric_limits<float>::max();
+    results[2].drift = 1.25f;
+
+    // Checks the results as read back from a result sink
+    auto require_results = [&] (const std::vector<cltune::TunerImpl::ImportedResult> &imported) {
+      REQUIRE(imported.size() == 3);
+      for (auto i=size_t{0}; i<imported.size(); ++i) {
+        const auto &result = imported[i].result;
+        REQUIRE(imported[i].device == "Example device");
+        REQUIRE(imported[i].kernel_hash == kernels[(i == 1) ? 1 : 0].SourceHash());
+        REQUIRE(result.kernel_name == results[i].kernel_name);
+        REQUIRE(result.time == results[i].time);
+        REQUIRE(result.status == results[i].status);
+        REQUIRE(result.outcome == results[i].outcome);
+        REQUIRE(result.drift == results[i].drift);
+        REQUIRE(result.configuration.size() == results[i].configuration.size());
+        for (auto p=size_t{0}; p<result.configuration.size(); ++p) {
+          REQUIRE(result.configuration[p].name == results[i].configuration[p].name);
+          REQUIRE(result.configuration[p].value == results[i].configuration[p].value);
+        }
+      }
+    };
+
+    THEN("the output of a JSON-lines sink is read as JSON") {
+      const auto filename = std::string{"cltune_test_results.jsonl"};
+      {
+        auto sink = cltune::CreateResultSink(cltune::ResultFormat::kJSONLines, filename,
+                                             device_info, kernels);
+        for (auto &result: results) { sink->Write(result); }
+      }
+      require_results(cltune::TunerImpl::LoadJSONResults(filename));
+      require_results(cltune::TunerImpl::LoadResults(filename));
+      remove(filename.c_str());
+    }
+    THEN("the output of a CSV sink is read with a header line per change of kernel") {
+      const auto filename = std::string{"cltune_test_results.csv"};
+      {
+        auto sink = cltune::CreateResultSink(cltune::ResultFormat::kCSV, filename, device_info,
+                                             kernels);
+        for (auto &result: results) { sink->Write(result); }
+      }
+      require_results(cltune::TunerImpl::LoadCSVResults(filename));
+      require_results(cltune::TunerImpl::LoadResults(filename));
+      remove(filename.c_str());
+    }
+  }
+  GIVEN("Files as written by PrintToFile and by PrintJSON") {
+    const auto csv_filename = std::string{"cltune_test_results.csv"};
+    const auto json_filename = std::string{"cltune_test_results.json"};
+    WriteFixture(csv_filename, kPrintToFile);
+    WriteFixture(json_filename, std::string{"\n  "} + kPrintJSON);
+
+    THEN("the CSV results are successful and have no device or hash") {
+      const auto imported = cltune::TunerImpl::LoadResults(csv_filename);
+      REQUIRE(imported.size() == 3);
+      REQUIRE(imported[0].device == "");
+      REQUIRE(imported[0].kernel_hash == "");
+      REQUIRE(imported[0].result.status);
+      REQUIRE(imported[0].result.outcome == cltune::Outcome::kSuccess);
+      REQUIRE(imported[1].result.time == Approx(3.13f));
+      REQUIRE(imported[1].result.threads == 128);
+      REQUIRE(imported[1].result.configuration.size() == 2);
+      REQUIRE(imported[1].result.configuration[1].name == "NWG");
+      REQUIRE(imported[2].result.kernel_name == "copy");
+      REQUIRE(imported[2].result.configuration.size() == 1);
+      REQUIRE(imported[2].result.configuration[0].name == "WPT");
+      REQUIRE(imported[2].result.configuration[0].value == 4);
+    }
+    THEN("the JSON results are detected despite leading whitespace") {
+      const auto imported = cltune::TunerImpl::LoadResults(json_filename);
+      REQUIRE(imported.size() == 2);
+      REQUIRE(imported[0].device == "Example device");
+    }
+    THEN("lines which don't match their header and missing files throw") {
+      WriteFixture(csv_filename, "name;time;threads;MWG;\ngemm;2.50;256;\n");
+      REQUIRE_THROWS_AS(cltune::TunerImpl::LoadResults(csv_filename), std::runtime_error);
+      WriteFixture(csv_filename, "name;time;threads;MWG;\ngemm;fast;256;64;\n");
+      REQUIRE_THROWS_AS(cltune::TunerImpl::LoadResults(csv_filename), std::runtime_error);
+      REQUIRE_THROWS_AS(cltune::TunerImpl::LoadResults("cltune_test_missing.csv"),
+                        std::runtime_error);
+    }
+    remove(csv_filename.c_str());
+    remove(json_filename.c_str());
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("the result cache keeps the results of the same device and source-code", "[Results]") {
+  GIVEN("Imported results of several devices and versions of a kernel") {
+    const auto device = cltune::Device(0);
+    auto kernel = cltune::KernelInfo("copy", "__kernel void copy() { int x = WPT; }", device);
+    kernel.AddParameter("WPT", {1, 2, 4});
+    const auto hash = kernel.SourceHash();
+    const auto success = cltune::Outcome::kSuccess;
+    auto imported = cltune::TunerImpl::ImportedResults();
+    auto add = [&] (const std::string &device_name, const std::string &kernel_hash,
+                    const std::string &kernel_name, const size_t value, const float time,
+                    const cltune::Outcome outcome) {
+      imported.results.push_back({device_name, kernel_hash,
+                                  ExampleResult(kernel_name, time, {{"WPT", value}}, outcome)});
+    };
+    add("Example device", hash, "copy", 1, 1.0f, success);
+    add("Other device", hash, "copy", 2, 2.0f, success);
+    add("Example device", "0123456789abcdef", "copy", 2, 2.0f, success);
+    add("Example device", hash, "gemm", 2, 2.0f, success);
+    add("Example device", hash, "copy", 3, 3.0f, success);
+    add("", "", "copy", 4, 4.0f, cltune::Outcome::kCompileFailure);
+    add("Example device", hash, "copy", 1, 1.5f, success);
+    const auto cache = cltune::TunerImpl::CacheImportedResults(kernel, "Example device",
+                                                               {imported});
+    auto find = [&] (const size_t value) {
+      return cltune::TunerImpl::FindCachedResult(kernel, cache, {{"WPT", value}});
+    };
+
+    THEN("results of other devices, versions, kernels, and values are skipped") {
+      REQUIRE(cache.results.size() == 2);
+      REQUIRE(find(2) == nullptr);
+      REQUIRE(find(3) == nullptr);
+    }
+    THEN("later results take precedence and failures are kept") {
+      REQUIRE(find(1) != nullptr);
+      REQUIRE(find(1)->time == 1.5f);
+      REQUIRE(find(4) != nullptr);
+      REQUIRE(find(4)->outcome == cltune::Outcome::kCompileFailure);
+      REQUIRE_FALSE(find(4)->status);
+    }
+    THEN("results without device and hash are counted as unverified") {
+      REQUIRE(cache.num_unverified == 1);
+      REQUIRE(cache.num_mapped == 0);
+    }
+  }
+}
+
+// =================================================================================================
@@ -0,0 +1,98 @@
+
+// =================================================================================================
+// This file is part of the CLTune project, which loosely follows the Google C++ styleguide and uses
+// a tab-size of two spaces and a max-width of 100 characters per line.
+//
+// Author(s):
+//   Cedric Nugteren <www.cedricnugteren.nl>
+//
+// This file tests the search methods on small search spaces. These tests do not require a device.
+//
+// =================================================================================================
+
+#include "catch.hpp"
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "internal/searchers/differential_evolution.h"
+#include "internal/searchers/full_search.h"
+
+// Creates the search space of a single parameter with the given values
+void SingleParameterSpace(const std::vector<size_t> &values,
+                          cltune::DifferentialEvolution::Configurations &configurations,
+                          cltune::DifferentialEvolution::Parameters &parameters) {
+  parameters = {cltune::KernelInfo::Parameter{"WPT", values, cltune::Encoding::kAuto}};
+  configurations.clear();
+  for (auto &value: values) { configurations.push_back({{"WPT", value}}); }
+}
+
+// Runs a search as the tuner does and returns the explored values in order
+std::vector<size_t> RunSearch(cltune::Searcher &search) {
+  auto explored = std::vector<size_t>();
+  for (auto p=size_t{0}; p<search.NumConfigurations(); ++p) {
+    const auto configuration = search.GetConfiguration();
+    explored.push_back(configuration[0].value);
+    search.PushOutcome(cltune::Outcome::kSuccess, static_cast<double>(configuration[0].value));
+    search.CalculateNextIndex();
+  }
+  return explored;
+}
+
+// =================================================================================================
+
+SCENARIO("differential evolution explores spaces smaller than its population", "[Searchers]") {
+  GIVEN("Search spaces of two and three configurations") {
+    auto configurations = cltune::DifferentialEvolution::Configurations();
+    auto parameters = cltune::DifferentialEvolution::Parameters();
+
+    THEN("each configuration is explored once") {
+      for (auto &values: {std::vector<size_t>{1, 2}, std::vector<size_t>{1, 2, 4}}) {
+        SingleParameterSpace(values, configurations, parameters);
+        auto search = cltune::DifferentialEvolution(configurations, parameters, 1.0, 8, 0.5, 0.9,
+                                                    1);
+        const auto explored = RunSearch(search);
+        REQUIRE(explored.size() == values.size());
+        REQUIRE(std::set<size_t>(explored.begin(), explored.end()).size() == values.size());
+      }
+    }
+    THEN("the search keeps moving once all configurations are explored") {
+      SingleParameterSpace({1, 2, 4}, configurations, parameters);
+      auto search = cltune::DifferentialEvolution(configurations, parameters, 2.0, 8, 0.5, 0.9, 2);
+      const auto explored = RunSearch(search);
+      REQUIRE(explored.size() == 6);
+      REQUIRE(std::set<size_t>(explored.begin() + 3, explored.end()).size() == 3);
+    }
+  }
+}
+
+// =================================================================================================
+
+SCENARIO("the search log leaves out predicted failures", "[Searchers]") {
+  GIVEN("A search which skipped its first configuration as a predicted failure") {
+    auto configurations = cltune::DifferentialEvolution::Configurations();
+    auto parameters = cltune::DifferentialEvolution::Parameters();
+    SingleParameterSpace({1, 2}, configurations, parameters);
+    auto search = cltune::FullSearch(configurations);
+    search.PushOutcome(cltune::Outcome::kPredictedFailure, 0.0);
+    search.CalculateNextIndex();
+    search.PushOutcome(cltune::Outcome::kSuccess, 3.0);
+    search.CalculateNextIndex();
+
+    THEN("only the measured configuration is logged, as the first step") {
+      auto file = tmpfile();
+      REQUIRE(file != nullptr);
+      search.PrintLog(file);
+      rewind(file);
+      auto log = std::string();
+      char buffer[256];
+      while (fgets(buffer, sizeof(buffer), file) != nullptr) { log += buffer; }
+      fclose(file);
+      REQUIRE(log == "step;index;time;WPT\n0;1;3.000;2\n");
+    }
+  }
+}
+
+// =================================================================================================
@@ -12,6 +12,10 @@
 
 #include "catch.hpp"
 
+#include <cstdio>
+#include <string>
+#include <vector>
+
 #include "cltune.h"
 
 // Settings
@@ -36,6 +40,10 @@ __kernel void matvec_reference(const int kSizeM, const int kSizeN,
   }
   vec_y[get_global_id(0)] = result;
 })";
+const auto kernel3 = R"(
+__kernel void copy_kernel(__global float* array) {
+  array[get_global_id(0)] = WPT;
+})";
 
 // =================================================================================================
 
@@ -114,3 +122,50 @@ SCENARIO("kernels can be added", "[Tuner]") {
 }
 
 // =================================================================================================
+
+SCENARIO("imported results are not measured again", "[Tuner]") {
+  GIVEN("A tuner with a kernel of which all configurations are known from an earlier session") {
+    cltune::Tuner tuner(kPlatformID, kDeviceID);
+    tuner.SuppressOutput();
+    const auto filename = std::string{"cltune_test_imported.csv"};
+    auto file = fopen(filename.c_str(), "w");
+    fprintf(file, "name;time;threads;WPT;\ncopy_kernel;5.00;128;1;\ncopy_kernel;3.00;128;2;\n"
+                  "copy_kernel;4.00;128;4;\n");
+    fclose(file);
+    const auto id = tuner.AddKernelFromString(kernel3, "copy_kernel", {128}, {8});
+    tuner.AddParameter(id, "WPT", {1, 2, 4});
+    tuner.AddArgumentOutput(std::vector<float>(128));
+    tuner.ImportResults(filename);
+    auto results = std::vector<cltune::Result>();
+    tuner.SetResultCallback([&results] (const cltune::Result &result) {
+      results.push_back(result);
+    });
+
+    // Checks that each result is the imported one: the time and drift of the earlier session
+    auto require_imported = [&results] () {
+      REQUIRE(results.size() == 3);
+      for (auto &result: results) {
+        const auto value = result.configuration.at("WPT");
+        REQUIRE(result.time == ((value == 1) ? 5.0f : (value == 2) ? 3.0f : 4.0f));
+        REQUIRE(result.drift == 1.0f);
+      }
+    };
+
+    THEN("the imported times are kept and don't count as evaluations") {
+      tuner.SetMaxEvaluations(1);
+      tuner.SetDriftControl(1, true);
+      tuner.Tune();
+      require_imported();
+      REQUIRE(tuner.GetBestResult().at("WPT") == 2);
+    }
+    THEN("with multi-fidelity tuning, the known configurations skip the fidelity levels") {
+      tuner.AddFidelityLevel(0.5, 1);
+      tuner.Tune();
+      require_imported();
+      REQUIRE(tuner.GetBestResult().at("WPT") == 2);
+    }
+    remove(filename.c_str());
+  }
+}
+
+// =================================================================================================